@@ -29,6 +29,8 @@
 #include <herdstat/portage/functional.hh>
 
 #include "common.hh"
+#include "xmlinit.hh"
+#include "dev_directory.hh"
 #include "action/away.hh"
 
 using namespace herdstat;
@@ -46,6 +48,12 @@ AwayActionHandler::desc() const
     return "Display away developers and their away messages.";
 }
 
+ActionHandler *
+AwayActionHandler::create() const
+{
+    return new AwayActionHandler();
+}
+
 const char * const
 AwayActionHandler::usage() const
 {
@@ -68,6 +76,13 @@ AwayActionHandler::generate_completions(std::vector<std::string> *v) const
     v->assign(devs.begin(), devs.end());
 }
 
+void
+AwayActionHandler::prepare()
+{
+    GlobalXMLInit();
+    GlobalDeveloperDirectory().update();
+}
+
 void
 AwayActionHandler::do_all(Query& query,
                           QueryResults * const results LIBHERDSTAT_UNUSED)
@@ -81,23 +96,21 @@ AwayActionHandler::do_all(Query& query,
 void
 AwayActionHandler::do_regex(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("AwayActionHandler::do_regex("+query.front().second+")");
+    TraceContext c("AwayActionHandler::do_regex("+query.front().second+")");
 
     const portage::Developers& devs(GlobalDevawayXML().devs());
 
-    regexp.assign(query.front().second);
     query.clear();
 
-    /* copy the user name of developers whose user name matches the regex */
-    util::transform_if(devs.begin(), devs.end(), std::back_inserter(query),
-        util::compose_f_gx(
-            std::bind1st(util::regexMatch(), regexp),
-            std::mem_fun_ref(&portage::Developer::user)),
-                std::mem_fun_ref(&portage::Developer::user));
+    /* copy the user name of developers whose user name matches any term */
+    portage::Developers::const_iterator d;
+    for (d = devs.begin() ; d != devs.end() ; ++d)
+        if (plan.matches(d->user()))
+            query.push_back(d->user());
 
     if (query.empty())
     {
-        results->add("Failed to find any developers matching '" + regexp() + "'.");
+        results->add("Failed to find any developers matching '" + plan.str() + "'.");
         throw ActionException();
     }
 }
@@ -105,7 +118,7 @@ AwayActionHandler::do_regex(Query& query, QueryResults * const results)
 void
 AwayActionHandler::do_results(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("AwayActionHandler::do_results()");
+    TraceContext c("AwayActionHandler::do_results()");
 
     const portage::Developers& devs(GlobalDevawayXML().devs());
     portage::Developers::const_iterator d;
@@ -132,9 +145,9 @@ AwayActionHandler::do_results(Query& query, QueryResults * const results)
                     d->user() + " - " + util::tidy_whitespace(d->awaymsg()));
             else
             {
-                /* copy what we have and fill it with info in herds.xml */
+                /* copy what we have and fill it with what else we know */
                 portage::Developer dev(*d);
-                GlobalHerdsXML().fill_developer(dev);
+                GlobalDeveloperDirectory().fill(dev);
 
                 if (dev.name().empty())
                     results->add("Developer", dev.user());
@@ -36,8 +36,10 @@ class AwayActionHandler : public ActionHandler
         
         virtual const char * const id() const;
         virtual const char * const desc() const;
+        virtual ActionHandler *create() const;
         virtual const char * const usage() const;
         virtual void generate_completions(std::vector<std::string> *) const;
+        virtual void prepare();
 
     protected:
         virtual void do_all(Query& query, QueryResults * const results);
@@ -28,6 +28,9 @@
 #include <herdstat/util/functional.hh>
 
 #include "common.hh"
+#include "xmlinit.hh"
+#include "xml_cache.hh"
+#include "dev_directory.hh"
 #include "action/dev.hh"
 
 using namespace herdstat;
@@ -45,6 +48,12 @@ DevActionHandler::desc() const
     return "Get information about the given developer(s).";
 }
 
+ActionHandler *
+DevActionHandler::create() const
+{
+    return new DevActionHandler();
+}
+
 const char * const
 DevActionHandler::usage() const
 {
@@ -84,22 +93,33 @@ DevActionHandler::generate_completions(std::vector<std::string> *v) const
     }
 }
 
+void
+DevActionHandler::prepare()
+{
+    GlobalXMLInit();
+
+    if (not options.userinfoxml().empty())
+        parse_userinfoxml();
+
+    GlobalDeveloperDirectory().update();
+}
+
 void
 DevActionHandler::do_init(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("DevActionHandler::do_init()");
+    TraceContext c("DevActionHandler::do_init()");
 
     ActionHandler::do_init(query, results);
 
     if (not options.userinfoxml().empty())
-        GlobalUserinfoXML().parse(options.userinfoxml());
+        parse_userinfoxml();
 }
 
 void
 DevActionHandler::do_all(Query& query,
                          QueryResults * const results LIBHERDSTAT_UNUSED)
 {
-    BacktraceContext c("DevActionHandler::do_all()");
+    TraceContext c("DevActionHandler::do_all()");
 
     portage::UserinfoXML& userinfo_xml(GlobalUserinfoXML());
     const portage::Developers& devs(userinfo_xml.devs());
@@ -134,38 +154,33 @@ DevActionHandler::do_all(Query& query,
 void
 DevActionHandler::do_regex(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("DevActionHandler::do_regex("+query.front().second+")");
+    TraceContext c("DevActionHandler::do_regex("+query.front().second+")");
     portage::UserinfoXML& userinfo_xml(GlobalUserinfoXML());
     const portage::Developers& devs(userinfo_xml.devs());
     const portage::Herds& herds(GlobalHerdsXML().herds());
     portage::Herds::const_iterator h;
 
-    regexp.assign(query.front().second);
     query.clear();
 
     /* insert the user name of each developer
-     * that matches the regex into our query object */
+     * that matches any term into our query object */
+    portage::Developers::const_iterator d;
     for (h = herds.begin() ; h != herds.end() ; ++h)
-        util::transform_if(h->begin(), h->end(), std::back_inserter(query),
-            util::compose_f_gx(
-                std::bind1st(util::regexMatch(), regexp),
-                std::mem_fun_ref(&portage::Developer::user)),
-                    std::mem_fun_ref(&portage::Developer::user));
-
+        for (d = h->begin() ; d != h->end() ; ++d)
+            if (plan.matches(d->user()))
+                query.push_back(d->user());
 
     /* likewise for userinfo.xml, if used.  There may be
      * developers that match that aren't listed in herds.xml */
     if (not userinfo_xml.empty())
-        util::transform_if(devs.begin(), devs.end(), std::back_inserter(query),
-            util::compose_f_gx(
-                std::bind1st(util::regexMatch(), regexp),
-                std::mem_fun_ref(&portage::Developer::user)),
-                    std::mem_fun_ref(&portage::Developer::user));
+        for (d = devs.begin() ; d != devs.end() ; ++d)
+            if (plan.matches(d->user()))
+                query.push_back(d->user());
 
     if (query.empty())
     {
         results->add("Failed to find any developers matching '" +
-                     regexp() + "'.");
+                     plan.str() + "'.");
         throw ActionException();
     }
 
@@ -187,13 +202,11 @@ DevActionHandler::do_regex(Query& query, QueryResults * const results)
 void
 DevActionHandler::do_results(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("DevActionHandler::do_results()");
+    TraceContext c("DevActionHandler::do_results()");
 
-    portage::HerdsXML& herds_xml(GlobalHerdsXML());
-    portage::DevawayXML& devaway_xml(GlobalDevawayXML());
     portage::UserinfoXML& userinfo_xml(GlobalUserinfoXML());
-    const portage::Developers& devs(userinfo_xml.devs());
-    const portage::Herds& herds(herds_xml.herds());
+    const portage::Herds& herds(GlobalHerdsXML().herds());
+    DeveloperDirectory& directory(GlobalDeveloperDirectory());
 
     if (query.all() and options.quiet())
     {
@@ -204,13 +217,12 @@ DevActionHandler::do_results(Query& query, QueryResults * const results)
 
     for (Query::iterator q = query.begin() ; q != query.end() ; ++q)
     {
-        portage::Developer dev(q->second);
-        herds_xml.fill_developer(dev);
-        devaway_xml.fill_developer(dev);
-        userinfo_xml.fill_developer(dev);
+        DeveloperDirectory::Entry entry;
+        const bool found = directory.find(q->second, &entry);
+        portage::Developer dev(found ? entry.dev
+                                     : portage::Developer(q->second));
 
-        if (dev.herds().empty() and (userinfo_xml.empty() or
-            (devs.find(q->second) == devs.end())))
+        if (dev.herds().empty() and not (found and entry.userinfo))
         {
             this->error() = true;
             results->add("Developer '" + q->second +
@@ -48,6 +48,21 @@ FindActionHandler::desc() const
     return "Find packages matching the given criteria.";
 }
 
+ActionHandler *
+FindActionHandler::create() const
+{
+    return new FindActionHandler();
+}
+
+void
+FindActionHandler::prepare()
+{
+    if (options.meta())
+        MetaActionHandler().prepare();
+    else
+        PortageSearchActionHandler::prepare();
+}
+
 const char * const
 FindActionHandler::usage() const
 {
@@ -65,21 +80,18 @@ FindActionHandler::createTab(WidgetFactory *widgetFactory)
 void
 FindActionHandler::do_results(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("FindActionHandler::do_results()");
+    TraceContext c("FindActionHandler::do_results()");
         
     this->size() = 0;
 
     if (not options.regex())
     {
-        const std::vector<portage::Package>& find_results(find().results());
         for (Query::iterator q = query.begin() ; q != query.end() ; ++q)
         {
             try
             {
-                find()(q->second, spinner());
-                matches.insert(matches.end(),
-                    find_results.begin(), find_results.end());
-                find().clear_results();
+                const std::vector<portage::Package>& res(find_pkg(q->second));
+                matches.insert(matches.end(), res.begin(), res.end());
 
                 if (not options.overlay())
                 {
@@ -36,6 +36,8 @@ class FindActionHandler : public PortageSearchActionHandler
 
         virtual const char * const id() const;
         virtual const char * const desc() const;
+        virtual ActionHandler *create() const;
+        virtual void prepare();
         virtual const char * const usage() const;
 
     protected:
@@ -24,12 +24,14 @@
 # include "config.h"
 #endif
 
+#include <cassert>
 #include <herdstat/defs.hh>
 #include <herdstat/util/progress/spinner.hh>
 #include <herdstat/util/string.hh>
 #include <herdstat/portage/functional.hh>
 
 #include "common.hh"
+#include "profiler.hh"
 #include "action/handler.hh"
 
 using namespace herdstat;
@@ -37,11 +39,9 @@ using namespace herdstat;
 ActionHandler::ActionHandler()
     : options(GlobalOptions()),
       color(GlobalColorMap()),
-      _err(false), _size(-1), _spinner(NULL)
+      _err(false), _size(-1), _spinner(NULL), _streaming(false)
 {
-    regexp.set_cflags(options.eregex() ?
-                util::Regex::icase|util::Regex::extended :
-                util::Regex::icase);
+    regexp.set_cflags(regex_cflags());
 }
 
 ActionHandler::~ActionHandler()
@@ -50,6 +50,13 @@ ActionHandler::~ActionHandler()
         delete _spinner;
 }
 
+int
+ActionHandler::regex_cflags() const
+{
+    return (options.eregex() ? util::Regex::icase|util::Regex::extended :
+                               util::Regex::icase);
+}
+
 bool
 ActionHandler::allow_pwd_query() const
 {
@@ -78,33 +85,65 @@ ActionHandler::usage() const
     return this->id();
 }
 
+ActionHandler *
+ActionHandler::create() const
+{
+    /* by default, action handlers can't run in a query context */
+    return NULL;
+}
+
+void
+ActionHandler::prepare()
+{
+}
+
 void
 ActionHandler::operator()(Query &query, QueryResults * const results)
 {
-    BacktraceContext c("ActionHandler::operator()");
+    TraceContext c("ActionHandler::operator()");
+
+    _streaming = results->streaming();
 
     try
     {
-        this->do_init(query, results);
+        {
+            ProfileScope p("do_init", this->id());
+            this->do_init(query, results);
+        }
 
         /* handle all target */
         if (query.all())
+        {
+            ProfileScope p("do_all", this->id());
             this->do_all(query, results);
+        }
         /* handle regex */
         else if (options.regex())
+        {
+            ProfileScope p("do_regex", this->id());
+
+            /* compile each term once, up front */
+            plan.compile(query, regex_cflags());
+            regexp.assign(query.front().second, regex_cflags());
             this->do_regex(query, results);
+        }
 
         /* fill results */
-        this->do_results(query, results);
+        {
+            ProfileScope p("do_results", this->id());
+            this->do_results(query, results);
+        }
 
         /* if the handler didnt set the size, default to query.size() */
         if (this->_size == -1)
             this->_size = query.size();
 
+        ProfileScope p("do_cleanup", this->id());
         this->do_cleanup(results);
     }
     catch (const ActionException&)
     {
+        ProfileScope p("do_cleanup", this->id());
         this->do_cleanup(results);
         throw;
     }
@@ -127,6 +166,8 @@ ActionHandler::do_all(Query& query LIBHERDSTAT_UNUSED,
 void
 ActionHandler::do_cleanup(QueryResults * const results)
 {
+    plan.clear();
+
     /* show count, if requested */
     if (options.count() and not this->error())
         results->add(this->_size);
@@ -137,7 +178,9 @@ ActionHandler::do_cleanup(QueryResults * const results)
 }
 
 PortageSearchActionHandler::PortageSearchActionHandler()
-    : matches(), _find(NULL), _pwd(false)
+    : matches(), _find(NULL),
+      _candidates(options.portdir(), std::vector<std::string>(), false),
+      _found(), _pwd(false)
 {
 }
 
@@ -168,6 +211,13 @@ PortageSearchActionHandler::generate_completions(std::vector<std::string> *v) co
     std::vector<std::string>(*v).swap(*v);
 }
 
+void
+PortageSearchActionHandler::prepare()
+{
+    /* decode and combine every shard now; PackageFinder wants them all */
+    GlobalPkgCache(NULL).begin();
+}
+
 void
 PortageSearchActionHandler::handle_pwd_query
     (Query * const query LIBHERDSTAT_UNUSED,
@@ -198,17 +248,89 @@ PortageSearchActionHandler::do_init(Query& query LIBHERDSTAT_UNUSED,
         start_spinner(1000, "Performing query");
 }
 
+void
+PortageSearchActionHandler::narrow_find()
+{
+    TraceContext c("PortageSearchActionHandler::narrow_find()");
+
+    assert(not _find);
+
+    const PackageCache& pkgcache(GlobalPkgCache(spinner()));
+    const bool extended = (regex_cflags() & util::Regex::extended);
+
+    /* a package only needs to be searched if it could match some term */
+    std::vector<portage::Package> candidates;
+    for (std::size_t n = 0 ; n != plan.size() ; ++n)
+        if (not pkgcache.find_regex_candidates(plan.term(n), extended,
+                                               &candidates))
+            return;
+
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()),
+        candidates.end());
+
+    debug_msg("searching %d of %d packages",
+        static_cast<int>(candidates.size()), static_cast<int>(pkgcache.size()));
+
+    _candidates.clear();
+    _candidates.insert(_candidates.end(), candidates.begin(), candidates.end());
+    _find = new portage::PackageFinder(_candidates);
+}
+
 void
 PortageSearchActionHandler::do_regex(Query& query,
                                      QueryResults * const results)
 {
-    BacktraceContext c("PortageSearchActionHandler::do_regex("+query.front().second+")");
+    TraceContext c("PortageSearchActionHandler::do_regex("+query.front().second+")");
 
-    regexp.assign(query.front().second);
+    this->narrow_find();
+
+    /* PackageFinder tries every package it was given on each pass */
+    const std::size_t searched =
+        (_find ? _candidates.size() : GlobalPkgCache(spinner()).size());
+    ProfileScope p("package search", this->id());
 
     try
     {
-        matches = find()(regexp, spinner());
+        if (plan.size() == 1)
+        {
+            profile_count(Profiler::REGEX_EVALS, searched);
+            matches = find()(plan[0], spinner());
+        }
+        else if (not plan.combined().empty())
+        {
+            profile_count(Profiler::REGEX_EVALS, searched);
+            matches = find()(plan.combined(), spinner());
+        }
+        else
+        {
+            /* one pass over the tree per term; PackageFinder only takes a
+             * single regex */
+            for (std::size_t n = 0 ; n != plan.size() ; ++n)
+            {
+                profile_count(Profiler::REGEX_EVALS, searched);
+
+                try
+                {
+                    const std::vector<portage::Package>& res(
+                        find()(plan[n], spinner()));
+                    matches.insert(matches.end(), res.begin(), res.end());
+                }
+                catch (const portage::NonExistentPkg&)
+                {
+                }
+
+                find().clear_results();
+            }
+
+            std::sort(matches.begin(), matches.end());
+            matches.erase(std::unique(matches.begin(), matches.end()),
+                matches.end());
+
+            if (matches.empty())
+                throw portage::NonExistentPkg(regexp);
+        }
+
         find().clear_results();
 
         if (not options.overlay())
@@ -227,6 +349,21 @@ PortageSearchActionHandler::do_regex(Query& query,
     }
 }
 
+const std::vector<portage::Package>&
+PortageSearchActionHandler::find_pkg(const std::string& criteria)
+{
+    TraceContext c("PortageSearchActionHandler::find_pkg("+criteria+")");
+    ProfileScope p("package lookup", this->id());
+
+    _found.clear();
+    GlobalPkgCache(spinner()).find(criteria, &_found);
+
+    if (_found.empty())
+        throw portage::NonExistentPkg(criteria);
+
+    return _found;
+}
+
 void
 PortageSearchActionHandler::do_cleanup(QueryResults * const results)
 {
@@ -234,9 +371,13 @@ PortageSearchActionHandler::do_cleanup(QueryResults * const results)
     matches.clear();
     _pwd = false;
 
-    if (options.timer())
-        options.outstream() << "Took " << find().elapsed()
-            << "ms to perform search." << std::endl;
+    /* the next query narrows (or doesn't) for itself */
+    if (_find)
+    {
+        delete _find;
+        _find = NULL;
+    }
+    _candidates.clear();
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
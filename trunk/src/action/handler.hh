@@ -29,7 +29,6 @@
 
 #include <map>
 #include <herdstat/util/misc.hh>
-#include <herdstat/util/timer.hh>
 #include <herdstat/util/regex.hh>
 #include <herdstat/util/progress/spinner.hh>
 #include <herdstat/portage/package_finder.hh>
@@ -37,6 +36,7 @@
 #include "options.hh"
 #include "package_cache.hh"
 #include "query.hh"
+#include "query_plan.hh"
 #include "query_results.hh"
 #include "io/gui/widget_factory.hh"
 
@@ -73,6 +73,16 @@ class ActionHandler
         /// Fill vector of strings with possible arguments to operator().
         virtual void generate_completions(std::vector<std::string> *) const = 0;
 
+        /**
+         * Create a new handler of the same kind, for running a query in a
+         * QueryContext.
+         * @returns NULL if this action can't run in a context.
+         */
+        virtual ActionHandler *create() const;
+        /// Bring the shared data this action reads up to date and decode it
+        /// fully; see QueryContext::prepare().
+        virtual void prepare();
+
     protected:
         /// Default constructor.
         ActionHandler();
@@ -99,6 +109,9 @@ class ActionHandler
         /// did the handler err at least once?
         bool& error() { return _err; }
 
+        /// regex flags for the current options.
+        int regex_cflags() const;
+
         /// increment progress spinner.
         inline void increment_spinner();
         /// stop progress spinner.
@@ -117,11 +130,15 @@ class ActionHandler
         Options& options;
         herdstat::util::ColorMap& color;
         herdstat::util::Regex regexp;
+        /// compiled regex query terms (when options.regex() is set).
+        QueryPlan plan;
 
     private:
         bool _err;
         int _size;
         herdstat::util::ProgressMeter *_spinner;
+        /* are results being written out as they're added? */
+        bool _streaming;
 };
 
 inline void
@@ -144,6 +161,10 @@ ActionHandler::stop_spinner()
 inline void
 ActionHandler::start_spinner(unsigned total, const std::string& title)
 {
+    /* it'd only get in the way of the results */
+    if (_streaming)
+        return;
+
     if (not _spinner)
         _spinner = new herdstat::util::Spinner();
     if (not _spinner->started())
@@ -165,6 +186,7 @@ class PortageSearchActionHandler : public ActionHandler
                                       QueryResults * const results);
 
         virtual void generate_completions(std::vector<std::string> *) const;
+        virtual void prepare();
 
     protected:
         /// Default constructor.
@@ -179,8 +201,25 @@ class PortageSearchActionHandler : public ActionHandler
         /// determine if any of the specified packages are ambigious.
         inline bool is_ambiguous(const std::vector<herdstat::portage::Package>& pkgs);
 
-        /// return reference to _find member.
+        /// return reference to _find member (searching every package,
+        /// unless narrow_find() has narrowed it down).
         inline herdstat::portage::PackageFinder& find();
+        /**
+         * Narrow find() down to the packages that could match the query's
+         * regular expressions, using the package cache's trigram index.
+         * Must be called before find() is first used in a query (do_cleanup()
+         * resets it after each one); does nothing if any of the terms has
+         * nothing to look up.
+         */
+        void narrow_find();
+        /**
+         * Find packages matching the given (non-regex) criteria using the
+         * package cache directly.
+         * @returns Reference to matches (valid until the next call).
+         * @exception NonExistentPkg
+         */
+        const std::vector<herdstat::portage::Package>&
+            find_pkg(const std::string& criteria);
         /// are we in pwd mode?
         inline bool pwd_mode() const { return _pwd; }
         /// set pwd mode.
@@ -191,6 +230,9 @@ class PortageSearchActionHandler : public ActionHandler
 
     private:
         herdstat::portage::PackageFinder *_find;
+        /* what _find searches, if narrowed down */
+        PackageCache::container_type _candidates;
+        std::vector<herdstat::portage::Package> _found;
         bool _pwd;
 };
 
@@ -29,6 +29,7 @@
 #include <herdstat/util/functional.hh>
 
 #include "common.hh"
+#include "xmlinit.hh"
 #include "action/herd.hh"
 
 using namespace herdstat;
@@ -46,6 +47,12 @@ HerdActionHandler::desc() const
     return "Get information about the given herd(s).";
 }
 
+ActionHandler *
+HerdActionHandler::create() const
+{
+    return new HerdActionHandler();
+}
+
 const char * const
 HerdActionHandler::usage() const
 {
@@ -69,11 +76,17 @@ HerdActionHandler::generate_completions(std::vector<std::string> *v) const
         std::mem_fun_ref(&portage::Herd::name));
 }
 
+void
+HerdActionHandler::prepare()
+{
+    GlobalXMLInit();
+}
+
 void
 HerdActionHandler::do_all(Query& query,
                           QueryResults * const results LIBHERDSTAT_UNUSED)
 {
-    BacktraceContext c("HerdActionHandler::do_all()");
+    TraceContext c("HerdActionHandler::do_all()");
     const portage::Herds& herds(GlobalHerdsXML().herds());
     std::transform(herds.begin(), herds.end(),
         std::back_inserter(query),
@@ -84,24 +97,22 @@ void
 HerdActionHandler::do_regex(Query& query,
                             QueryResults * const results LIBHERDSTAT_UNUSED)
 {
-    BacktraceContext c("HerdActionHandler::do_regex("+query.front().second+")");
+    TraceContext c("HerdActionHandler::do_regex("+query.front().second+")");
     const portage::Herds& herds(GlobalHerdsXML().herds());
 
-    regexp.assign(query.front().second);
     query.clear();
 
-    /* copy each herd name of each herd that matches the regex */
-    util::transform_if(herds.begin(), herds.end(), std::back_inserter(query),
-        util::compose_f_gx(
-            std::bind1st(util::regexMatch(), regexp),
-            std::mem_fun_ref(&portage::Herd::name)),
-                std::mem_fun_ref(&portage::Herd::name));
+    /* copy each herd name of each herd that matches any term */
+    portage::Herds::const_iterator h;
+    for (h = herds.begin() ; h != herds.end() ; ++h)
+        if (plan.matches(h->name()))
+            query.push_back(h->name());
 }
 
 void
 HerdActionHandler::do_results(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("HerdActionHandler::do_results()");
+    TraceContext c("HerdActionHandler::do_results()");
 
     const portage::Herds& herds(GlobalHerdsXML().herds());
     portage::Herds::const_iterator h;
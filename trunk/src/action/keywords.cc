@@ -31,6 +31,7 @@
 #include <herdstat/portage/keywords.hh>
 
 #include "common.hh"
+#include "ebuild_cache.hh"
 #include "overlay_display.hh"
 #include "action/keywords.hh"
 
@@ -55,6 +56,19 @@ KeywordsActionHandler::desc() const
     return "Get keywords for the given packages.";
 }
 
+ActionHandler *
+KeywordsActionHandler::create() const
+{
+    return new KeywordsActionHandler();
+}
+
+void
+KeywordsActionHandler::prepare()
+{
+    PortageSearchActionHandler::prepare();
+    GlobalEbuildCache().update();
+}
+
 const char * const
 KeywordsActionHandler::usage() const
 {
@@ -84,7 +98,7 @@ struct GetVerKeywordsPair
 void
 KeywordsActionHandler::do_results(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("KeywordsActionHandler::do_results()");
+    TraceContext c("KeywordsActionHandler::do_results()");
 
     OverlayDisplay od(results);
 
@@ -96,13 +110,11 @@ KeywordsActionHandler::do_results(Query& query, QueryResults * const results)
         {
             try
             {
-                const std::vector<portage::Package>& res(find().results());
-                find()(q->second, spinner());
+                const std::vector<portage::Package>& res(find_pkg(q->second));
                 if (is_ambiguous(res))
                     throw portage::AmbiguousPkg(res.begin(), res.end());
 
                 matches.insert(matches.end(), res.begin(), res.end());
-                find().clear_results();
 
                 if (not options.overlay())
                 {
@@ -134,6 +146,10 @@ KeywordsActionHandler::do_results(Query& query, QueryResults * const results)
         }
     }
 
+    EbuildCache& ebuilds(GlobalEbuildCache());
+    ebuilds.update();
+
+    EbuildCache::keywords_type keywords;
     std::vector<portage::Package>::iterator m;
     for (m = matches.begin() ; m != matches.end() ; ++m)
     {
@@ -146,7 +162,7 @@ KeywordsActionHandler::do_results(Query& query, QueryResults * const results)
             continue;
         }
 
-        const portage::KeywordsMap& keywords(m->keywords());
+        ebuilds.keywords(*m, &keywords);
 
         this->size() += keywords.size();
 
@@ -167,6 +183,8 @@ KeywordsActionHandler::do_results(Query& query, QueryResults * const results)
                 results->add_linebreak();
         }
     }
+
+    ebuilds.save();
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
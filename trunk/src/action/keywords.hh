@@ -37,6 +37,8 @@ class KeywordsActionHandler : public PortageSearchActionHandler
         virtual bool allow_pwd_query() const;
         virtual const char * const id() const;
         virtual const char * const desc() const;
+        virtual ActionHandler *create() const;
+        virtual void prepare();
         virtual const char * const usage() const;
 
     protected:
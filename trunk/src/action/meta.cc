@@ -29,13 +29,14 @@
 #include <herdstat/util/misc.hh>
 #include <herdstat/util/string.hh>
 #include <herdstat/portage/exceptions.hh>
-#include <herdstat/portage/package_which.hh>
 #include <herdstat/portage/util.hh>
 #include <herdstat/portage/ebuild.hh>
 #include <herdstat/portage/license.hh>
 #include <herdstat/portage/metadata_xml.hh>
 
 #include "common.hh"
+#include "ebuild_cache.hh"
+#include "metadata_cache.hh"
 #include "overlay_display.hh"
 #include "action/meta.hh"
 
@@ -86,6 +87,24 @@ MetaActionHandler::desc() const
     return "Get metadata information for the given category/package.";
 }
 
+ActionHandler *
+MetaActionHandler::create() const
+{
+    return new MetaActionHandler();
+}
+
+void
+MetaActionHandler::prepare()
+{
+    PortageSearchActionHandler::prepare();
+
+    MetadataCache& metacache(GlobalMetadataCache());
+    metacache.update(NULL, false);
+    metacache.decode_all();
+
+    GlobalEbuildCache().update();
+}
+
 const char * const
 MetaActionHandler::usage() const
 {
@@ -113,11 +132,22 @@ static void
 add_metadata(const metadata_data& data, std::string& longdesc,
              QueryResults * const results)
 {
-    BacktraceContext c("add_metadata("+data.pkg+")");
+    TraceContext c("add_metadata("+data.pkg+")");
 
     const Options& options(GlobalOptions());
-    const portage::MetadataXML m(data.path);
-    const portage::Metadata& meta(m.data());
+
+    /* only parse the metadata.xml if it's not in the metadata cache or has
+     * changed since it was cached */
+    const portage::Metadata *cached(data.is_category ? NULL :
+        GlobalMetadataCache().find_current(data.path));
+    portage::Metadata parsed;
+    if (not cached)
+    {
+        const portage::MetadataXML m(data.path);
+        parsed = m.data();
+    }
+
+    const portage::Metadata& meta(cached ? *cached : parsed);
     const portage::Herds& herds(meta.herds());
     const portage::Developers& devs(meta.devs());
 
@@ -155,10 +185,9 @@ add_metadata(const metadata_data& data, std::string& longdesc,
 }
 
 static void
-add_data(const metadata_data& data, QueryResults * const results,
-         util::ProgressMeter *spinner)
+add_data(const metadata_data& data, QueryResults * const results)
 {
-    BacktraceContext c("add_data("+data.pkg+")");
+    TraceContext c("add_data("+data.pkg+")");
 
     util::ColorMap& color(GlobalColorMap());
     Options& options(GlobalOptions());
@@ -177,13 +206,12 @@ add_data(const metadata_data& data, QueryResults * const results,
 
     if (not data.is_category)
     {
-        portage::PackageWhich which;
-        const std::vector<std::string>& which_results(
-                which(data.pkg, data.portdir, spinner));
-        const std::string& ebuild(which_results.front());
+        EbuildCache& ebuilds(GlobalEbuildCache());
+        const std::string ebuild(ebuilds.latest(data.portdir+"/"+data.pkg));
+        if (ebuild.empty())
+            throw portage::NonExistentPkg(data.pkg);
 
-        assert(not ebuild.empty());
-        ebuild_vars.read(ebuild);
+        ebuilds.vars(ebuild, &ebuild_vars);
 
         if (options.quiet() and ebuild_vars["LICENSE"].empty())
             ebuild_vars["LICENSE"] = "none";
@@ -254,7 +282,7 @@ add_data(const metadata_data& data, QueryResults * const results,
 void
 MetaActionHandler::do_results(Query& query, QueryResults * const results)
 {
-    BacktraceContext c("MetaActionHandler::do_results()");
+    TraceContext c("MetaActionHandler::do_results()");
 
     OverlayDisplay od(results);
     options.set_count(false);
@@ -266,8 +294,7 @@ MetaActionHandler::do_results(Query& query, QueryResults * const results)
         {
             try
             {
-                const std::vector<portage::Package>& res(find().results());
-                find()(q->second, spinner());
+                const std::vector<portage::Package>& res(find_pkg(q->second));
                 if (is_ambiguous(res))
                     throw portage::AmbiguousPkg(res.begin(), res.end());
                 /* not ambigious but more than one match.  that means we have 1
@@ -301,8 +328,6 @@ MetaActionHandler::do_results(Query& query, QueryResults * const results)
                 else
                     matches.insert(matches.end(), res.begin(), res.end());
 
-                find().clear_results();
-
                 if (not options.overlay())
                 {
                     remove_overlay_packages();
@@ -335,6 +360,11 @@ MetaActionHandler::do_results(Query& query, QueryResults * const results)
 
     this->size() = matches.size();
 
+    /* load whatever's valid of the metadata cache, but don't regenerate it
+     * just for this: a handful of packages is quicker to parse */
+    GlobalMetadataCache().update(spinner(), false);
+    GlobalEbuildCache().update();
+
     std::vector<portage::Package>::iterator m;
     for (m = matches.begin() ; m != matches.end() ; ++m, increment_spinner())
     {
@@ -358,8 +388,10 @@ MetaActionHandler::do_results(Query& query, QueryResults * const results)
             results->add(data.is_category ? "Category" : "Package",
                     data.pkg + od[data.portdir]);
 
-        add_data(data, results, spinner());
+        add_data(data, results);
     }
+
+    GlobalEbuildCache().save();
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
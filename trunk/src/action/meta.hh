@@ -39,6 +39,8 @@ class MetaActionHandler : public PortageSearchActionHandler
                                       QueryResults * const results);
         virtual const char * const id() const;
         virtual const char * const desc() const;
+        virtual ActionHandler *create() const;
+        virtual void prepare();
         virtual const char * const usage() const;
         
     protected:
@@ -24,9 +24,14 @@
 # include "config.h"
 #endif
 
+#include <algorithm>
+#include <iterator>
 #include <herdstat/util/progress/spinner.hh>
 
 #include "common.hh"
+#include "xmlinit.hh"
+#include "dev_directory.hh"
+#include "ebuild_cache.hh"
 #include "action/meta.hh"
 #include "action/pkg.hh"
 
@@ -34,7 +39,7 @@ using namespace herdstat;
 using namespace gui;
 
 PkgActionHandler::PkgActionHandler()
-    : metacache(), with(), herds_xml(GlobalHerdsXML())
+    : metacache(GlobalMetadataCache()), with(), herds_xml(GlobalHerdsXML())
 {
 }
 
@@ -50,6 +55,12 @@ PkgActionHandler::desc() const
     return "Find packages maintained by the given herd/developer.";
 }
 
+ActionHandler *
+PkgActionHandler::create() const
+{
+    return new PkgActionHandler();
+}
+
 const char * const
 PkgActionHandler::usage() const
 {
@@ -66,16 +77,17 @@ PkgActionHandler::createTab(WidgetFactory *widgetFactory)
 
 bool
 PkgActionHandler::metadata_matches(const portage::Metadata& meta,
-                                   const std::string& criteria)
+                                   const std::string& criteria,
+                                   const util::Regex& re)
 {
-    BacktraceContext c("PkgActionHandler::metadata_matches()");
+    TraceContext c("PkgActionHandler::metadata_matches()");
 
     const portage::Herds& herds(meta.herds());
     const portage::Developers& devs(meta.devs());
 
     if (options.dev())
     {
-        if ((options.regex() and (devs.find(regexp) != devs.end()) and
+        if ((options.regex() and (devs.find(re) != devs.end()) and
             (with.empty() or (herds.find(with) != herds.end()) or
             (with() == "no-herd" and herds.empty()))) or
             (not options.regex() and (devs.find(criteria) != devs.end()) and
@@ -85,7 +97,7 @@ PkgActionHandler::metadata_matches(const portage::Metadata& meta,
     }
     else
     {
-        if ((options.regex() and (herds.find(regexp) != herds.end())) or
+        if ((options.regex() and (herds.find(re) != herds.end())) or
             (not options.regex() and (herds.find(criteria) != herds.end())) or
             (criteria == "no-herd" and herds.empty()))
         {
@@ -130,7 +142,7 @@ PkgActionHandler::add_matches(QueryResults * const results)
             else if (options.dev())
             {
                 portage::Developer dev(criteria);
-                herds_xml.fill_developer(dev);
+                GlobalDeveloperDirectory().fill(dev);
 
                 if (dev.name().empty())
                     results->add("Developer", criteria);
@@ -176,8 +188,8 @@ PkgActionHandler::add_matches(QueryResults * const results)
             if ((options.verbose() and not options.quiet()) and
                     not longdesc.empty())
             {
-                if (results->size() > 1 and
-                    results->back() != QueryResults::value_type("", ""))
+                if (results->lines() > 1 and
+                    results->last() != QueryResults::value_type("", ""))
                     results->add_linebreak();
 
                 if (options.color())
@@ -244,16 +256,26 @@ PkgActionHandler::generate_completions(std::vector<std::string> *v) const
     }
 }
 
+void
+PkgActionHandler::prepare()
+{
+    GlobalXMLInit();
+    GlobalPkgCache(NULL).begin();
+    metacache.update(NULL);
+    metacache.decode_all();
+    GlobalDeveloperDirectory().update();
+
+    if (options.meta())
+        GlobalEbuildCache().update();
+}
+
 void
 PkgActionHandler::do_init(Query& query, QueryResults * const results)
 {
     ActionHandler::do_init(query, results);
 
     if (options.spinner())
-    {
         start_spinner(1000, "Performing query");
-        metacache.set_spinner(spinner());
-    }
 
     this->size() = 0;
 
@@ -262,36 +284,134 @@ PkgActionHandler::do_init(Query& query, QueryResults * const results)
                                  options.with_dev()),
                                  util::Regex::icase);
 
-    /* load metadata cache */
-    if (metacache.is_valid())
-        metacache.load();
-    else
+    /* load (or regenerate the stale shards of) the metadata cache; after
+     * the first query this is just a check that nothing's changed.  The
+     * spinner is NULL if there's none this time. */
+    metacache.update(spinner());
+}
+
+void
+PkgActionHandler::do_regex(Query& query, QueryResults * const results)
+{
+}
+
+/*
+ * Use the metadata cache's indexes to get the ids of the entries that could
+ * possibly match each query term.  Candidates still need to be checked with
+ * metadata_matches(), but that's a handful instead of the whole tree.
+ */
+
+void
+PkgActionHandler::find_candidates(const Query& query,
+                                  std::vector<MetadataCache::ids_type> *ids)
+{
+    TraceContext c("PkgActionHandler::find_candidates()");
+
+    const MetadataCache::Index index(options.dev() ? MetadataCache::DEVS :
+                                                     MetadataCache::HERDS);
+    MetadataCache::ids_type tmp;
+
+    ids->assign(query.size(), MetadataCache::ids_type());
+
+    if (options.regex())
     {
-        metacache.fill();
-        metacache.dump();
+        /* test each herd/developer once against all terms */
+        std::vector<std::string> keys;
+        metacache.keys(index, &keys);
+
+        QueryPlan::hits_type hits;
+        std::vector<std::string>::const_iterator k;
+        for (k = keys.begin() ; k != keys.end() ; ++k)
+        {
+            if (not plan.matches(*k, &hits))
+                continue;
+
+            metacache.find(index, *k, &tmp);
+            for (QueryPlan::hits_type::iterator h = hits.begin() ;
+                    h != hits.end() ; ++h)
+                merge_ids(tmp, &(*ids)[*h]);
+        }
+    }
+
+    Query::const_iterator q;
+    Query::size_type n;
+    for (q = query.begin(), n = 0 ; q != query.end() ; ++q, ++n)
+    {
+        const std::string& criteria(q->second);
+        MetadataCache::ids_type& candidates((*ids)[n]);
+
+        if (not options.regex())
+            metacache.find(index, criteria, &candidates);
+
+        if (not options.dev() and criteria == "no-herd")
+        {
+            metacache.find_unmaintained(MetadataCache::HERDS, &tmp);
+            merge_ids(tmp, &candidates);
+        }
+
+        if (not with.empty() and not candidates.empty())
+            narrow_candidates(criteria, &candidates);
     }
 }
 
+/*
+ * Narrow down candidates by --with-herd/--with-maintainer.
+ */
+
 void
-PkgActionHandler::do_regex(Query& query, QueryResults * const results)
+PkgActionHandler::narrow_candidates(const std::string& criteria,
+                                    MetadataCache::ids_type *ids)
 {
+    MetadataCache::ids_type tmp, narrowed;
+
+    if (options.dev())
+    {
+        metacache.find(MetadataCache::HERDS, with, &tmp);
+        if (with() == "no-herd")
+        {
+            MetadataCache::ids_type unmaintained;
+            metacache.find_unmaintained(MetadataCache::HERDS, &unmaintained);
+            merge_ids(unmaintained, &tmp);
+        }
+    }
+    else if (with() == "none")
+    {
+        metacache.find_unmaintained(MetadataCache::DEVS, &tmp);
+        MetadataCache::ids_type herd_as_dev;
+        metacache.find(MetadataCache::DEVS, criteria, &herd_as_dev);
+        merge_ids(herd_as_dev, &tmp);
+    }
+    else
+        metacache.find(MetadataCache::DEVS, with, &tmp);
+
+    std::set_intersection(ids->begin(), ids->end(), tmp.begin(), tmp.end(),
+        std::back_inserter(narrowed));
+    ids->swap(narrowed);
 }
 
 void
 PkgActionHandler::do_results(Query& query, QueryResults * const results)
 {
-    MetadataCache::const_iterator m;
-    for (m = metacache.begin() ; m != metacache.end() ; ++m, increment_spinner())
+    assert(not options.regex() or (plan.size() == query.size()));
+
+    std::vector<MetadataCache::ids_type> candidates;
+    find_candidates(query, &candidates);
+
+    Query::const_iterator q;
+    Query::size_type n;
+    for (q = query.begin(), n = 0 ; q != query.end() ;
+            ++q, ++n, increment_spinner())
     {
-        for (Query::const_iterator q = query.begin() ;
-                q != query.end() ; ++q, increment_spinner())
+        const std::string& criteria(q->second);
+        const util::Regex& re(options.regex() ? plan[n] : regexp);
+
+        MetadataCache::ids_type::const_iterator id;
+        for (id = candidates[n].begin() ; id != candidates[n].end() ;
+                ++id, increment_spinner())
         {
-            const std::string& criteria(q->second);
-    
-            if (options.regex())
-                regexp.assign(criteria);
-            
-            if (metadata_matches(*m, q->second))
+            const portage::Metadata& m(metacache[*id]);
+
+            if (metadata_matches(m, criteria, re))
             {
                 matches_type::iterator i = matches.find(criteria);
 
@@ -299,7 +419,7 @@ PkgActionHandler::do_results(Query& query, QueryResults * const results)
                     i = matches.insert(std::make_pair(criteria,
                             new std::set<portage::Metadata>())).first;
                     
-                if (i->second->insert(*m).second)
+                if (i->second->insert(m).second)
                     this->size()++;
             }
         }
@@ -345,11 +465,9 @@ PkgActionHandler::do_results(Query& query, QueryResults * const results)
         /* disable stuff we've handled already */
         const bool re(options.regex());
         const bool ere(options.eregex());
-        const bool t(options.timer());
 
         options.set_regex(false);
         options.set_eregex(false);
-        options.set_timer(false);
 
         Query q;
         for (matches_type::iterator i = matches.begin() ;
@@ -367,7 +485,6 @@ PkgActionHandler::do_results(Query& query, QueryResults * const results)
 
         options.set_regex(re);
         options.set_eregex(ere);
-        options.set_timer(t);
     }
 }
 
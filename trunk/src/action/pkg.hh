@@ -40,8 +40,10 @@ class PkgActionHandler : public ActionHandler
 
         virtual const char * const id() const;
         virtual const char * const desc() const;
+        virtual ActionHandler *create() const;
         virtual const char * const usage() const;
         virtual void generate_completions(std::vector<std::string> *) const;
+        virtual void prepare();
 
     protected:
         virtual void do_init(Query& query, QueryResults * const results);
@@ -55,12 +57,18 @@ class PkgActionHandler : public ActionHandler
                 std::set<herdstat::portage::Metadata> * > matches_type;
 
         void add_matches(QueryResults * const results);
+        void find_candidates(const Query& query,
+                             std::vector<MetadataCache::ids_type> *ids);
+        void narrow_candidates(const std::string& criteria,
+                               MetadataCache::ids_type *ids);
         bool metadata_matches(const herdstat::portage::Metadata& meta,
-                              const std::string& criteria);
+                              const std::string& criteria,
+                              const herdstat::util::Regex& re);
 
         herdstat::util::ProgressMeter *_spinner;
         matches_type matches;
-        MetadataCache metacache;
+        /* shared with everybody else; see GlobalMetadataCache() */
+        MetadataCache& metacache;
         herdstat::util::Regex with;
         herdstat::portage::HerdsXML& herds_xml;
 };
@@ -25,6 +25,7 @@
 #endif
 
 #include "common.hh"
+#include "xmlinit.hh"
 #include "action/stats.hh"
 
 using namespace herdstat;
@@ -48,6 +49,12 @@ StatsActionHandler::desc() const
     return "Show herds.xml statistics.";
 }
 
+ActionHandler *
+StatsActionHandler::create() const
+{
+    return new StatsActionHandler();
+}
+
 Tab *
 StatsActionHandler::createTab(WidgetFactory *widgetFactory)
 {
@@ -62,6 +69,12 @@ StatsActionHandler::generate_completions(std::vector<std::string> *) const
 {
 }
 
+void
+StatsActionHandler::prepare()
+{
+    GlobalXMLInit();
+}
+
 void
 StatsActionHandler::do_regex(Query& query LIBHERDSTAT_UNUSED,
                              QueryResults * const results)
@@ -74,7 +87,7 @@ void
 StatsActionHandler::do_results(Query& query LIBHERDSTAT_UNUSED,
                                QueryResults * const results)
 {
-    BacktraceContext c("StatsActionHandler::do_results()");
+    TraceContext c("StatsActionHandler::do_results()");
 
     const bool quiet_save(options.quiet());
     options.set_quiet(false);
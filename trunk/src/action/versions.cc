@@ -30,6 +30,7 @@
 #include <herdstat/portage/version.hh>
 
 #include "common.hh"
+#include "ebuild_cache.hh"
 #include "overlay_display.hh"
 #include "action/versions.hh"
 
@@ -54,6 +55,19 @@ VersionsActionHandler::desc() const
     return "Show version information for the given package(s).";
 }
 
+ActionHandler *
+VersionsActionHandler::create() const
+{
+    return new VersionsActionHandler();
+}
+
+void
+VersionsActionHandler::prepare()
+{
+    PortageSearchActionHandler::prepare();
+    GlobalEbuildCache().update();
+}
+
 const char * const
 VersionsActionHandler::usage() const
 {
@@ -73,7 +87,7 @@ void
 VersionsActionHandler::do_results(Query& query,
                                   QueryResults * const results)
 {
-    BacktraceContext c("VersionsActionHandler::do_results()");
+    TraceContext c("VersionsActionHandler::do_results()");
 
     OverlayDisplay od(results);
 
@@ -85,13 +99,11 @@ VersionsActionHandler::do_results(Query& query,
         {
             try
             {
-                const std::vector<portage::Package>& res(find().results());
-                find()(q->second, spinner());
+                const std::vector<portage::Package>& res(find_pkg(q->second));
                 if (is_ambiguous(res))
                     throw portage::AmbiguousPkg(res.begin(), res.end());
 
                 matches.insert(matches.end(), res.begin(), res.end());
-                find().clear_results();
 
                 if (not options.overlay())
                 {
@@ -123,10 +135,14 @@ VersionsActionHandler::do_results(Query& query,
         }
     }
 
+    EbuildCache& ebuilds(GlobalEbuildCache());
+    ebuilds.update();
+
+    EbuildCache::keywords_type versions;
     std::vector<portage::Package>::iterator m;
     for (m = matches.begin() ; m != matches.end() ; ++m)
     {
-        const portage::KeywordsMap& versions(m->keywords());
+        ebuilds.keywords(*m, &versions);
 
         this->size() += versions.size();
 
@@ -142,17 +158,19 @@ VersionsActionHandler::do_results(Query& query,
                     std::back_inserter(*results),
                     util::compose_f_gx(
                         std::mem_fun_ref(&portage::VersionString::str),
-                        util::First<portage::KeywordsMap::value_type>()));
+                        util::First<EbuildCache::keywords_type::value_type>()));
         }
         else if (not options.count())
             results->transform(versions.begin(), versions.end(),
                 util::compose_f_gx(
                     std::mem_fun_ref(&portage::VersionString::str),
-                    util::First<portage::KeywordsMap::value_type>()));
+                    util::First<EbuildCache::keywords_type::value_type>()));
             
         if (not options.count() and ((m+1) != matches.end()))
             results->add_linebreak();
     }
+
+    ebuilds.save();
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
@@ -26,9 +26,9 @@
 
 #include <herdstat/util/functional.hh>
 #include <herdstat/portage/exceptions.hh>
-#include <herdstat/portage/package_which.hh>
 
 #include "common.hh"
+#include "ebuild_cache.hh"
 #include "action/which.hh"
 
 using namespace herdstat;
@@ -46,6 +46,19 @@ WhichActionHandler::desc() const
     return "Like which(1) but for ebuilds.  Gets the path to the latest ebuild for the given package.";
 }
 
+ActionHandler *
+WhichActionHandler::create() const
+{
+    return new WhichActionHandler();
+}
+
+void
+WhichActionHandler::prepare()
+{
+    PortageSearchActionHandler::prepare();
+    GlobalEbuildCache().update();
+}
+
 const char * const
 WhichActionHandler::usage() const
 {
@@ -65,7 +78,7 @@ void
 WhichActionHandler::do_results(Query& query,
                                QueryResults * const results)
 {
-    BacktraceContext c("WhichActionHandler::do_results()");
+    TraceContext c("WhichActionHandler::do_results()");
 
     this->size() = 0;
 
@@ -75,13 +88,11 @@ WhichActionHandler::do_results(Query& query,
         {
             try
             {
-                const std::vector<portage::Package>& res(find().results());
-                find()(q->second, spinner());
+                const std::vector<portage::Package>& res(find_pkg(q->second));
                 if (is_ambiguous(res))
                     throw portage::AmbiguousPkg(res.begin(), res.end());
 
                 matches.insert(matches.end(), res.begin(), res.end());
-                find().clear_results();
 
                 if (not options.overlay())
                 {
@@ -113,12 +124,23 @@ WhichActionHandler::do_results(Query& query,
         }
     }
 
-    portage::PackageWhich which;
-    const std::vector<std::string>& which_results(which(matches, spinner()));
-    std::copy(which_results.begin(), which_results.end(),
-            std::back_inserter(*results));
+    /* the latest ebuild of each is cached along with its directory's
+     * mtime, so this doesn't have to scan the directories again */
+    EbuildCache& ebuilds(GlobalEbuildCache());
+    ebuilds.update();
+
+    std::vector<portage::Package>::iterator m;
+    for (m = matches.begin() ; m != matches.end() ; ++m)
+    {
+        const std::string ebuild(ebuilds.latest(m->path()));
+        if (ebuild.empty())
+            continue;
+
+        results->add(ebuild);
+        ++this->size();
+    }
 
-    this->size() = which_results.size();
+    ebuilds.save();
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
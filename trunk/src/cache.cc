@@ -24,49 +24,62 @@
 # include "config.h"
 #endif
 
+#include <ctime>
+#include <algorithm>
+#include <herdstat/util/file.hh>
 #include <herdstat/util/string.hh>
-#include <herdstat/util/timer.hh>
 
 #include "common.hh"
+#include "fingerprint.hh"
+#include "profiler.hh"
 #include "cache.hh"
 
 using namespace herdstat;
 
 bool
-Cache::Header::is_valid(io::BinaryIStream& stream)
+Cache::Header::is_valid(const std::string& header, unsigned format,
+                        const std::string *fingerprint)
 {
     /* cache header is in the form of:
-     *  <version>:<portdir>:<overlays (comma separated)>:<size>
+     *  <version>:<format>:<portdir>:<overlays (comma separated)>:
+     *      <tree fingerprint>:<size>
      */
 
-    std::string header;
-    stream >> header;
-
     if (header.empty())
         return false;
 
     std::vector<std::string> parts;
     util::split(header, std::back_inserter(parts), ":", true);
-    if (parts.size() != 4)
+    if (parts.size() != 6)
         return false;
 
     const std::string& version(parts[0]);
-    const std::string& portdir(parts[1]);
-    const std::string& overlays(parts[2]);
-    const std::string& size(parts[3]);
+    const std::string& fmt(parts[1]);
+    const std::string& portdir(parts[2]);
+    const std::string& overlays(parts[3]);
+    const std::string& fp(parts[4]);
+    const std::string& size(parts[5]);
 
     /* only valid if cached version is equal to our version */
     if (version != VERSION)
         return false;
 
+    /* ...and the entries are in the format we expect */
+    if (fmt != util::stringify(format))
+        return false;
+
     /* only valid if the cache came from the current portdir */
-    if (portdir != _options.portdir())
+    if (portdir != _portdir)
         return false;
 
     /* likewise for overlays */
     std::vector<std::string> ovec;
     util::split(overlays, std::back_inserter(ovec), ",");
-    if (ovec != _options.overlays())
+    if (ovec != _overlays)
+        return false;
+
+    /* ...and nothing in the tree has changed since */
+    if (fingerprint and (fp != *fingerprint))
         return false;
 
     /* number of packages cached */
@@ -75,34 +88,104 @@ Cache::Header::is_valid(io::BinaryIStream& stream)
     return true;
 }
 
-void
-Cache::Header::dump(io::BinaryOStream& stream, std::size_t size)
+std::string
+Cache::Header::str(unsigned format, const std::string& fingerprint,
+                   std::size_t size)
 {
     _size = size;
-    stream << (std::string(VERSION)+":"+_options.portdir()+":"+
-        util::join(_options.overlays().begin(),
-                   _options.overlays().end(), ",")+":"+
-        util::stringify(_size));
+    return (std::string(VERSION)+":"+util::stringify(format)+":"+
+        _portdir+":"+
+        util::join(_overlays.begin(), _overlays.end(), ",")+":"+
+        fingerprint+":"+util::stringify(_size));
+}
+
+std::string
+Cache::shard_path(const std::string& base, const std::string& repo)
+{
+    std::string suffix(repo);
+    std::replace(suffix.begin(), suffix.end(), '/', '_');
+    return base+"."+suffix;
+}
+
+const std::string&
+Cache::fingerprint()
+{
+    if (not _have_fingerprint)
+    {
+        if (this->uses_tree())
+            _fingerprint = tree_fingerprint(_portdir, _overlays,
+                    _options.metacache_threads(), this->uses_packages());
+        _have_fingerprint = true;
+    }
+
+    return _fingerprint;
+}
+
+bool
+Cache::is_fresh() const
+{
+    profile_count(Profiler::STATS);
+    const util::Stat st(_path);
+    if (not st.exists() or (st.size() == 0))
+        return false;
+
+    const std::string& expire(_options.metacache_expire());
+    if (expire == "lastsync")
+        return true;
+
+    /* otherwise, treat it as a long int */
+    return ((std::time(NULL) - st.mtime()) < util::destringify<long>(expire));
+}
+
+bool
+Cache::is_current()
+{
+    TraceContext c("Cache::is_current("+_path+")");
+    ProfileScope p("cache validation", this->name());
+
+    if (not _loaded)
+        return false;
+
+    bool current;
+    if (not this->uses_tree())
+        current = this->do_is_current();
+    else if (_options.metacache_expire() != "lastsync")
+        current = this->is_fresh();
+    else
+    {
+        const std::string old(this->fingerprint());
+        _have_fingerprint = false;
+        current = (this->fingerprint() == old);
+    }
+
+    debug_msg("%s cache is current? %d", this->name(), current);
+
+    return current;
 }
 
 bool
 Cache::is_valid()
 {
-    BacktraceContext c("Cache::is_valid("+_path+")");
+    TraceContext c("Cache::is_valid("+_path+")");
+    ProfileScope p("cache validation", this->name());
 
     bool valid = false;
 
-    if (this->do_is_valid())
+    /* opened separately, since a derivative may still be using the file
+     * it loaded */
+    if (this->do_is_valid() and _next->open(_path))
     {
-        _stream.open(_path);
-        if (not _stream)
-            throw FileException(_path);
+        const bool by_tree = (this->uses_tree() and
+                (_options.metacache_expire() == "lastsync"));
 
-        valid = _header.is_valid(_stream);
+        valid = (_header.is_valid(_next->header(), this->format(),
+                    by_tree ? &this->fingerprint() : NULL) and
+                 (_next->fields() == this->record_fields()) and
+                 this->do_check(*_next));
 
-        /* if valid, keep stream open for load() to use */
+        /* if valid, keep it mapped for load() to use */
         if (not valid)
-            _stream.close();
+            _next->close();
     }
 
     debug_msg("%s cache is valid? %d",
@@ -111,62 +194,97 @@ Cache::is_valid()
     return valid;
 }
 
+bool
+Cache::open_stale(CacheFileReader& file)
+{
+    TraceContext c("Cache::open_stale("+_path+")");
+    return this->open_compatible(_path, file);
+}
+
+bool
+Cache::open_journal(CacheFileReader& file)
+{
+    TraceContext c("Cache::open_journal("+_path+")");
+    return this->open_compatible(this->journal_path(), file);
+}
+
+bool
+Cache::open_compatible(const std::string& path, CacheFileReader& file)
+{
+    if (not file.open(path))
+        return false;
+
+    /* any fingerprint will do: a stale cache is opened because the tree has
+     * most likely changed, and journal records are keyed on their own files */
+    Header header(_portdir, _overlays);
+    if (header.is_valid(file.header(), this->format(), NULL) and
+        (file.fields() == this->record_fields()) and
+        this->do_check(file))
+        return true;
+
+    file.close();
+    return false;
+}
+
 void
 Cache::fill()
 {
-    BacktraceContext c("Cache::fill("+_path+")");
-
-    util::Timer timer;
-    if (_options.timer())
-        timer.start();
+    TraceContext c("Cache::fill("+_path+")");
+    ProfileScope p("cache fill", this->name());
 
     this->do_fill();
-
-    if (_options.timer())
-    {
-        timer.stop();
-        _options.outstream() << "Took " << timer.elapsed()
-            << "ms to fill the " << this->name() << " cache." << std::endl;
-    }
+    _loaded = true;
 }
 
 void
 Cache::load()
 {
-    BacktraceContext c("Cache::load("+_path+")");
+    TraceContext c("Cache::load("+_path+")");
 
-    assert(_stream.is_open());
+    assert(_next->is_open());
+    ProfileScope p("cache load", this->name());
 
-    util::Timer timer;
-    if (_options.timer())
-        timer.start();
-
-    this->do_load(_stream);
+    /* the derivative lets go of the old file in do_load() */
+    std::swap(_file, _next);
+    this->do_load(*_file);
+    _next->close();
+    _loaded = true;
+}
 
-    if (_options.timer())
-    {
-        timer.stop();
-        _options.outstream() << "Took " << timer.elapsed()
-            << "ms to load the " << this->name() << " cache." << std::endl;
-    }
+void
+Cache::unload()
+{
+    TraceContext c("Cache::unload("+_path+")");
 
-    _stream.close();
+    this->do_unload();
+    _file->close();
+    _loaded = false;
 }
 
 void
 Cache::dump()
 {
-    BacktraceContext c("Cache::dump("+_path+")");
-
-    assert(not _stream.is_open());
-
-    io::BinaryOStream stream(_path);
-    if (not stream)
-        throw FileException(_path);
-
-    _header.dump(stream, this->cache_size());
+    TraceContext c("Cache::dump("+_path+")");
+    ProfileScope p("cache dump", this->name());
+
+    CacheFileWriter file(_path,
+        _header.str(this->format(), this->fingerprint(), this->cache_size()),
+        this->record_fields());
+    this->do_dump(file);
+    file.close();
+}
 
-    this->do_dump(stream);
+void
+Cache::dump_journal()
+{
+    TraceContext c("Cache::dump_journal("+_path+")");
+    ProfileScope p("cache dump", this->name());
+
+    CacheFileWriter file(this->journal_path(),
+        _header.str(this->format(), this->fingerprint(), this->cache_size()),
+        this->record_fields());
+    this->do_dump_journal(file);
+    file.close();
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
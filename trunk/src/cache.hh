@@ -28,14 +28,19 @@
 #endif
 
 #include <herdstat/noncopyable.hh>
-#include <herdstat/io/binary_stream.hh>
 #include "common.hh"
+#include "cache_file.hh"
 
 class Cache : private herdstat::Noncopyable
 {
     public:
         virtual ~Cache() throw() { }
 
+        /**
+         * Is the cache file there and valid?  If so, it's left mapped for
+         * load().  Whatever was loaded before stays mapped until then, so
+         * it's safe to call while a derivative still refers to it.
+         */
         bool is_valid();
         void fill();
         void load();
@@ -45,40 +50,160 @@ class Cache : private herdstat::Noncopyable
 
         inline const std::string& path() const { return _path; }
 
+        /// Has the cache been loaded or filled yet?
+        inline bool is_loaded() const { return _loaded; }
+
+        /**
+         * Is what we loaded or filled still current?  Only stats things:
+         * for caches derived from the tree, it recomputes the tree
+         * fingerprint (or checks the age of the cache file if
+         * metacache_expire is a number of seconds); for the others,
+         * do_is_current() decides.
+         */
+        bool is_current();
+
     protected:
+        /// Cache covering PORTDIR and every overlay.
         Cache(const std::string& path)
-            : _options(GlobalOptions()), _path(path), _header(), _stream() { }
+            : _options(GlobalOptions()), _path(path),
+              _portdir(_options.portdir()), _overlays(_options.overlays()),
+              _header(_portdir, _overlays), _readers(), _file(&_readers[0]),
+              _next(&_readers[1]), _fingerprint(), _have_fingerprint(false),
+              _loaded(false) { }
+
+        /// Cache covering a single repository (a shard).
+        Cache(const std::string& path, const std::string& repo)
+            : _options(GlobalOptions()), _path(path),
+              _portdir(repo), _overlays(),
+              _header(_portdir, _overlays), _readers(), _file(&_readers[0]),
+              _next(&_readers[1]), _fingerprint(), _have_fingerprint(false),
+              _loaded(false) { }
+
+        /**
+         * Path of the shard of a cache for the given repository.
+         * @param base Path of the unsharded cache.
+         * @param repo Repository path.
+         * @returns base.<repo with '/' replaced by '_'>
+         */
+        static std::string shard_path(const std::string& base,
+                                      const std::string& repo);
 
         virtual std::size_t cache_size() const = 0;
+        /// Number of fields in each record.
+        virtual std::size_t record_fields() const = 0;
         virtual const char * const name() const = 0;
+        /// On-disk format version; bump when the entry format changes.
+        virtual unsigned format() const { return 1; }
+        /// Is the cache derived from the portage tree?  If so, it's keyed
+        /// on the tree's fingerprint.
+        virtual bool uses_tree() const { return true; }
+        /// Does the fingerprint need to cover each package (in trees
+        /// without a metadata/timestamp; see tree_fingerprint)?
+        virtual bool uses_packages() const { return false; }
         virtual bool do_is_valid() = 0;
+        /// Have the sources of a (loaded) cache that doesn't use the tree
+        /// changed?
+        virtual bool do_is_current() { return true; }
+        /// Extra validity checks on an opened cache whose header is valid.
+        virtual bool do_check(const CacheFileReader& file LIBHERDSTAT_UNUSED)
+        { return true; }
         virtual void do_fill() = 0;
-        virtual void do_load(herdstat::io::BinaryIStream& stream) = 0;
-        virtual void do_dump(herdstat::io::BinaryOStream& stream) = 0;
+        /// The file stays mapped after load(), so derivatives are free to
+        /// hold on to it and decode records as they're needed.
+        virtual void do_load(const CacheFileReader& file) = 0;
+        virtual void do_dump(CacheFileWriter& file) = 0;
+        /// Write the records that go in the journal (see dump_journal()).
+        virtual void do_dump_journal(CacheFileWriter& file LIBHERDSTAT_UNUSED)
+        { }
+        /// Forget whatever was loaded or filled (see unload()).
+        virtual void do_unload() { }
+
+        /**
+         * Drop what was loaded or filled, for a cache that's no longer
+         * current and won't be refilled just yet.
+         */
+        void unload();
 
         inline const std::size_t& header_size() const { return _header.size(); }
 
+        /**
+         * Open the existing (possibly expired) cache for reading, so a
+         * derivative can reuse what's still current when refilling.
+         * @param stream Stream to open.
+         * @returns True if the cache exists and has a compatible header.
+         */
+        bool open_stale(CacheFileReader& file);
+
+        /// Path of the cache's journal: records that haven't been merged
+        /// into the cache file yet, for derivatives that add them a few
+        /// at a time.
+        inline std::string journal_path() const { return _path+".journal"; }
+
+        /**
+         * Open the journal for reading.
+         * @param file Reader to open it with.
+         * @returns True if it exists and has a compatible header.
+         */
+        bool open_journal(CacheFileReader& file);
+
+        /**
+         * Write the journal (see do_dump_journal()) instead of the whole
+         * cache.  Throws FileException on failure, like dump().
+         */
+        void dump_journal();
+
+        /**
+         * Is the cache file there and, if metacache_expire is a number of
+         * seconds, younger than that?  (With "lastsync", the tree
+         * fingerprint in the header decides instead.)
+         */
+        bool is_fresh() const;
+
         const Options& _options;
 
     private:
         class Header
         {
             public:
-                Header() : _options(GlobalOptions()), _size(0) { }
-
-                bool is_valid(herdstat::io::BinaryIStream& stream);
-                void dump(herdstat::io::BinaryOStream& stream,
-                          std::size_t size);
+                Header(const std::string& portdir,
+                       const std::vector<std::string>& overlays)
+                    : _portdir(portdir), _overlays(overlays), _size(0) { }
+
+                /**
+                 * @param fingerprint Tree fingerprint to compare against,
+                 * or NULL to accept any.
+                 */
+                bool is_valid(const std::string& header, unsigned format,
+                              const std::string *fingerprint);
+                std::string str(unsigned format,
+                                const std::string& fingerprint,
+                                std::size_t size);
                 const std::size_t& size() const { return _size; }
 
             private:
-                const Options& _options;
+                const std::string& _portdir;
+                const std::vector<std::string>& _overlays;
                 std::size_t _size;
         };
 
+        /// open_stale() and open_journal().
+        bool open_compatible(const std::string& path, CacheFileReader& file);
+
+        /// Tree fingerprint (computed once, when first needed).
+        const std::string& fingerprint();
+
         std::string _path;
+        /* what the cache covers */
+        const std::string _portdir;
+        const std::vector<std::string> _overlays;
         Header _header;
-        herdstat::io::BinaryIStream _stream;
+        /* the file load() mapped, and the one is_valid() last opened */
+        CacheFileReader _readers[2];
+        CacheFileReader *_file;
+        CacheFileReader *_next;
+        std::string _fingerprint;
+        bool _have_fingerprint;
+        bool _loaded;
 };
 
 #endif /* _HAVE_SRC_CACHE_HH */
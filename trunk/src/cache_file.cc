@@ -0,0 +1,236 @@
+/*
+ * herdstat -- src/cache_file.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <fstream>
+#include <cassert>
+#include <cstdio>
+#include <unistd.h>
+
+#include <herdstat/exceptions.hh>
+#include <herdstat/util/string.hh>
+#include "cache_file.hh"
+
+#define CACHE_FILE_MAGIC    0x32435348 /* "HSC2" */
+
+static inline std::size_t
+padded(std::size_t n)
+{
+    return ((n + 3) & ~static_cast<std::size_t>(3));
+}
+
+static inline uint32_t
+read_u32(const char *p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+CacheFileReader::CacheFileReader()
+    : _file(), _header(), _tables()
+{
+}
+
+bool
+CacheFileReader::open(const std::string& path)
+{
+    this->close();
+
+    if (not _file.open(path))
+        return false;
+
+    const char *data = _file.data();
+    const std::size_t size = _file.size();
+
+    /* magic + header length */
+    if ((size < 8) or (read_u32(data) != CACHE_FILE_MAGIC))
+    {
+        this->close();
+        return false;
+    }
+
+    std::size_t pos = 8;
+    const std::size_t hlen = read_u32(data + 4);
+    if ((hlen > size) or ((pos + padded(hlen) + 4) > size))
+    {
+        this->close();
+        return false;
+    }
+
+    _header.assign(data + pos, hlen);
+    pos += padded(hlen);
+
+    const std::size_t ntables = read_u32(data + pos);
+    pos += 4;
+    if ((ntables == 0) or (ntables > ((size - pos) / 8)))
+    {
+        this->close();
+        return false;
+    }
+
+    const char *dims = data + pos;
+    pos += ntables * 8;
+
+    /* make sure the tables and everything they point to are inside the
+     * file, so CacheTable::field() never has to check */
+    std::size_t nentries = 0;
+    for (std::size_t t = 0 ; t != ntables ; ++t)
+    {
+        const std::size_t nrecords = read_u32(dims + (t * 8));
+        const std::size_t nfields = read_u32(dims + (t * 8) + 4);
+        const std::size_t n = nrecords * nfields;
+
+        if ((nfields == 0) or (n / nfields != nrecords) or
+            (n > (((size - pos) / 8) - nentries)))
+        {
+            this->close();
+            return false;
+        }
+
+        nentries += n;
+    }
+
+    const uint32_t *table = reinterpret_cast<const uint32_t *>(data + pos);
+    const char *blob = data + pos + (nentries * 8);
+    const std::size_t blob_size = size - (pos + (nentries * 8));
+
+    for (std::size_t i = 0 ; i != nentries ; ++i)
+    {
+        const std::size_t off = table[i*2], len = table[(i*2)+1];
+        if ((off > blob_size) or (len > (blob_size - off)))
+        {
+            this->close();
+            return false;
+        }
+    }
+
+    for (std::size_t t = 0 ; t != ntables ; ++t)
+    {
+        const std::size_t nrecords = read_u32(dims + (t * 8));
+        const std::size_t nfields = read_u32(dims + (t * 8) + 4);
+
+        _tables.push_back(CacheTable(table, blob, nrecords, nfields));
+        table += nrecords * nfields * 2;
+    }
+
+    return true;
+}
+
+void
+CacheFileReader::close()
+{
+    _file.close();
+    _header.clear();
+    _tables.clear();
+}
+
+CacheFileWriter::CacheFileWriter(const std::string& path,
+                                 const std::string& header,
+                                 std::size_t fields)
+    : _path(path), _header(header), _tables(), _blob()
+{
+    this->add_table(fields);
+}
+
+std::size_t
+CacheFileWriter::add_table(std::size_t fields)
+{
+    assert(fields > 0);
+    _tables.push_back(Table(fields));
+    return (_tables.size() - 1);
+}
+
+void
+CacheFileWriter::add(std::size_t table, const std::vector<std::string>& record)
+{
+    assert(table < _tables.size());
+    assert(record.size() == _tables[table].fields);
+
+    std::vector<uint32_t>& entries(_tables[table].entries);
+
+    std::vector<std::string>::const_iterator i;
+    for (i = record.begin() ; i != record.end() ; ++i)
+    {
+        entries.push_back(_blob.size());
+        entries.push_back(i->size());
+        _blob.append(*i);
+    }
+}
+
+void
+CacheFileWriter::close()
+{
+    /* unique per process, so batch workers filling the same cache at
+     * once can't clobber each other's half-written file */
+    const std::string tmp(_path+".tmp."+herdstat::util::stringify(::getpid()));
+
+    std::ofstream stream(tmp.c_str(), std::ios::binary|std::ios::trunc);
+    if (not stream)
+        throw herdstat::FileException(tmp);
+
+    uint32_t v[2];
+
+    v[0] = CACHE_FILE_MAGIC;
+    v[1] = _header.size();
+    stream.write(reinterpret_cast<const char *>(v), sizeof(v));
+    stream.write(_header.data(), _header.size());
+    stream.write("\0\0\0", padded(_header.size()) - _header.size());
+
+    v[0] = _tables.size();
+    stream.write(reinterpret_cast<const char *>(v), sizeof(v[0]));
+
+    std::vector<Table>::const_iterator t;
+    for (t = _tables.begin() ; t != _tables.end() ; ++t)
+    {
+        v[0] = t->entries.size() / (t->fields * 2);
+        v[1] = t->fields;
+        stream.write(reinterpret_cast<const char *>(v), sizeof(v));
+    }
+
+    for (t = _tables.begin() ; t != _tables.end() ; ++t)
+    {
+        if (not t->entries.empty())
+            stream.write(reinterpret_cast<const char *>(&t->entries[0]),
+                         t->entries.size() * sizeof(uint32_t));
+    }
+
+    stream.write(_blob.data(), _blob.size());
+
+    stream.close();
+    if (not stream)
+    {
+        std::remove(tmp.c_str());
+        throw herdstat::FileException(tmp);
+    }
+
+    if (std::rename(tmp.c_str(), _path.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        throw herdstat::FileException(_path);
+    }
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
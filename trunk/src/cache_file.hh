@@ -0,0 +1,246 @@
+/*
+ * herdstat -- src/cache_file.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_CACHE_FILE_HH
+#define _HAVE_SRC_CACHE_FILE_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <stdint.h>
+#include <herdstat/noncopyable.hh>
+
+#include "mapped_file.hh"
+
+/*
+ * On-disk cache format.  All integers are 32-bit in host byte order (the
+ * cache is never shared between machines):
+ *
+ *   magic         "HSC2"
+ *   header_len    length of header string
+ *   header        Cache::Header string, padded to a multiple of 4
+ *   ntables       number of record tables
+ *   ntables * { nrecords, nfields }
+ *   ntables * table, each nrecords * nfields * { offset, length } into blob
+ *   blob          field data (not NUL-terminated)
+ *
+ * Table 0 holds the cache entries; derivatives may add more tables (e.g.
+ * indexes) after it.  Since every record in a table is the same size,
+ * record n's fields can be found without looking at any other record.
+ */
+
+/**
+ * @class CacheField
+ * @brief A field of a cache record, pointing into the mapped file.
+ */
+
+class CacheField
+{
+    public:
+        CacheField() : _data(NULL), _size(0) { }
+        CacheField(const char *data, std::size_t size)
+            : _data(data), _size(size) { }
+
+        const char *data() const { return _data; }
+        std::size_t size() const { return _size; }
+        bool empty() const { return (_size == 0); }
+        std::string str() const { return std::string(_data, _size); }
+
+        bool operator== (const std::string& s) const
+        {
+            return ((s.size() == _size) and
+                    (std::memcmp(s.data(), _data, _size) == 0));
+        }
+        bool operator!= (const std::string& s) const
+        { return not (*this == s); }
+
+        /// Lexicographical comparison (like std::string::compare).
+        int compare(const std::string& s) const
+        {
+            const int r = std::memcmp(_data, s.data(), std::min(_size, s.size()));
+            if (r != 0)
+                return r;
+            return ((_size < s.size()) ? -1 : (_size > s.size()) ? 1 : 0);
+        }
+
+    private:
+        const char *_data;
+        std::size_t _size;
+};
+
+/**
+ * Encode record numbers as a field (an array of uint32_t's), for index
+ * tables.
+ * @param ids Record numbers.
+ * @returns Field data.
+ */
+inline std::string
+encode_ids(const std::vector<uint32_t>& ids)
+{
+    if (ids.empty())
+        return std::string();
+
+    return std::string(reinterpret_cast<const char *>(&ids[0]),
+                       ids.size() * sizeof(uint32_t));
+}
+
+/**
+ * Decode record numbers encoded by encode_ids().
+ * @param field Field to decode.
+ * @param ids Vector to store them in.
+ */
+inline void
+decode_ids(const CacheField& field, std::vector<uint32_t> *ids)
+{
+    const std::size_t n = field.size() / sizeof(uint32_t);
+    ids->resize(n);
+    /* the field isn't necessarily aligned */
+    if (n)
+        std::memcpy(&(*ids)[0], field.data(), n * sizeof(uint32_t));
+}
+
+/**
+ * @class CacheTable
+ * @brief A table of fixed-size records in a mapped cache file.
+ */
+
+class CacheTable
+{
+    public:
+        CacheTable() : _table(NULL), _blob(NULL), _size(0), _fields(0) { }
+        CacheTable(const uint32_t *table, const char *blob,
+                   std::size_t size, std::size_t fields)
+            : _table(table), _blob(blob), _size(size), _fields(fields) { }
+
+        /// Number of records.
+        std::size_t size() const { return _size; }
+        /// Number of fields per record.
+        std::size_t fields() const { return _fields; }
+
+        /// Get field n of the given record.
+        CacheField field(std::size_t record, std::size_t n) const
+        {
+            const uint32_t *entry = _table + (((record * _fields) + n) * 2);
+            return CacheField(_blob + entry[0], entry[1]);
+        }
+
+    private:
+        const uint32_t *_table;
+        const char *_blob;
+        std::size_t _size;
+        std::size_t _fields;
+};
+
+/**
+ * @class CacheFileReader
+ * @brief Read-only view of a mapped cache file.
+ */
+
+class CacheFileReader : private herdstat::Noncopyable
+{
+    public:
+        CacheFileReader();
+
+        /**
+         * Map the given cache file.
+         * @param path Path to cache file.
+         * @returns False if the file doesn't exist or is malformed.
+         */
+        bool open(const std::string& path);
+        void close();
+
+        bool is_open() const { return _file.is_open(); }
+        const std::string& header() const { return _header; }
+
+        /// Number of tables.
+        std::size_t tables() const { return _tables.size(); }
+        /// Get the given table.
+        const CacheTable& table(std::size_t n) const { return _tables[n]; }
+
+        /* shortcuts for the entries table (table 0) */
+        std::size_t size() const { return _tables.front().size(); }
+        std::size_t fields() const { return _tables.front().fields(); }
+        CacheField field(std::size_t record, std::size_t n) const
+        { return _tables.front().field(record, n); }
+
+    private:
+        MappedFile _file;
+        std::string _header;
+        std::vector<CacheTable> _tables;
+};
+
+/**
+ * @class CacheFileWriter
+ * @brief Writes a cache file.  Nothing is written until close() is called,
+ * at which point the existing file is atomically replaced (so any reader
+ * that still has it mapped is unaffected).
+ */
+
+class CacheFileWriter : private herdstat::Noncopyable
+{
+    public:
+        /// Create a writer whose entries table has the given number of
+        /// fields per record.
+        CacheFileWriter(const std::string& path,
+                        const std::string& header,
+                        std::size_t fields);
+
+        /**
+         * Add another table.
+         * @param fields Number of fields per record.
+         * @returns Table number.
+         */
+        std::size_t add_table(std::size_t fields);
+
+        /// Append a record to the entries table.
+        void add(const std::vector<std::string>& record)
+        { this->add(0, record); }
+        /// Append a record to the given table; must have exactly as many
+        /// fields as the table was created with.
+        void add(std::size_t table, const std::vector<std::string>& record);
+
+        /// Write the file; throws FileException on failure.
+        void close();
+
+    private:
+        struct Table
+        {
+            Table(std::size_t f) : fields(f), entries() { }
+
+            std::size_t fields;
+            std::vector<uint32_t> entries;
+        };
+
+        std::string _path;
+        std::string _header;
+        std::vector<Table> _tables;
+        std::string _blob;
+};
+
+#endif /* _HAVE_SRC_CACHE_FILE_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -64,7 +64,7 @@ debug_msg(const char *fmt, ...)
 static void
 do_fetch(const char * const url, const char * const file)
 {
-    BacktraceContext c("do_fetch()");
+    TraceContext c("do_fetch()");
 
     const Options& options(GlobalOptions());
     util::Stat xml(file);
@@ -118,7 +118,7 @@ do_fetch(const char * const url, const char * const file)
 void
 fetch_devawayxml()
 {
-    BacktraceContext c("fetch_devawayxml()");
+    TraceContext c("fetch_devawayxml()");
     const Options& options(GlobalOptions());
     if (options.devawayxml().empty())
         do_fetch(DEVAWAYXML_REMOTE, DEVAWAYXML_LOCAL);
@@ -127,12 +127,35 @@ fetch_devawayxml()
 void
 fetch_herdsxml()
 {
-    BacktraceContext c("fetch_herdsxml()");
+    TraceContext c("fetch_herdsxml()");
     const Options& options(GlobalOptions());
     if (options.herdsxml().empty())
         do_fetch(HERDSXML_REMOTE, HERDSXML_LOCAL);
 }
 
+std::string
+herdsxml_path()
+{
+    const Options& options(GlobalOptions());
+    return (options.herdsxml().empty() ? HERDSXML_LOCAL : options.herdsxml());
+}
+
+std::string
+devawayxml_path()
+{
+    const Options& options(GlobalOptions());
+    return (options.devawayxml().empty() ?
+            DEVAWAYXML_LOCAL : options.devawayxml());
+}
+
+std::string
+daemon_socket_path()
+{
+    const Options& options(GlobalOptions());
+    return (options.socket().empty() ?
+            options.localstatedir()+"/herdstatd.sock" : options.socket());
+}
+
 portage::HerdsXML&
 GlobalHerdsXML()
 {
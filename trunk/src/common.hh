@@ -43,7 +43,6 @@
 #endif
 
 #define USE_XMLWRAPP
-#define LASTSYNC        /*LOCALSTATEDIR*/"/lastsync"
 
 #ifndef HAVE_STRDUP
 # define strdup(x) herdstat::util::strdup(x)
@@ -54,6 +53,12 @@ typedef std::vector<std::string> opts_type;
 void debug_msg(const char *, ...);
 void fetch_devawayxml();
 void fetch_herdsxml();
+/// Path to the herds.xml in use (either user-specified or the fetched copy).
+std::string herdsxml_path();
+/// Likewise for devaway.xml.
+std::string devawayxml_path();
+/// Path to the UNIX socket herdstatd listens on.
+std::string daemon_socket_path();
 
 herdstat::portage::HerdsXML& GlobalHerdsXML();
 herdstat::portage::DevawayXML& GlobalDevawayXML();
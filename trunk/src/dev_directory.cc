@@ -0,0 +1,172 @@
+/*
+ * herdstat -- src/dev_directory.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include "common.hh"
+#include "xml_cache.hh"
+#include "dev_directory.hh"
+
+using namespace herdstat;
+using namespace herdstat::portage;
+
+/* fill in whatever fields 'to' doesn't already have */
+#define MERGE(x) if (to->x().empty()) to->set_##x(from.x())
+
+static void
+merge_developer(const Developer& from, Developer *to)
+{
+    MERGE(email);
+    MERGE(name);
+    MERGE(pgpkey);
+    MERGE(joined);
+    MERGE(birthday);
+    MERGE(status);
+    MERGE(role);
+    MERGE(location);
+    MERGE(awaymsg);
+}
+
+#undef MERGE
+
+static std::string
+user_of(const std::string& s)
+{
+    const std::string::size_type pos = s.find('@');
+    return (pos == std::string::npos ? s : s.substr(0, pos));
+}
+
+DeveloperDirectory::DeveloperDirectory()
+    : _lock(), _generation(0), _entries()
+{
+}
+
+void
+DeveloperDirectory::build()
+{
+    TraceContext c("DeveloperDirectory::build()");
+
+    _entries.clear();
+
+    /* same order as calling herds.xml, devaway.xml and then userinfo.xml's
+     * fill_developer(), so the first document to define a field wins */
+
+    const Herds& herds(GlobalHerdsXML().herds());
+    for (Herds::const_iterator h = herds.begin() ; h != herds.end() ; ++h)
+    {
+        for (Herd::const_iterator d = h->begin() ; d != h->end() ; ++d)
+        {
+            Entry& entry(_entries[d->user()]);
+            if (entry.dev.user().empty())
+                entry.dev.set_user(d->user());
+            merge_developer(*d, &entry.dev);
+            entry.dev.append_herd(h->name());
+        }
+    }
+
+    const Developers& away(GlobalDevawayXML().devs());
+    for (Developers::const_iterator d = away.begin() ; d != away.end() ; ++d)
+    {
+        Entry& entry(_entries[d->user()]);
+        if (entry.dev.user().empty())
+            entry.dev.set_user(d->user());
+        merge_developer(*d, &entry.dev);
+        entry.dev.set_away(true);
+        entry.away = true;
+    }
+
+    const Developers& info(GlobalUserinfoXML().devs());
+    for (Developers::const_iterator d = info.begin() ; d != info.end() ; ++d)
+    {
+        Entry& entry(_entries[d->user()]);
+        if (entry.dev.user().empty())
+            entry.dev.set_user(d->user());
+        merge_developer(*d, &entry.dev);
+        entry.userinfo = true;
+    }
+
+    _generation = xml_generation();
+
+    debug_msg("built developer directory with %d entries", _entries.size());
+}
+
+bool
+DeveloperDirectory::stale() const
+{
+    return (_generation != xml_generation());
+}
+
+void
+DeveloperDirectory::update()
+{
+    MutexLock l(_lock);
+
+    if (this->stale())
+        this->build();
+}
+
+bool
+DeveloperDirectory::find(const std::string& user, Entry *entry)
+{
+    MutexLock l(_lock);
+
+    if (this->stale())
+        this->build();
+
+    const Entry *e = _entries.find(user_of(user));
+    if (not e)
+        return false;
+
+    *entry = *e;
+    return true;
+}
+
+bool
+DeveloperDirectory::fill(Developer& dev)
+{
+    Entry entry;
+    if (not this->find(dev.user(), &entry))
+        return false;
+
+    merge_developer(entry.dev, &dev);
+
+    const std::vector<std::string>& herds(entry.dev.herds());
+    std::vector<std::string>::const_iterator i;
+    for (i = herds.begin() ; i != herds.end() ; ++i)
+        dev.append_herd(*i);
+
+    if (entry.away)
+        dev.set_away(true);
+
+    return true;
+}
+
+DeveloperDirectory&
+GlobalDeveloperDirectory()
+{
+    static DeveloperDirectory d;
+    return d;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
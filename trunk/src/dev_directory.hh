@@ -0,0 +1,100 @@
+/*
+ * herdstat -- src/dev_directory.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_DEV_DIRECTORY_HH
+#define _HAVE_SRC_DEV_DIRECTORY_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <herdstat/noncopyable.hh>
+#include <herdstat/portage/developer.hh>
+
+#include "hash_map.hh"
+#include "threads.hh"
+
+/**
+ * @class DeveloperDirectory
+ * @brief Everything we know about each developer, joined from herds.xml,
+ * devaway.xml and userinfo.xml.  Replaces calling each document's
+ * fill_developer() (which walks every herd) once per developer.
+ */
+
+class DeveloperDirectory : private herdstat::Noncopyable
+{
+    public:
+        struct Entry
+        {
+            Entry() : dev(), userinfo(false), away(false) { }
+
+            /// Developer with herds, away message and userinfo filled in.
+            herdstat::portage::Developer dev;
+            /// Is the developer listed in userinfo.xml?
+            bool userinfo;
+            /// Is the developer listed in devaway.xml?
+            bool away;
+        };
+
+        DeveloperDirectory();
+
+        /**
+         * (Re)build the directory if any of the XML documents have been
+         * (re)parsed since it was last built.  find() and fill() do this
+         * anyway; it's safe to call from concurrent queries.
+         */
+        void update();
+
+        /**
+         * Find a developer.  The directory is (re)built first if any of the
+         * XML documents have been (re)parsed since it was last built.  The
+         * entry is copied, since a concurrent query may rebuild the
+         * directory once the lock is released.
+         * @param user Developer's user name (anything after '@' is ignored).
+         * @param entry Entry to assign the developer's entry to.
+         * @returns true if anything is known about the developer.
+         */
+        bool find(const std::string& user, Entry *entry);
+
+        /**
+         * Fill in a developer like each document's fill_developer() would.
+         * @param dev Developer object (user must be set).
+         * @returns true if the developer was found.
+         */
+        bool fill(herdstat::portage::Developer& dev);
+
+    private:
+        /* _lock must be held */
+        void build();
+        bool stale() const;
+
+        Mutex _lock;
+        unsigned long _generation;
+        HashMap<Entry> _entries;
+};
+
+/// Directory of the global XML documents.
+DeveloperDirectory& GlobalDeveloperDirectory();
+
+#endif /* _HAVE_SRC_DEV_DIRECTORY_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
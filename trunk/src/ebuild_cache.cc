@@ -0,0 +1,693 @@
+/*
+ * herdstat -- src/ebuild_cache.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <dirent.h>
+#include <map>
+#include <iterator>
+#include <algorithm>
+#include <cstdio>
+#include <herdstat/exceptions.hh>
+#include <herdstat/util/file.hh>
+#include <herdstat/util/string.hh>
+#include <herdstat/portage/version.hh>
+
+#include "common.hh"
+#include "profiler.hh"
+#include "tree_cache.hh"
+#include "package_cache.hh"
+#include "version_key.hh"
+#include "ebuild_cache.hh"
+
+#define EBUILDCACHE         /*LOCALSTATEDIR*/"/ebuildcache"
+
+/*
+ * Each record is:
+ *   path, mtime, size, LICENSE, HOMEPAGE, DESCRIPTION, KEYWORDS
+ *
+ * sorted by path, followed by the package listings table:
+ *   1: directory, mtime, ebuild file names (oldest version first)
+ *
+ * sorted by directory.
+ */
+
+#define EBUILD_FIELDS       7
+#define LISTING_TABLE       1
+#define LISTING_FIELDS      3
+#define NTABLES             2
+
+#define NVARS               4
+#define KEYWORDS_VAR        3
+
+/*
+ * What's added since the cache file was written is saved to the journal
+ * instead, until it holds more records than this or an eighth of the cache
+ * file, whichever is more.  Saving after a query that read a handful of
+ * ebuilds therefore doesn't mean rewriting the whole cache.
+ */
+#define JOURNAL_MIN         1024
+
+using namespace herdstat;
+using namespace herdstat::portage;
+
+static const char * const vars[NVARS] =
+    { "LICENSE", "HOMEPAGE", "DESCRIPTION", "KEYWORDS" };
+
+typedef std::vector<std::string> record_type;
+/* records keyed on path */
+typedef std::map<std::string, record_type> sorted_type;
+
+EbuildCache::EbuildCache()
+    : Cache(GlobalOptions().localstatedir()+EBUILDCACHE),
+      _lock(), _records(NULL), _journal(), _entries(), _listings(),
+      _dirty(false), _prune(false)
+{
+}
+
+const char * const
+EbuildCache::name() const
+{
+    return "ebuild";
+}
+
+unsigned
+EbuildCache::format() const
+{
+    return 2;
+}
+
+std::size_t
+EbuildCache::record_fields() const
+{
+    return EBUILD_FIELDS;
+}
+
+std::size_t
+EbuildCache::cache_size() const
+{
+    /* at most; records that have been read again are counted twice */
+    return (_records ? _records->size() : 0) +
+           (_journal.is_open() ? _journal.size() : 0) + _entries.size();
+}
+
+bool
+EbuildCache::do_is_valid()
+{
+    return true;
+}
+
+bool
+EbuildCache::do_check(const CacheFileReader& file)
+{
+    return ((file.tables() == NTABLES) and
+            (file.table(LISTING_TABLE).fields() == LISTING_FIELDS));
+}
+
+void
+EbuildCache::update()
+{
+    MutexLock l(_lock);
+
+    if (this->is_loaded())
+        return;
+
+    TraceContext c("EbuildCache::update()");
+
+    /* nothing to fill; entries are added as they're looked up */
+    if (this->is_valid())
+        this->load();
+    else
+        this->fill();
+
+    this->open_journal(_journal);
+}
+
+void
+EbuildCache::do_fill()
+{
+    _records = NULL;
+    _entries.clear();
+    _listings.clear();
+}
+
+void
+EbuildCache::do_load(const CacheFileReader& file)
+{
+    _records = &file;
+    _entries.clear();
+    _listings.clear();
+}
+
+/* binary search a table (sorted on its first field) for key */
+static bool
+find_record(const CacheTable& table, const std::string& key, std::size_t *n)
+{
+    std::size_t lo = 0, hi = table.size();
+    while (lo < hi)
+    {
+        const std::size_t mid = lo + ((hi - lo) / 2);
+        const int r = table.field(mid, 0).compare(key);
+        if (r == 0)
+        {
+            *n = mid;
+            return true;
+        }
+        else if (r < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return false;
+}
+
+/*
+ * Find the entry for an ebuild with the given mtime and size.  Entries read
+ * since we were loaded take precedence over the journal, which takes
+ * precedence over the loaded records.
+ */
+
+bool
+EbuildCache::find(const std::string& path, std::time_t mtime,
+                  unsigned long size, Entry *entry) const
+{
+    entries_type::const_iterator i = _entries.find(path);
+    if (i != _entries.end())
+    {
+        if ((i->second.mtime != mtime) or (i->second.size != size))
+            return false;
+
+        *entry = i->second;
+        return true;
+    }
+
+    return ((_journal.is_open() and
+             this->find_in(_journal, path, mtime, size, entry)) or
+            (_records and this->find_in(*_records, path, mtime, size, entry)));
+}
+
+bool
+EbuildCache::find_in(const CacheFileReader& file, const std::string& path,
+                     std::time_t mtime, unsigned long size, Entry *entry) const
+{
+    std::size_t n;
+    if (not find_record(file.table(0), path, &n))
+        return false;
+
+    if ((file.field(n, 1) != util::stringify(static_cast<long>(mtime))) or
+        (file.field(n, 2) != util::stringify(size)))
+        return false;
+
+    entry->mtime = mtime;
+    entry->size = size;
+    for (std::size_t v = 0 ; v != NVARS ; ++v)
+        entry->vars[v].assign(file.field(n, v + 3).str());
+
+    return true;
+}
+
+/*
+ * Likewise for the listing of a package directory with the given mtime.
+ */
+
+bool
+EbuildCache::find(const std::string& dir, std::time_t mtime,
+                  Listing *listing) const
+{
+    listings_type::const_iterator i = _listings.find(dir);
+    if (i != _listings.end())
+    {
+        if (i->second.mtime != mtime)
+            return false;
+
+        *listing = i->second;
+        return true;
+    }
+
+    return ((_journal.is_open() and
+             this->find_in(_journal, dir, mtime, listing)) or
+            (_records and this->find_in(*_records, dir, mtime, listing)));
+}
+
+bool
+EbuildCache::find_in(const CacheFileReader& file, const std::string& dir,
+                     std::time_t mtime, Listing *listing) const
+{
+    const CacheTable& table(file.table(LISTING_TABLE));
+
+    std::size_t n;
+    if (not find_record(table, dir, &n))
+        return false;
+
+    if (table.field(n, 1) != util::stringify(static_cast<long>(mtime)))
+        return false;
+
+    listing->mtime = mtime;
+    listing->ebuilds.clear();
+    util::split(table.field(n, 2).str(),
+                std::back_inserter(listing->ebuilds), " ");
+    return true;
+}
+
+void
+EbuildCache::get(const std::string& path, Entry *entry)
+{
+    profile_count(Profiler::STATS);
+    const util::Stat st(path);
+    if (st.exists())
+    {
+        MutexLock l(_lock);
+        if (this->find(path, st.mtime(), st.size(), entry))
+            return;
+    }
+
+    debug_msg("reading %s", path.c_str());
+
+    /* read it without holding the lock, so concurrent queries don't have to
+     * wait on each other's ebuilds.  The tree's own metadata cache is a lot
+     * quicker than the ebuild, if it has a current entry. */
+    Ebuild ebuild;
+    if (not read_tree_cache(path, &ebuild))
+        ebuild.read(path);
+
+    for (std::size_t v = 0 ; v != NVARS ; ++v)
+        entry->vars[v].assign(ebuild[vars[v]]);
+
+    /* nothing to key it on */
+    if (not st.exists())
+        return;
+
+    entry->mtime = st.mtime();
+    entry->size = st.size();
+
+    MutexLock l(_lock);
+    _entries[path] = *entry;
+    _dirty = true;
+}
+
+void
+EbuildCache::vars(const std::string& path, Ebuild *ebuild)
+{
+    TraceContext c("EbuildCache::vars("+path+")");
+
+    Entry entry;
+    this->get(path, &entry);
+
+    for (std::size_t v = 0 ; v != NVARS ; ++v)
+        (*ebuild)[vars[v]] = entry.vars[v];
+}
+
+void
+EbuildCache::ebuilds(const std::string& dir, std::vector<std::string> *ebuilds)
+{
+    TraceContext c("EbuildCache::ebuilds("+dir+")");
+
+    ebuilds->clear();
+
+    profile_count(Profiler::STATS);
+    const util::Stat st(dir);
+    if (not st.exists())
+        throw FileException(dir);
+
+    Listing listing;
+    bool found;
+    {
+        MutexLock l(_lock);
+        found = this->find(dir, st.mtime(), &listing);
+    }
+
+    if (not found)
+    {
+        debug_msg("scanning %s", dir.c_str());
+
+        DIR *d = ::opendir(dir.c_str());
+        if (not d)
+            throw FileException(dir);
+
+        /* sort them by version, using the encoded keys so each version
+         * is only parsed once */
+        const std::string pkg(dir.substr(dir.rfind('/') + 1));
+        std::map<std::string, std::string> versions;
+        std::string key;
+        struct dirent *ent;
+        while ((ent = ::readdir(d)))
+        {
+            const std::string name(ent->d_name);
+            const std::string::size_type pos = name.rfind(".ebuild");
+            if ((pos != std::string::npos) and
+                (pos == (name.size() - (sizeof(".ebuild") - 1))))
+            {
+                ebuild_version_key(pkg, name, &key);
+                versions.insert(std::make_pair(key, name));
+            }
+        }
+
+        ::closedir(d);
+
+        listing.mtime = st.mtime();
+        std::map<std::string, std::string>::iterator v;
+        for (v = versions.begin() ; v != versions.end() ; ++v)
+            listing.ebuilds.push_back(v->second);
+
+        MutexLock l(_lock);
+        _listings[dir] = listing;
+        _dirty = true;
+    }
+
+    ebuilds->reserve(listing.ebuilds.size());
+    std::vector<std::string>::iterator i;
+    for (i = listing.ebuilds.begin() ; i != listing.ebuilds.end() ; ++i)
+        ebuilds->push_back(dir+"/"+(*i));
+}
+
+std::string
+EbuildCache::latest(const std::string& dir)
+{
+    std::vector<std::string> v;
+    this->ebuilds(dir, &v);
+    return (v.empty() ? std::string() : v.back());
+}
+
+void
+EbuildCache::read_all(const PackageCache& pkgs)
+{
+    TraceContext c("EbuildCache::read_all()");
+
+    this->update();
+
+    {
+        ProfileScope p("cache fill", this->name());
+
+        Entry entry;
+        std::vector<std::string> ebuilds;
+        PackageCache::const_iterator i;
+        for (i = pkgs.begin() ; i != pkgs.end() ; ++i)
+        {
+            try
+            {
+                this->ebuilds(i->path(), &ebuilds);
+            }
+            catch (const FileException&)
+            {
+                /* removed since the package cache was brought up to date */
+                continue;
+            }
+
+            std::vector<std::string>::iterator e;
+            for (e = ebuilds.begin() ; e != ebuilds.end() ; ++e)
+                this->get(*e, &entry);
+        }
+    }
+
+    this->save(true);
+}
+
+void
+EbuildCache::keywords(const Package& pkg, keywords_type *keywords)
+{
+    TraceContext c("EbuildCache::keywords("+pkg.full()+")");
+
+    std::vector<std::string> ebuilds;
+    this->ebuilds(pkg.path(), &ebuilds);
+
+    keywords->clear();
+    keywords->reserve(ebuilds.size());
+
+    Entry entry;
+    std::vector<std::string>::iterator i;
+    for (i = ebuilds.begin() ; i != ebuilds.end() ; ++i)
+    {
+        this->get(*i, &entry);
+
+        Ebuild ebuild;
+        ebuild["KEYWORDS"] = entry.vars[KEYWORDS_VAR];
+        keywords->push_back(
+            std::make_pair(VersionString(*i), Keywords(ebuild)));
+    }
+}
+
+/*
+ * Merge the records of a table we loaded with the entries added since, in
+ * key order, leaving out the ones that have been replaced and, if given an
+ * exists function, those whose file (or directory) is gone.
+ */
+
+static void
+merge(const CacheTable *table, const sorted_type& entries,
+      bool (*exists)(const std::string&), std::vector<record_type> *records)
+{
+    sorted_type::const_iterator e = entries.begin();
+    const std::size_t size = (table ? table->size() : 0);
+
+    record_type record(table ? table->fields() : 0);
+    for (std::size_t n = 0 ; n != size ; ++n)
+    {
+        const CacheField key(table->field(n, 0));
+
+        for ( ; (e != entries.end()) and (key.compare(e->first) > 0) ; ++e)
+            if (not exists or exists(e->first))
+                records->push_back(e->second);
+
+        if ((e != entries.end()) and (key == e->first))
+            continue;
+
+        if (exists and not exists(key.str()))
+            continue;
+
+        for (std::size_t f = 0 ; f != record.size() ; ++f)
+            record[f].assign(table->field(n, f).str());
+        records->push_back(record);
+    }
+
+    for ( ; e != entries.end() ; ++e)
+        if (not exists or exists(e->first))
+            records->push_back(e->second);
+}
+
+static bool
+file_exists(const std::string& path)
+{
+    profile_count(Profiler::STATS);
+    return util::is_file(path);
+}
+
+static bool
+dir_exists(const std::string& path)
+{
+    profile_count(Profiler::STATS);
+    return util::is_dir(path);
+}
+
+/* add the records of a table to a sorted map, replacing any already there */
+static void
+add_records(const CacheTable& table, sorted_type *records)
+{
+    for (std::size_t n = 0 ; n != table.size() ; ++n)
+    {
+        record_type& record((*records)[table.field(n, 0).str()]);
+        record.resize(table.fields());
+        for (std::size_t f = 0 ; f != record.size() ; ++f)
+            record[f].assign(table.field(n, f).str());
+    }
+}
+
+/*
+ * Everything that isn't in the cache file yet (the journal's records, then
+ * what's been added since, which replaces them), sorted.
+ */
+
+void
+EbuildCache::sorted(sorted_type *entries, sorted_type *listings) const
+{
+    if (_journal.is_open())
+    {
+        add_records(_journal.table(0), entries);
+        add_records(_journal.table(LISTING_TABLE), listings);
+    }
+
+    entries_type::const_iterator i;
+    for (i = _entries.begin() ; i != _entries.end() ; ++i)
+    {
+        record_type& record((*entries)[i->first]);
+        record.clear();
+        record.push_back(i->first);
+        record.push_back(util::stringify(static_cast<long>(i->second.mtime)));
+        record.push_back(util::stringify(i->second.size));
+        record.insert(record.end(), i->second.vars.begin(),
+                      i->second.vars.end());
+    }
+
+    listings_type::const_iterator l;
+    for (l = _listings.begin() ; l != _listings.end() ; ++l)
+    {
+        record_type& record((*listings)[l->first]);
+        record.clear();
+        record.push_back(l->first);
+        record.push_back(util::stringify(static_cast<long>(l->second.mtime)));
+        record.push_back(util::join(l->second.ebuilds.begin(),
+                                    l->second.ebuilds.end(), " "));
+    }
+}
+
+void
+EbuildCache::do_dump(CacheFileWriter& file)
+{
+    sorted_type entries, listings;
+    this->sorted(&entries, &listings);
+
+    /* only stat every record when asked to (by read_all(), which has just
+     * stat'ed every ebuild anyway) */
+    std::vector<record_type> records;
+    merge(_records ? &_records->table(0) : NULL, entries,
+          _prune ? file_exists : NULL, &records);
+
+    std::vector<record_type>::iterator r;
+    for (r = records.begin() ; r != records.end() ; ++r)
+        file.add(*r);
+
+    records.clear();
+    merge(_records ? &_records->table(LISTING_TABLE) : NULL, listings,
+          _prune ? dir_exists : NULL, &records);
+
+    const std::size_t table = file.add_table(LISTING_FIELDS);
+    for (r = records.begin() ; r != records.end() ; ++r)
+        file.add(table, *r);
+}
+
+void
+EbuildCache::do_dump_journal(CacheFileWriter& file)
+{
+    sorted_type entries, listings;
+    this->sorted(&entries, &listings);
+
+    sorted_type::iterator i;
+    for (i = entries.begin() ; i != entries.end() ; ++i)
+        file.add(i->second);
+
+    const std::size_t table = file.add_table(LISTING_FIELDS);
+    for (i = listings.begin() ; i != listings.end() ; ++i)
+        file.add(table, i->second);
+}
+
+void
+EbuildCache::save()
+{
+    this->save(false);
+}
+
+void
+EbuildCache::save(bool prune)
+{
+    MutexLock l(_lock);
+
+    if (not _dirty)
+        return;
+
+    TraceContext c("EbuildCache::save()");
+
+    const std::size_t records = (_records ?
+        (_records->size() + _records->table(LISTING_TABLE).size()) : 0);
+    const std::size_t journal = (_journal.is_open() ?
+        (_journal.size() + _journal.table(LISTING_TABLE).size()) : 0) +
+        _entries.size() + _listings.size();
+    const bool compact = (prune or
+        (journal > std::max<std::size_t>(JOURNAL_MIN, records / 8)));
+
+    /* not being able to save it only costs us reading the ebuilds again */
+    try
+    {
+        if (compact)
+        {
+            _prune = prune;
+            this->dump();
+            std::remove(this->journal_path().c_str());
+            _journal.close();
+
+            /* what we had is all in there now */
+            if (this->is_valid())
+                this->load();
+        }
+        else
+        {
+            this->dump_journal();
+
+            /* likewise */
+            if (this->open_journal(_journal))
+            {
+                _entries.clear();
+                _listings.clear();
+            }
+        }
+
+        _dirty = false;
+    }
+    catch (const FileException& e)
+    {
+        debug_msg("failed to save the %s cache: %s", this->name(), e.what());
+    }
+
+    _prune = false;
+}
+
+void
+EbuildCache::dump_text(std::ostream& stream)
+{
+    MutexLock l(_lock);
+
+    /* what's in the cache file, then what isn't yet */
+    sorted_type entries, listings;
+    this->sorted(&entries, &listings);
+
+    const std::size_t size = (_records ? _records->size() : 0);
+    for (std::size_t n = 0 ; n != size ; ++n)
+    {
+        for (std::size_t f = 0 ; f != EBUILD_FIELDS ; ++f)
+            stream << (f ? ":" : "") << _records->field(n, f).str();
+        stream << std::endl;
+    }
+
+    sorted_type::iterator i;
+    for (i = entries.begin() ; i != entries.end() ; ++i)
+        stream << util::join(i->second.begin(), i->second.end(), ":")
+               << std::endl;
+
+    if (_records)
+    {
+        const CacheTable& table(_records->table(LISTING_TABLE));
+        for (std::size_t n = 0 ; n != table.size() ; ++n)
+        {
+            for (std::size_t f = 0 ; f != LISTING_FIELDS ; ++f)
+                stream << (f ? ":" : "") << table.field(n, f).str();
+            stream << std::endl;
+        }
+    }
+
+    for (i = listings.begin() ; i != listings.end() ; ++i)
+        stream << util::join(i->second.begin(), i->second.end(), ":")
+               << std::endl;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,205 @@
+/*
+ * herdstat -- src/ebuild_cache.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_EBUILD_CACHE_HH
+#define _HAVE_SRC_EBUILD_CACHE_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <map>
+#include <vector>
+#include <ctime>
+#include <herdstat/portage/ebuild.hh>
+#include <herdstat/portage/keywords.hh>
+#include <herdstat/portage/package.hh>
+#include <herdstat/portage/version.hh>
+
+#include "cache.hh"
+#include "threads.hh"
+
+class PackageCache;
+
+/**
+ * @class EbuildCache
+ * @brief The variables we care about (LICENSE, HOMEPAGE, DESCRIPTION and
+ * KEYWORDS) of each ebuild that's been looked at, so it doesn't have to be
+ * read again as long as it hasn't changed.  Entries are keyed on the
+ * ebuild's path, mtime and size, and are added as ebuilds are read; unlike
+ * the other caches, nothing is ever filled in one go.  Likewise, the sorted
+ * list of ebuilds of each package that's been looked at, keyed on the
+ * package directory's path and mtime.  Whatever's added goes to the
+ * journal when saved, and is only merged into the cache file once the
+ * journal grows too big (or by read_all()).
+ */
+
+class EbuildCache : public Cache
+{
+    public:
+        /// Keywords of each version, oldest version first.
+        typedef std::vector<std::pair<herdstat::portage::VersionString,
+                herdstat::portage::Keywords> > keywords_type;
+
+        virtual ~EbuildCache() throw() { }
+
+        /**
+         * Load the cache, if it hasn't been already.  Safe to call from
+         * concurrent queries, but the first call should come from the main
+         * thread (see QueryContext::prepare).
+         */
+        void update();
+
+        /**
+         * Get an ebuild's variables, reading it only if it isn't cached or
+         * has changed since it was.
+         * @param path Path to ebuild.
+         * @param vars Ebuild to assign the variables to.
+         */
+        void vars(const std::string& path, herdstat::portage::Ebuild *vars);
+
+        /**
+         * Get the ebuilds of a package, oldest version first.  The package
+         * directory is only scanned if it isn't cached or its mtime has
+         * changed since it was.
+         * @param dir Package directory.
+         * @param ebuilds Vector to fill with the paths to the ebuilds.
+         */
+        void ebuilds(const std::string& dir, std::vector<std::string> *ebuilds);
+
+        /**
+         * Get the latest ebuild of a package (like PackageWhich).
+         * @param dir Package directory.
+         * @returns Path to the ebuild, or an empty string if there are none.
+         */
+        std::string latest(const std::string& dir);
+
+        /**
+         * Get the keywords of each version of a package, reading only the
+         * ebuilds that aren't cached or have changed since.  They're in
+         * the same order as ebuilds() (so no versions are compared).
+         * @param pkg Package.
+         * @param keywords Vector to fill.
+         */
+        void keywords(const herdstat::portage::Package& pkg,
+                      keywords_type *keywords);
+
+        /**
+         * Scan each package and read whichever of its ebuilds aren't cached
+         * or have changed since, then save the cache, dropping the entries
+         * of ebuilds and packages that are gone.  For processes about to
+         * fork workers that would otherwise each do it for themselves.
+         * @param pkgs Packages to read.
+         */
+        void read_all(const PackageCache& pkgs);
+
+        /**
+         * Save the cache, if any ebuilds had to be read or any package
+         * directories scanned since it was last loaded or saved.  Only
+         * those are written (to the journal), unless it's time to merge
+         * the journal into the cache file.  Failing to save it isn't fatal.
+         */
+        void save();
+
+        virtual void dump_text(std::ostream& stream);
+
+    protected:
+        virtual std::size_t cache_size() const;
+        virtual std::size_t record_fields() const;
+        virtual const char * const name() const;
+        virtual unsigned format() const;
+        /// Entries are keyed on their own ebuild, not the tree.
+        virtual bool uses_tree() const { return false; }
+        virtual bool do_is_valid();
+        virtual bool do_check(const CacheFileReader& file);
+        virtual void do_fill();
+        virtual void do_load(const CacheFileReader& file);
+        virtual void do_dump(CacheFileWriter& file);
+        virtual void do_dump_journal(CacheFileWriter& file);
+
+    private:
+        friend EbuildCache& GlobalEbuildCache();
+        EbuildCache();
+
+        struct Entry
+        {
+            Entry() : mtime(0), size(0), vars(4) { }
+
+            std::time_t mtime;
+            unsigned long size;
+            /// LICENSE, HOMEPAGE, DESCRIPTION and KEYWORDS.
+            std::vector<std::string> vars;
+        };
+
+        struct Listing
+        {
+            Listing() : mtime(0), ebuilds() { }
+
+            std::time_t mtime;
+            /// File names, oldest version first.
+            std::vector<std::string> ebuilds;
+        };
+
+        /* entries read since the cache was loaded, keyed on path */
+        typedef std::map<std::string, Entry> entries_type;
+        /* listings made since the cache was loaded, keyed on directory */
+        typedef std::map<std::string, Listing> listings_type;
+        /* records (of either table) keyed on their first field */
+        typedef std::map<std::string, std::vector<std::string> > sorted_type;
+
+        bool find(const std::string& path, std::time_t mtime,
+                  unsigned long size, Entry *entry) const;
+        bool find(const std::string& dir, std::time_t mtime,
+                  Listing *listing) const;
+        bool find_in(const CacheFileReader& file, const std::string& path,
+                     std::time_t mtime, unsigned long size,
+                     Entry *entry) const;
+        bool find_in(const CacheFileReader& file, const std::string& dir,
+                     std::time_t mtime, Listing *listing) const;
+        void get(const std::string& path, Entry *entry);
+        void sorted(sorted_type *entries, sorted_type *listings) const;
+        void save(bool prune);
+
+        Mutex _lock;
+        /* sorted by path; NULL if there was no (valid) cache to load */
+        const CacheFileReader *_records;
+        /* sorted likewise; closed if there's no journal */
+        CacheFileReader _journal;
+        entries_type _entries;
+        listings_type _listings;
+        /* has anything been added since we were loaded or saved? */
+        bool _dirty;
+        /* drop the records of files that are gone when dumping? */
+        bool _prune;
+};
+
+/// The ebuild cache, shared by every action handler.
+inline EbuildCache&
+GlobalEbuildCache()
+{
+    static EbuildCache e;
+    return e;
+}
+
+#endif /* _HAVE_SRC_EBUILD_CACHE_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
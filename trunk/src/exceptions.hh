@@ -27,6 +27,8 @@
 # include "config.h"
 #endif
 
+#include <string>
+#include <herdstat/noncopyable.hh>
 #include <herdstat/exceptions.hh>
 
 /* command line handling exceptions */
@@ -108,6 +110,26 @@ class BadLocale : public herdstat::Exception
 /* action handler exceptions */
 class ActionException : public herdstat::BaseException { };
 
+/**
+ * @class TraceContext
+ * @brief Records a herdstat::BacktraceContext unless the calling thread is
+ * running a query in a QueryContext.
+ *
+ * libherdstat keeps a single backtrace for the whole process, which queries
+ * running in parallel threads would trample over.  Their errors simply go
+ * without a backtrace.
+ */
+
+class TraceContext : private herdstat::Noncopyable
+{
+    public:
+        explicit TraceContext(const std::string& context);
+        ~TraceContext();
+
+    private:
+        herdstat::BacktraceContext *_context;
+};
+
 #endif
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,216 @@
+/*
+ * herdstat -- src/fingerprint.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <ctime>
+#include <algorithm>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <herdstat/util/string.hh>
+#include <herdstat/portage/config.hh>
+
+#include "common.hh"
+#include "threads.hh"
+#include "profiler.hh"
+#include "hash_map.hh"
+#include "fingerprint.hh"
+
+using namespace herdstat;
+
+namespace {
+
+    struct Stamp
+    {
+        Stamp() : mtime(0), size(0) { }
+
+        std::time_t mtime;
+        off_t size;
+    };
+
+    /*
+     * Stats every nthreads'th path, starting at the given offset.  Each
+     * worker only writes to its own slots, so no locking is needed.
+     */
+
+    class StatWorker : public Thread
+    {
+        public:
+            StatWorker(const std::vector<std::string>& paths,
+                       std::vector<Stamp>& stamps,
+                       std::size_t first, std::size_t stride)
+                : _paths(paths), _stamps(stamps),
+                  _first(first), _stride(stride) { }
+
+            void stat_paths()
+            {
+                struct stat st;
+                unsigned long stated = 0;
+                for (std::size_t n = _first ; n < _paths.size() ; n += _stride)
+                {
+                    ++stated;
+                    if (::stat(_paths[n].c_str(), &st) == 0)
+                    {
+                        _stamps[n].mtime = st.st_mtime;
+                        _stamps[n].size = st.st_size;
+                    }
+                }
+
+                profile_count(Profiler::STATS, stated);
+            }
+
+        protected:
+            virtual void run() { this->stat_paths(); }
+
+        private:
+            const std::vector<std::string>& _paths;
+            std::vector<Stamp>& _stamps;
+            const std::size_t _first;
+            const std::size_t _stride;
+    };
+
+    void
+    add_tree(const std::string& tree, const portage::Categories& categories,
+             std::vector<std::string> *paths)
+    {
+        paths->push_back(tree+"/metadata/timestamp");
+        paths->push_back(tree+"/profiles/categories");
+
+        portage::Categories::const_iterator i;
+        for (i = categories.begin() ; i != categories.end() ; ++i)
+            paths->push_back(tree+"/"+(*i));
+    }
+
+    /*
+     * Without a metadata/timestamp, nothing above changes when a package's
+     * files are edited in place (as in an overlay or a local tree), so add
+     * each package directory and its metadata.xml too.  Sorted, so the
+     * order doesn't depend on the filesystem.
+     */
+
+    void
+    add_packages(const std::string& tree,
+                 const portage::Categories& categories,
+                 std::vector<std::string> *paths)
+    {
+        struct stat st;
+        if (::stat((tree+"/metadata/timestamp").c_str(), &st) == 0)
+            return;
+
+        std::vector<std::string> pkgs;
+        portage::Categories::const_iterator i;
+        for (i = categories.begin() ; i != categories.end() ; ++i)
+        {
+            const std::string dir(tree+"/"+(*i));
+            DIR *d = ::opendir(dir.c_str());
+            if (not d)
+                continue;
+
+            pkgs.clear();
+            struct dirent *ent;
+            while ((ent = ::readdir(d)))
+                if (ent->d_name[0] != '.')
+                    pkgs.push_back(dir+"/"+ent->d_name);
+            ::closedir(d);
+
+            std::sort(pkgs.begin(), pkgs.end());
+
+            std::vector<std::string>::iterator p;
+            for (p = pkgs.begin() ; p != pkgs.end() ; ++p)
+            {
+                paths->push_back(*p);
+                paths->push_back(*p+"/metadata.xml");
+            }
+        }
+    }
+
+} // anonymous namespace
+
+std::string
+tree_fingerprint(const std::string& portdir,
+                 const std::vector<std::string>& overlays,
+                 unsigned nthreads, bool packages)
+{
+    TraceContext c("tree_fingerprint()");
+
+    const portage::Categories& categories(portage::GlobalConfig().categories());
+
+    std::vector<std::string> paths;
+    paths.reserve((overlays.size() + 1) * (categories.size() + 2));
+
+    std::vector<std::string> trees(1, portdir);
+    trees.insert(trees.end(), overlays.begin(), overlays.end());
+
+    std::vector<std::string>::const_iterator i;
+    for (i = trees.begin() ; i != trees.end() ; ++i)
+    {
+        add_tree(*i, categories, &paths);
+        if (packages)
+            add_packages(*i, categories, &paths);
+    }
+
+    std::vector<Stamp> stamps(paths.size());
+
+    if (nthreads == 0)
+        nthreads = available_cpus();
+    /* a stat is cheap when it's in the dentry cache; only worth spreading
+     * out when there's enough of them to wait on the disk for */
+    if (paths.size() < (nthreads * 32))
+        nthreads = 1;
+
+    if (nthreads == 1)
+        StatWorker(paths, stamps, 0, 1).stat_paths();
+    else
+    {
+        ThreadGroup<StatWorker> workers;
+        for (unsigned n = 0 ; n != nthreads ; ++n)
+            workers.add(new StatWorker(paths, stamps, n, nthreads));
+
+        run_threads(workers.begin(), workers.end());
+    }
+
+    /* a path that doesn't exist hashes as mtime 0, so creating it (e.g. a
+     * new category) still changes the fingerprint */
+    uint64_t h = HASH64_INIT;
+    for (std::size_t n = 0 ; n != paths.size() ; ++n)
+    {
+        h = hash64(paths[n].data(), paths[n].size(), h);
+        h = hash64(reinterpret_cast<const char *>(&stamps[n].mtime),
+                   sizeof(stamps[n].mtime), h);
+        h = hash64(reinterpret_cast<const char *>(&stamps[n].size),
+                   sizeof(stamps[n].size), h);
+    }
+
+    const std::string fingerprint(util::sprintf("%08x%08x",
+                static_cast<unsigned>(h >> 32),
+                static_cast<unsigned>(h & 0xffffffffU)));
+
+    debug_msg("tree fingerprint (%d paths, %d thread(s)): %s",
+              paths.size(), nthreads, fingerprint.c_str());
+
+    return fingerprint;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,57 @@
+/*
+ * herdstat -- src/fingerprint.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_FINGERPRINT_HH
+#define _HAVE_SRC_FINGERPRINT_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+
+/**
+ * Compute a fingerprint of the portage tree and its overlays.  Adding or
+ * removing a package changes its category directory's mtime and syncing
+ * rewrites metadata/timestamp, so any such change yields a different
+ * fingerprint, while an untouched tree always yields the same one.
+ *
+ * Editing a package's files in place changes neither, though, which only
+ * a sync (and so metadata/timestamp) is expected to do.  For trees that
+ * have no metadata/timestamp, such as most overlays, each package
+ * directory and its metadata.xml can be included as well (one readdir
+ * per category and two stats per package).
+ *
+ * @param portdir PORTDIR.
+ * @param overlays PORTDIR_OVERLAY's.
+ * @param nthreads Number of threads to stat with (0 means one per CPU).
+ * @param packages Include the packages of trees without a timestamp.
+ * @returns fingerprint as a hex string.
+ */
+std::string tree_fingerprint(const std::string& portdir,
+                             const std::vector<std::string>& overlays,
+                             unsigned nthreads, bool packages = false);
+
+#endif /* _HAVE_SRC_FINGERPRINT_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -26,6 +26,8 @@
 
 #include <algorithm>
 #include <functional>
+#include <cassert>
+#include <cctype>
 #include <iterator>
 
 #include <herdstat/exceptions.hh>
@@ -34,6 +36,7 @@
 
 #include "common.hh"
 #include "formatter.hh"
+#include "profiler.hh"
 
 using namespace herdstat;
 /****************************************************************************
@@ -43,7 +46,8 @@ FormatAttrs::FormatAttrs()
     : _cmap(GlobalColorMap()), _quiet(false), _colors(true), _away(false),
       _quiet_delim("\n"), _maxlen(78),
       _lcolor(_cmap[green]), _hcolor(_cmap[yellow]), _dcolor(_cmap[red]),
-      _no_color(_cmap[none]), _devaway(), _highlights()
+      _no_color(_cmap[none]), _devaway(), _literals(), _highlights(),
+      _combined(), _combined_current(false)
 {
 }
 /****************************************************************************/
@@ -56,18 +60,134 @@ FormatAttrs::add_highlights(const std::vector<std::string>& pairs)
         std::vector<std::string> parts;
         util::split(*i, std::back_inserter(parts), ",");
         if (parts.size() == 1)
-            _highlights.insert(std::make_pair(
-                    util::Regex(parts.front()), _hcolor));
+            insert_highlight(parts.front(), _hcolor);
         else if (parts.size() == 2)
-            _highlights.insert(std::make_pair(
-                    util::Regex(parts.front()),
-                    _colors ? _cmap[parts.back()] : ""));
+            insert_highlight(parts.front(),
+                    _colors ? _cmap[parts.back()] : "");
         else
             throw Exception("Invalid highlight specification '%s'", i->c_str());
     }
 }
 /****************************************************************************/
 void
+FormatAttrs::insert_highlight(const std::string& regex,
+                              const std::string& color)
+{
+    /* ^literal$ can only ever match literal, so look it up directly */
+    if ((regex.size() > 2) and (regex[0] == '^') and
+        (regex[regex.size() - 1] == '$') and
+        (regex.find_first_of(".[]\\*+?{}()|^$", 1) == (regex.size() - 1)))
+    {
+        const std::string literal(regex, 1, regex.size() - 2);
+        if (not _literals.find(literal))
+            _literals[literal] = std::make_pair(regex, color);
+        return;
+    }
+
+    _highlights.insert(std::make_pair(util::Regex(regex), color));
+    _combined_current = false;
+}
+/****************************************************************************/
+/*
+ * How an alternation of regexes compiled with the default flags has to be
+ * written: as in an extended regex, as GNU allows in basic ones, or not at
+ * all.  Found out by trying, since it depends on both the flags and the
+ * regex library.
+ */
+
+enum Alternation { NO_ALTERNATION, EXTENDED_ALTERNATION, BASIC_ALTERNATION };
+
+static Alternation
+probe_alternation()
+{
+    try
+    {
+        if (util::Regex("(x)|(y)") == "y")
+            return EXTENDED_ALTERNATION;
+        if (util::Regex("\\(x\\)\\|\\(y\\)") == "y")
+            return BASIC_ALTERNATION;
+    }
+    catch (const BadRegex&)
+    {
+    }
+
+    return NO_ALTERNATION;
+}
+
+void
+FormatAttrs::combine_highlights() const
+{
+    static const Alternation syntax = probe_alternation();
+
+    _combined = util::Regex();
+    _combined_current = true;
+
+    if ((syntax == NO_ALTERNATION) or (_highlights.size() < 2))
+        return;
+
+    const bool ext = (syntax == EXTENDED_ALTERNATION);
+    std::string alternation;
+
+    util::RegexMap<std::string>::const_iterator i;
+    for (i = _highlights.begin() ; i != _highlights.end() ; ++i)
+    {
+        const std::string& regex(i->first());
+
+        /* back-references would refer to the wrong group */
+        for (std::string::size_type pos = regex.find('\\') ;
+                pos != std::string::npos ; pos = regex.find('\\', pos + 2))
+            if (((pos + 1) < regex.size()) and
+                std::isdigit(static_cast<unsigned char>(regex[pos + 1])))
+                return;
+
+        if (not alternation.empty())
+            alternation += (ext ? "|" : "\\|");
+        alternation += (ext ? "(" : "\\(") + regex + (ext ? ")" : "\\)");
+    }
+
+    try
+    {
+        _combined = util::Regex(alternation);
+    }
+    catch (const BadRegex&)
+    {
+        _combined = util::Regex();
+    }
+}
+/****************************************************************************/
+const std::string *
+FormatAttrs::find_highlight(const std::string& s) const
+{
+    const std::pair<std::string, std::string> *literal = _literals.find(s);
+
+    if (not _highlights.empty())
+    {
+        if (not _combined_current)
+            this->combine_highlights();
+
+        /* most words don't match any of them; find out with one test */
+        if (not _combined.empty())
+            profile_count(Profiler::REGEX_EVALS);
+
+        if (_combined.empty() or (_combined == s))
+        {
+            /* the first match (by regex) wins, like RegexMap::find() */
+            util::RegexMap<std::string>::const_iterator i;
+            for (i = _highlights.begin() ; i != _highlights.end() ; ++i)
+            {
+                if (literal and (literal->first < i->first()))
+                    break;
+                profile_count(Profiler::REGEX_EVALS);
+                if (i->first == s)
+                    return &(i->second);
+            }
+        }
+    }
+
+    return (literal ? &(literal->second) : NULL);
+}
+/****************************************************************************/
+void
 FormatAttrs::set_colors(bool c)
 {
     _colors = c;
@@ -97,6 +217,17 @@ FormatAttrs::set_colors(bool c)
             _no_color.assign(_no_color_save);
     }
 }
+/****************************************************************************
+ * A word of output, along with its width on screen (i.e. without any color
+ * codes), worked out once so it needn't be measured again while wrapping.
+ ****************************************************************************/
+struct Token
+{
+    Token() : str(), width(0) { }
+
+    std::string str;
+    std::string::size_type width;
+};
 /****************************************************************************
  * Small struct for encapsulating some data to pass to Wrap().
  ****************************************************************************/
@@ -116,10 +247,9 @@ struct OutData
  * expressions.
  ****************************************************************************/
 struct Highlight
-    : std::binary_function<std::string, FormatAttrs * const, std::string>
+    : std::binary_function<std::string, FormatAttrs * const, Token>
 {
-    std::string
-    operator()(const std::string& str, FormatAttrs * const attrs) const;
+    Token operator()(const std::string& str, FormatAttrs * const attrs) const;
 
     /* handle special cases where we don't
      * want to highlight certain characters in a word */
@@ -131,9 +261,9 @@ struct Highlight
  * Function object for performing line wrapping.
  ****************************************************************************/
 struct Wrap
-    : std::binary_function<std::string, OutData * const, void>
+    : std::binary_function<Token, OutData * const, void>
 {
-    void operator()(const std::string& str, OutData * const out) const;
+    void operator()(const Token& token, OutData * const out) const;
 };
 /****************************************************************************
  * Function object for formatting pairs of strings (label/data).
@@ -146,6 +276,17 @@ struct Format : std::binary_function<std::pair<std::string, std::string>,
                FormatAttrs * const attrs) const;
 };
 /****************************************************************************/
+/* str without any colors; only copied (to buf) if it has any */
+static inline const std::string&
+colorfree(const std::string& str, std::string *buf)
+{
+    if (str.find('\033') == std::string::npos)
+        return str;
+
+    buf->assign(util::strip_colors(str));
+    return *buf;
+}
+/****************************************************************************/
 std::string
 Highlight::handle_special_cases(const std::string& str,
                                 const std::string& color,
@@ -167,52 +308,51 @@ Highlight::handle_special_cases(const std::string& str,
     return (color+str);
 }
 /****************************************************************************/
-std::string
+Token
 Highlight::operator()(const std::string& str, FormatAttrs * const attrs) const
 {
-    const std::string colorfree(util::strip_colors(str));
+    std::string buf;
+    const std::string& plain(colorfree(str, &buf));
     const bool is_away(not attrs->quiet() and
         std::binary_search(attrs->devaway().begin(),
-            attrs->devaway().end(), colorfree));
+            attrs->devaway().end(), plain));
 
     if (is_away)
         attrs->set_marked_away(true);
 
-    /* Does str (stripped of any colors) match any regular expressions in
-     * the highlights map? */
-    util::RegexMap<std::string>::const_iterator h =
-        attrs->highlights().find(colorfree);
-    if (h != attrs->highlights().end())
+    /* away developers get a '*' */
+    Token token;
+    token.width = plain.length() + (is_away ? 1 : 0);
+
+    /* Does str (stripped of any colors) match any highlight? */
+    const std::string *color = attrs->find_highlight(plain);
+    if (color)
     {
-        std::string result(
-                handle_special_cases(str, h->second, attrs->no_color()));
-        if (is_away) result.append(attrs->devaway_color()+"*");
-        return (result+attrs->no_color());
+        token.str.assign(handle_special_cases(str, *color, attrs->no_color()));
+        if (is_away) token.str.append(attrs->devaway_color()+"*");
+        token.str.append(attrs->no_color());
+        return token;
     }
 
     /* wasnt found in highlights, so mark it if away, or return
      * the original string. */
-    std::string result(str);
+    token.str.assign(str);
     if (is_away)
-        result.append(attrs->devaway_color()+"*"+attrs->no_color());
+        token.str.append(attrs->devaway_color()+"*"+attrs->no_color());
 
-    return result;
+    return token;
 }
 
 void
-Wrap::operator()(const std::string& str, OutData * const out) const
+Wrap::operator()(const Token& token, OutData * const out) const
 {
-    /* length of str after colors are stripped */
-    const std::string::size_type wclen =
-        util::strip_colors(str).length();
-
     /* if it fits or it doesnt fit but it's the only word (a long
      * URL for example), put it on the current line */
-    if (((out->len + wclen) < out->maxlen) or
+    if (((out->len + token.width) < out->maxlen) or
         (out->len == (out->maxlabel)))
     {
-        out->str.append(str + " ");
-        out->len += wclen + 1;
+        out->str.append(token.str + " ");
+        out->len += token.width + 1;
     }
     /* otherwise, end that line and start a new one */
     else
@@ -222,8 +362,8 @@ Wrap::operator()(const std::string& str, OutData * const out) const
 
         out->str.append("\n");
         out->str.append(out->maxlabel, ' ');
-        out->str.append(str + " ");
-        out->len = out->maxlabel + wclen+1;
+        out->str.append(token.str + " ");
+        out->len = out->maxlabel + token.width + 1;
     }
 }
 
@@ -252,14 +392,16 @@ Format::operator()(const std::pair<std::string, std::string>& pair,
         std::vector<std::string> parts;
         util::split(data, std::back_inserter(parts));
         /* perform any highlights */
+        std::vector<Token> tokens(parts.size());
         std::transform(parts.begin(), parts.end(),
-            parts.begin(), std::bind2nd(Highlight(), attrs));
+            tokens.begin(), std::bind2nd(Highlight(), attrs));
         /* perform any line wrapping */
-        out.len = util::strip_colors(out.str).length();
-        if (parts.size() == 1)
-            out.str += parts.front();
+        std::string buf;
+        out.len = colorfree(out.str, &buf).length();
+        if (tokens.size() == 1)
+            out.str += tokens.front().str;
         else
-            std::for_each(parts.begin(), parts.end(),
+            std::for_each(tokens.begin(), tokens.end(),
                 std::bind2nd(Wrap(), &out));
     }
 
@@ -300,10 +442,38 @@ Formatter::operator()(const QueryResults& results, std::ostream& stream)
                     0 : i->first.length() + 3
     );
 
-    /* format/display each element in results */
-    std::transform(results.begin(), results.end(),
-        std::ostream_iterator<std::string>(stream, "\n"),
-        std::bind2nd(Format(), &_attrs));
+    /* format each element in results, then display them in one go */
+    std::string out;
+    {
+        ProfileScope p("format");
+        Format format;
+        QueryResults::const_iterator r;
+        for (r = results.begin() ; r != results.end() ; ++r)
+        {
+            out.append(format(*r, &_attrs));
+            out.append("\n");
+        }
+    }
+
+    ProfileScope p("output");
+    stream << out;
+}
+
+void
+Formatter::write(const QuerySpec& line, std::ostream& stream)
+{
+    assert(_attrs.quiet());
+
+    _attrs.set_maxlabel(0);
+
+    std::string out;
+    {
+        ProfileScope p("format");
+        out.assign(Format()(line, &_attrs));
+    }
+
+    ProfileScope p("output");
+    stream << out << "\n";
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
@@ -36,6 +36,7 @@
 #include <herdstat/util/regex.hh>
 
 #include "query_results.hh"
+#include "hash_map.hh"
 
 class FormatAttrs
 {
@@ -48,16 +49,20 @@ class FormatAttrs
         const std::vector<std::string>& devaway() const { return _devaway; }
         void set_devaway(const std::vector<std::string>& v) { _devaway = v; }
 
-        const herdstat::util::RegexMap<std::string>& highlights() const
-        { return _highlights; }
         void add_highlights(const std::vector<std::string>& v);
         void add_highlight(const std::string &s,
                            const std::string &c = "")
         {
-            _highlights.insert(std::make_pair(herdstat::util::Regex(s),
-                (_colors? (c.empty() ? _hcolor : c) : "")));
+            insert_highlight(s, (_colors? (c.empty() ? _hcolor : c) : ""));
         }
 
+        /**
+         * Find the highlight matching the given (color free) string.
+         * @returns Pointer to the highlight color, or NULL if no highlight
+         * matches.
+         */
+        const std::string *find_highlight(const std::string& s) const;
+
         const std::string& no_color() const { return _no_color; }
 
         const std::string& label_color() const { return _lcolor; }
@@ -89,6 +94,10 @@ class FormatAttrs
         FormatAttrs(const FormatAttrs&);
         FormatAttrs& operator= (const FormatAttrs&);
 
+        void insert_highlight(const std::string& regex,
+                              const std::string& color);
+        void combine_highlights() const;
+
         herdstat::util::ColorMap& _cmap;
         bool _quiet;
         bool _colors;
@@ -101,7 +110,17 @@ class FormatAttrs
         std::string _dcolor, _dcolor_save; /* devaway color */
         std::string _no_color, _no_color_save;
         std::vector<std::string> _devaway;
+
+        /* highlights that are just ^literal$ (like the user name ones),
+         * keyed on the literal; the values are the regex and color */
+        HashMap<std::pair<std::string, std::string> > _literals;
+        /* all the other highlights */
         herdstat::util::RegexMap<std::string> _highlights;
+        /* _highlights combined into a single alternation, so a word that
+         * matches none of them (most words) is only tested once; empty if
+         * they couldn't be combined */
+        mutable herdstat::util::Regex _combined;
+        mutable bool _combined_current;
 };
 
 class Formatter
@@ -109,6 +128,13 @@ class Formatter
     public:
         /// Flush results buffer to stream.
         void operator()(const QueryResults& results, std::ostream& stream);
+        /**
+         * Format a single line and write it to stream, for results that are
+         * written out as they're added.  Only quiet output can be formatted
+         * a line at a time; otherwise every label is padded to the longest
+         * one, which isn't known until the end.
+         */
+        void write(const QuerySpec& line, std::ostream& stream);
 
         /// Get attributes.
         FormatAttrs& attrs() { return _attrs; }
@@ -0,0 +1,164 @@
+/*
+ * herdstat -- src/hash_map.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_HASH_MAP_HH
+#define _HAVE_SRC_HASH_MAP_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+/**
+ * Hash a string (FNV-1a).
+ * @param s String to hash.
+ * @returns hash value.
+ */
+inline std::size_t
+hash_string(const std::string& s)
+{
+    std::size_t h = 2166136261U;
+    for (std::string::size_type i = 0 ; i != s.size() ; ++i)
+    {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/* the FNV-1a offset basis and prime, put together from 32-bit halves
+ * since ISO C++98 has no long long literals */
+#define HASH64_INIT \
+    ((static_cast<uint64_t>(0xcbf29ce4U) << 32) | 0x84222325U)
+#define HASH64_PRIME \
+    ((static_cast<uint64_t>(0x00000100U) << 32) | 0x000001b3U)
+
+/**
+ * 64-bit FNV-1a.  Only meant for noticing that something changed, so it
+ * needn't be cryptographically strong.
+ * @param data Data to hash.
+ * @param size Size of data.
+ * @param h Hash to continue from (for hashing several pieces as one).
+ * @returns hash value.
+ */
+inline uint64_t
+hash64(const char *data, std::size_t size, uint64_t h = HASH64_INIT)
+{
+    for (std::size_t i = 0 ; i != size ; ++i)
+    {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= HASH64_PRIME;
+    }
+    return h;
+}
+
+/**
+ * @class HashMap
+ * @brief Minimal chained hash table keyed on strings.  Only what we need:
+ * insertion, lookup and iteration over the values in insertion order.
+ */
+
+template <typename T>
+class HashMap
+{
+    public:
+        typedef std::pair<std::string, T> value_type;
+        typedef typename std::vector<value_type>::iterator iterator;
+        typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+        HashMap() : _values(), _buckets(16) { }
+
+        std::size_t size() const { return _values.size(); }
+        bool empty() const { return _values.empty(); }
+
+        iterator begin() { return _values.begin(); }
+        iterator end() { return _values.end(); }
+        const_iterator begin() const { return _values.begin(); }
+        const_iterator end() const { return _values.end(); }
+
+        void clear()
+        {
+            _values.clear();
+            _buckets.assign(16, bucket_type());
+        }
+
+        /// @returns pointer to the value for the given key, or NULL.
+        T *find(const std::string& key)
+        {
+            const std::size_t n = this->lookup(key);
+            return (n == npos ? NULL : &_values[n].second);
+        }
+
+        const T *find(const std::string& key) const
+        {
+            const std::size_t n = this->lookup(key);
+            return (n == npos ? NULL : &_values[n].second);
+        }
+
+        /// Get the value for the given key, inserting T() if need be.
+        T& operator[] (const std::string& key)
+        {
+            std::size_t n = this->lookup(key);
+            if (n == npos)
+            {
+                if (_values.size() >= _buckets.size())
+                    this->rehash(_buckets.size() * 2);
+
+                n = _values.size();
+                _values.push_back(value_type(key, T()));
+                _buckets[hash_string(key) % _buckets.size()].push_back(n);
+            }
+            return _values[n].second;
+        }
+
+    private:
+        typedef std::vector<std::size_t> bucket_type;
+        static const std::size_t npos = static_cast<std::size_t>(-1);
+
+        std::size_t lookup(const std::string& key) const
+        {
+            const bucket_type& b(_buckets[hash_string(key) % _buckets.size()]);
+            for (bucket_type::const_iterator i = b.begin() ; i != b.end() ; ++i)
+                if (_values[*i].first == key)
+                    return *i;
+            return npos;
+        }
+
+        void rehash(std::size_t nbuckets)
+        {
+            _buckets.assign(nbuckets, bucket_type());
+            for (std::size_t n = 0 ; n != _values.size() ; ++n)
+                _buckets[hash_string(_values[n].first) % nbuckets].push_back(n);
+        }
+
+        /* values are kept in insertion order; buckets hold their indexes */
+        std::vector<value_type> _values;
+        std::vector<bucket_type> _buckets;
+};
+
+#endif /* _HAVE_SRC_HASH_MAP_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
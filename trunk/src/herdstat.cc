@@ -45,10 +45,14 @@
 #include "handler_map.hh"
 #include "xmlinit.hh"
 #include "formatter.hh"
+#include "record_sink.hh"
+#include "profiler.hh"
 #include "io/handler.hh"
 #include "io/stream.hh"
 #include "io/readline.hh"
 #include "io/batch.hh"
+#include "io/daemon.hh"
+#include "io/client.hh"
 #include "io/gui.hh"
 #include "action/handler.hh"
 #include "action/away.hh"
@@ -71,7 +75,7 @@ using namespace herdstat::portage;
 using namespace herdstat::xml;
 
 // {{{ getopt stuff
-static const char *short_opts = "H:o:hVvDdtpqFcnmwNErfaA:L:C:U:Tki:S";
+static const char *short_opts = "H:o:hVvDdtpqFcnmwNErfaA:L:C:U:Tki:Sj:";
 
 #ifdef HAVE_GETOPT_LONG
 static struct option long_opts[] =
@@ -89,8 +93,10 @@ static struct option long_opts[] =
     {"with-maintainer", required_argument,0,'\t'},
     /* force a fetch of herds.xml */
     {"fetch",	    no_argument,	0,  'F'},
-    /* time how long it takes for XML parsing */
+    /* time each phase of a query and count what it does */
     {"timer",	    no_argument,	0,  't'},
+    /* ... and write a Chrome trace of it instead of a summary */
+    {"trace",	    required_argument,	0,  '\005'},
     /* instead of displaying devs for a herd, display herds for a dev */
     {"dev",	    no_argument,	0,  'd'},
     /* specify the location of a local herds.xml */
@@ -123,6 +129,16 @@ static struct option long_opts[] =
     {"keywords",    no_argument,	0,  'k'},
     {"iomethod",    required_argument,  0,  'i'},
     {"no-spinner",  no_argument,        0,  'S'},
+    /* specify the socket herdstatd listens on */
+    {"socket",      required_argument,  0,  '\001'},
+    /* number of batch workers */
+    {"jobs",        required_argument,  0,  'j'},
+    /* prefix each batch request and reply with an id */
+    {"batch-ids",   no_argument,        0,  '\002'},
+    /* run batch requests in threads instead of processes */
+    {"threads",     no_argument,        0,  '\003'},
+    /* write results as JSON Lines or binary records */
+    {"output",      required_argument,  0,  '\004'},
     { 0, 0, 0, 0 }
 };
 #endif /* HAVE_GETOPT_LONG */
@@ -191,7 +207,18 @@ help()
 	<< " -a, --away              Look up away information for the specified developers." << std::endl
 	<< "     --versions          Look up versions of specified packages." << std::endl
 	<< " -k, --keywords          Display keywords for the specified packages." << std::endl
-	<< " -i, --iomethod          Front-end to use (readline, batch)." << std::endl
+	<< " -i, --iomethod          Front-end to use (readline, batch, daemon, client)." << std::endl
+	<< "     --socket <path>     Socket used by the daemon and client front-ends." << std::endl
+	<< " -j, --jobs <n>          Run batch requests in <n> worker processes (0 means" << std::endl
+	<< "                         one per processor).  Output stays in input order." << std::endl
+	<< "     --batch-ids         Batch input lines start with a request id; replies" << std::endl
+	<< "                         are framed as '@<id> <lines>' and may arrive out of order." << std::endl
+	<< "     --threads           Run batch requests in <n> threads sharing one copy" << std::endl
+	<< "                         of the caches instead of in worker processes." << std::endl
+	<< "     --output <format>   Write results as text (the default), json (one" << std::endl
+	<< "                         JSON object per record) or binary (length-prefixed" << std::endl
+	<< "                         records).  With --batch-ids, binary replies are" << std::endl
+	<< "                         framed by their length in bytes instead of lines." << std::endl
 	<< "     --field <field,criteria>" << std::endl
 	<< "                         Search by field (for use with --dev).  Possible fields" << std::endl
 	<< "                         are user,name,birthday,joined,status,location." << std::endl
@@ -224,7 +251,13 @@ help()
 	<< " -q, --quiet             Don't display labels and fancy colors. Use this" << std::endl
 	<< "                         option to pipe herdstat output to other programs" << std::endl
 	<< " -D, --debug             Display debugging messages." << std::endl
-	<< " -t, --timer             Display elapsed time of XML parsing." << std::endl
+	<< " -t, --timer             Display how long each phase (action handler steps," << std::endl
+	<< "                         XML parsing, cache validation, formatting, output)" << std::endl
+	<< "                         took and how many files were stat'ed, XML files" << std::endl
+	<< "                         parsed, regexes evaluated and result lines added," << std::endl
+	<< "                         on stderr at exit." << std::endl
+	<< "     --trace <file>      Like --timer, but write a Chrome trace (JSON) of" << std::endl
+	<< "                         every phase to <file> instead of the summary." << std::endl
 	<< " -c, --count             Display the number of items instead of the" << std::endl
 	<< "                         items themself." << std::endl
 	<< " -n, --nocolor           Don't display colored output." << std::endl
@@ -270,10 +303,11 @@ help()
 	<< "                 option to pipe herdstat output to other programs"
 	<< std::endl
 	<< " -D              Display debugging messages." << std::endl
-	<< " -t              Display elapsed time of XML parsing." << std::endl
+	<< " -t              Display how long each phase of the query took." << std::endl
 	<< " -c              Display the number of items instead of the" << std::endl
 	<< "                 items themself." << std::endl
 	<< " -n              Don't display colored output." << std::endl
+	<< " -j <n>          Run batch requests in <n> worker processes." << std::endl
 	<< std::endl
 	<< "Where [args] depends on the specified action:" << std::endl
 	<< " default action  1 or more herds." << std::endl
@@ -431,7 +465,6 @@ handle_opts(int argc, char **argv, Query *q)
 			options.set_outstream(&std::cerr);
 		    options.set_outfile(optarg);
 		    options.set_quiet(true);
-		    options.set_timer(false);
 		}
 		break;
 	    /* --regex */
@@ -508,8 +541,12 @@ handle_opts(int argc, char **argv, Query *q)
 		break;
 	    /* --timer */
 	    case 't':
-		if (options.outfile() == "stdout")
-		    options.set_timer(true);
+		options.set_timer(true);
+		break;
+	    /* --trace */
+	    case '\005':
+		options.set_timer(true);
+		options.set_trace(optarg);
 		break;
 	    /* --qa */
 	    case '\a':
@@ -519,6 +556,29 @@ handle_opts(int argc, char **argv, Query *q)
 	    case 'i':
 		options.set_iomethod(optarg);
 		break;
+	    /* --socket */
+	    case '\001':
+		options.set_socket(optarg);
+		break;
+	    /* --jobs */
+	    case 'j':
+		options.set_batch_jobs(util::destringify<unsigned>(optarg));
+		break;
+	    /* --batch-ids */
+	    case '\002':
+		options.set_batch_ids(true);
+		break;
+	    /* --threads */
+	    case '\003':
+		options.set_batch_threads(true);
+		break;
+	    /* --output */
+	    case '\004':
+		if (not RecordSink::is_format(optarg))
+		    throw BadOption(std::string("Unknown output format '") +
+			optarg + "'.  Use text, json or binary.");
+		options.set_output(optarg);
+		break;
 	    /* --version */
 	    case 'V':
 		throw argsVersion();
@@ -560,17 +620,52 @@ handle_opts(int argc, char **argv, Query *q)
 	    action != "versions" and
 	    action != "fetch" and
 	    action != "keywords" and
-	    (options.iomethod() == "stream"))
+	    (options.iomethod() == "stream" or options.iomethod() == "client"))
 	    throw argsUsage();
     }
 
     return true;
 }
 
+/* command line -> query, shared with the daemon which does the same for
+ * each command line forwarded by a client */
+static void
+parse_args(int argc, char **argv, Query *q)
+{
+    Options& options(GlobalOptions());
+
+    if (not handle_opts(argc, argv, q))
+        throw argsException();
+
+    if (not q->empty() and q->front().second == "all")
+    {
+        q->erase(q->begin());
+        q->set_all(true);
+    }
+
+    /* set path to herds.xml and userinfo.xml if --gentoo-cvs was specified */
+    if (not options.cvsdir().empty())
+    {
+        const std::string gentoocvs(options.cvsdir());
+        if (not util::is_dir(gentoocvs))
+            throw FileException(gentoocvs);
+
+        /* only set if it wasnt specified on the command line */
+        if (options.herdsxml().empty())
+            options.set_herdsxml(gentoocvs+"/gentoo/misc/herds.xml");
+        if (options.userinfoxml().empty())
+            options.set_userinfoxml(gentoocvs+"/gentoo/xml/htdocs/proj/en/devrel/roll-call/userinfo.xml");
+    }
+
+    /* set default action */
+    if (q->action() == "unspecified")
+        q->set_action(q->all() ? "herd" : q->empty() ? "stats" : "herd");
+}
+
 int
 main(int argc, char **argv)
 {
-    BacktraceContext c("main()");
+    TraceContext c("main()");
 
     Options& options(GlobalOptions());
     std::ostream *outstream = NULL;
@@ -584,6 +679,8 @@ main(int argc, char **argv)
             options.set_iomethod("gtk");
         else if (util::basename(argv[0]) == PACKAGE"-qt")
             options.set_iomethod("qt");
+        else if (util::basename(argv[0]) == PACKAGE"d")
+            options.set_iomethod("daemon");
     }
 
     bool test = false;
@@ -614,28 +711,11 @@ main(int argc, char **argv)
 	    options.set_iomethod(getenv_result);
 
 	/* handle command line options */
-	if (not handle_opts(argc, argv, &q))
-	    throw argsException();
+	parse_args(argc, argv, &q);
 
-        if (not q.empty() and q.front().second == "all")
-        {
-            q.erase(q.begin());
-            q.set_all(true);
-        }
-
-	/* set path to herds.xml and userinfo.xml if --gentoo-cvs was specified */
-	if (not options.cvsdir().empty())
-	{
-	    const std::string gentoocvs(options.cvsdir());
-	    if (not util::is_dir(gentoocvs))
-		throw FileException(gentoocvs);
-
-	    /* only set if it wasnt specified on the command line */
-	    if (options.herdsxml().empty())
-		options.set_herdsxml(gentoocvs+"/gentoo/misc/herds.xml");
-	    if (options.userinfoxml().empty())
-		options.set_userinfoxml(gentoocvs+"/gentoo/xml/htdocs/proj/en/devrel/roll-call/userinfo.xml");
-	}
+	/* --timer/--trace */
+	if (options.timer())
+	    GlobalProfiler().enable(options.trace());
 
 	/* setup output stream */
 	if (options.outfile() != "stdout" and options.outfile() != "stderr")
@@ -660,10 +740,6 @@ main(int argc, char **argv)
             }
         }
 
-	/* set default action */
-	if (q.action() == "unspecified")
-	    q.set_action(q.all() ? "herd" : q.empty() ? "stats" : "herd");
-
 	/* setup action handlers */
 	HandlerMap<ActionHandler>& handlers(GlobalHandlerMap<ActionHandler>());
 	handlers.insert(std::make_pair("away", new AwayActionHandler()));
@@ -681,6 +757,8 @@ main(int argc, char **argv)
 	HandlerMap<IOHandler>& iohandlers(GlobalHandlerMap<IOHandler>());
 	iohandlers.insert(std::make_pair("stream", new StreamIOHandler()));
 	iohandlers.insert(std::make_pair("batch", new BatchIOHandler()));
+	iohandlers.insert(std::make_pair("daemon", new DaemonIOHandler(&parse_args)));
+	iohandlers.insert(std::make_pair("client", new ClientIOHandler(argc, argv)));
 
 #ifdef READLINE_FRONTEND
 	iohandlers.insert(std::make_pair("readline", new ReadLineIOHandler()));
@@ -712,6 +790,9 @@ main(int argc, char **argv)
 		break;
 	}
 
+	if (GlobalProfiler().enabled())
+	    GlobalProfiler().report(std::cerr);
+
 	if (outstream)
 	    delete outstream;
 
@@ -729,6 +810,8 @@ main(int argc, char **argv)
     // {{{ catches
     catch (const ActionException&)
     {
+	if (GlobalProfiler().enabled())
+	    GlobalProfiler().report(std::cerr);
         return EXIT_FAILURE;
     }
     catch (const ActionUnimplemented& e)
@@ -74,6 +74,7 @@ PrintIOActionHandler::generate_completions(std::vector<std::string> *v) const
         "metacache_expire",
         "locale",
         "iomethod",
+        "output",
         "portdir",
         "with_dev",
         "with_herd",
@@ -115,6 +116,7 @@ PrintIOActionHandler::do_results(Query& query,
         else ADD_IF_EQUAL(metacache_expire)
         else ADD_IF_EQUAL(locale)
         else ADD_IF_EQUAL(iomethod)
+        else ADD_IF_EQUAL(output)
         else ADD_IF_EQUAL(portdir)
         else ADD_IF_EQUAL(with_dev)
         else ADD_IF_EQUAL(with_herd)
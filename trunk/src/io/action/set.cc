@@ -27,6 +27,7 @@
 #include <herdstat/util/string.hh>
 #include "handler_map.hh"
 #include "formatter.hh"
+#include "record_sink.hh"
 #include "io/action/set.hh"
 
 using namespace herdstat;
@@ -77,7 +78,8 @@ SetIOActionHandler::generate_completions(std::vector<std::string> *v) const
         "hlcolor",
         "with_dev",
         "with_herd",
-        "metacache_expire"
+        "metacache_expire",
+        "output"
     };
 
     v->assign(comps, comps+NELEMS(comps));
@@ -166,6 +168,12 @@ SetIOActionHandler::do_results(Query& query,
             else SET_STR_IF_EQUAL(with_dev)
             else SET_STR_IF_EQUAL(with_herd)
             else SET_STR_IF_EQUAL(metacache_expire)
+            else if (key == "output")
+            {
+                if (not RecordSink::is_format(val))
+                    throw Exception("Unknown output format '"+val+"'");
+                options.set_output(val);
+            }
             else results->add("Unknown option '" + key + "'.");
 
 #undef SET_INT_IF_EQUAL
@@ -26,20 +26,277 @@
 
 #include <string>
 #include <vector>
+#include <map>
+#include <memory>
+#include <sstream>
 #include <iterator>
 #include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 
+#include <herdstat/noncopyable.hh>
 #include <herdstat/util/string.hh>
 #include <herdstat/util/functional.hh>
 
 #include "exceptions.hh"
 #include "handler_map.hh"
+#include "session.hh"
+#include "threads.hh"
+#include "query_context.hh"
+#include "package_cache.hh"
+#include "metadata_cache.hh"
+#include "ebuild_cache.hh"
+#include "record_sink.hh"
 #include "action/handler.hh"
 #include "io/action/help.hh"
+#include "io/socket.hh"
 #include "io/batch.hh"
 
+/* how many lines may be read ahead of the last reply written, per worker */
+#define BATCH_READAHEAD_PER_JOB 4
+
 using namespace herdstat;
 
+namespace {
+
+    struct Worker
+    {
+        pid_t pid;
+        UnixSocket *sock;
+        bool busy;
+        std::size_t seq;    /* sequence number of the request it's running */
+        std::string id;     /* ... and its request id */
+    };
+
+    /* closes the workers' sockets (so they exit) and reaps them, however
+     * run_parallel() is left */
+    class WorkerPool : private Noncopyable
+    {
+        public:
+            ~WorkerPool()
+            {
+                std::vector<Worker>::iterator i;
+                for (i = workers.begin() ; i != workers.end() ; ++i)
+                    delete i->sock;
+                for (i = workers.begin() ; i != workers.end() ; ++i)
+                {
+                    int status;
+                    while (::waitpid(i->pid, &status, 0) < 0 and errno == EINTR)
+                        ;
+                }
+            }
+
+            std::vector<Worker> workers;
+    };
+
+    /* reads lines from a descriptor without blocking for more than poll()
+     * said was there, so a client that waits for each reply before writing
+     * its next request doesn't deadlock against the read-ahead */
+    class LineReader
+    {
+        public:
+            LineReader(int fd) : _fd(fd), _eof(false) { }
+
+            bool eof() const { return _eof; }
+
+            /// Is there input waiting to be read?
+            bool ready() const
+            {
+                struct pollfd p = { _fd, POLLIN, 0 };
+                return (::poll(&p, 1, 0) > 0);
+            }
+
+            void fill()
+            {
+                char buf[4096];
+                ssize_t n;
+                do n = ::read(_fd, buf, sizeof(buf));
+                while (n < 0 and errno == EINTR);
+
+                if (n < 0)
+                    throw ErrnoException("read");
+                else if (n == 0)
+                    _eof = true;
+                else
+                    _buf.append(buf, n);
+            }
+
+            bool next(std::string *line)
+            {
+                std::string::size_type pos = _buf.find('\n');
+                if (pos == std::string::npos)
+                {
+                    /* last line without a trailing newline */
+                    if (not _eof or _buf.empty())
+                        return false;
+                    pos = _buf.size();
+                }
+
+                line->assign(_buf, 0, pos);
+                _buf.erase(0, pos + 1);
+                return true;
+            }
+
+        private:
+            int _fd;
+            bool _eof;
+            std::string _buf;
+    };
+
+    /* a request of a threaded batch */
+    struct Request
+    {
+        Request() : id(), in(), reply(), serial(false) { }
+
+        std::string id;
+        std::string in;
+        std::string reply;
+        /* has to run on the main thread (help, for one) */
+        bool serial;
+    };
+
+    class RequestWorker : public Thread
+    {
+        public:
+            struct Shared
+            {
+                Shared(std::vector<Request>& r, bool i)
+                    : requests(r), ids(i), next(0) { }
+
+                std::vector<Request>& requests;
+                const bool ids;
+                std::size_t next;
+                Mutex mutex;
+                /* held while writing a reply when ids are on */
+                Mutex output;
+            };
+
+            RequestWorker(Shared& shared) : _shared(shared) { }
+
+        protected:
+            virtual void run();
+
+        private:
+            Shared& _shared;
+    };
+
+} // namespace
+
+/* split the request id off the front of a line */
+static std::string
+take_id(std::string *in)
+{
+    std::string::size_type pos = in->find_first_of(" \t");
+    const std::string id(in->substr(0, pos));
+    if (pos != std::string::npos)
+        pos = in->find_first_not_of(" \t", pos);
+    in->erase(0, pos);
+    return id;
+}
+
+/* binary replies are framed by their size, since they aren't lines */
+static void
+write_reply(std::ostream& stream, const std::string& id,
+            const std::string& reply)
+{
+    stream << "@" << id << " ";
+    if (GlobalOptions().output() == "binary")
+        stream << reply.size();
+    else
+        stream << std::count(reply.begin(), reply.end(), '\n');
+    stream << "\n" << reply << std::flush;
+}
+
+static void
+run_in_context(Request *r)
+{
+    std::ostringstream out;
+    QueryContext context;
+    StreamSink text(out);
+    std::auto_ptr<RecordSink> records(
+        RecordSink::create(context.options().output(), out));
+    QueryResults results;
+    Query query;
+
+    /* anything the action writes directly belongs in its reply too */
+    context.options().set_outstream(&out);
+    results.set_sink(records.get() ? records.get() :
+                     static_cast<ResultsSink *>(&text));
+
+    std::vector<std::string> parts;
+    util::split(r->in, std::back_inserter(parts));
+
+    const std::string action(parts.front());
+    parts.erase(parts.begin());
+
+    if (not parts.empty() and parts.front() == "all")
+    {
+        query.set_all(true);
+        parts.erase(parts.begin());
+    }
+
+    std::copy(parts.begin(), parts.end(), std::back_inserter(query));
+
+    if (records.get())
+        records->begin(action);
+
+    /* results go straight into the reply as they're added */
+    try
+    {
+        context(action, query, &results);
+    }
+    catch (const ActionException&)
+    {
+        /* whatever it did add has been written already */
+    }
+    catch (const Exception& e)
+    {
+        out << "Oops!" << std::endl << "  * " << e.what() << std::endl;
+    }
+    catch (const BaseException& e)
+    {
+        out << "Unhandled exception: " << e.what() << std::endl;
+    }
+
+    if (records.get())
+        records->finish();
+
+    r->reply = out.str();
+}
+
+void
+RequestWorker::run()
+{
+    while (true)
+    {
+        std::size_t n;
+        {
+            MutexLock l(_shared.mutex);
+            if (_shared.next == _shared.requests.size())
+                return;
+            n = _shared.next++;
+        }
+
+        Request& r(_shared.requests[n]);
+        if (r.serial)
+            continue;
+
+        run_in_context(&r);
+
+        if (_shared.ids)
+        {
+            MutexLock l(_shared.output);
+            write_reply(GlobalOptions().outstream(), r.id, r.reply);
+        }
+    }
+}
+
 BatchIOHandler::BatchIOHandler()
 {
     insert_local_handler<HelpIOActionHandler>("help");
@@ -53,22 +310,64 @@ bool
 BatchIOHandler::operator()(Query * const query)
 {
     Options& options(GlobalOptions());
+
+    unsigned jobs = options.batch_jobs();
+    if (jobs == 0)
+        jobs = available_cpus();
+
+    if (jobs > 1)
+    {
+        if (options.batch_threads())
+            run_threaded(jobs);
+        else
+            run_parallel(jobs);
+        return false;
+    }
+
+    std::string in;
+    if (not std::getline(std::cin, in))
+        return false;
+
+    if (not options.batch_ids() or in.empty() or
+        in == "exit" or in == "quit")
+        return run(in, query, options.outstream());
+
+    const std::string id(take_id(&in));
+    std::ostringstream out;
+    const bool more = run(in, query, out);
+    write_reply(options.outstream(), id, out.str());
+    return more;
+}
+
+bool
+BatchIOHandler::run(const std::string& in, Query * const query,
+                    std::ostream& out)
+{
+    Options& options(GlobalOptions());
+    StreamSink text(out);
+    std::auto_ptr<RecordSink> records(
+        RecordSink::create(options.output(), out));
     QueryResults results;
 
+    /* records keep their labels, so only plain text has to be quiet */
     options.set_color(false);
-    options.set_quiet(true);
+    if (not records.get())
+        options.set_quiet(true);
+
+    /* results go straight to out as they're added */
+    results.set_sink(records.get() ? records.get() :
+                     static_cast<ResultsSink *>(&text));
 
     try
     {
-        std::string in;
-        if (not std::getline(std::cin, in))
-            return false;
-
         if (in.empty())
             return true;
         if (in == "exit" or in == "quit")
             return false;
 
+        /* caches stay loaded; they just check they're still current */
+        GlobalSession().begin_query();
+
         std::vector<std::string> parts;
         util::split(in, std::back_inserter(parts));
         if (parts.empty())
@@ -110,24 +409,356 @@ BatchIOHandler::operator()(Query * const query)
             h = local_handler("help");
         }
 
+        if (records.get())
+            records->begin(h->id());
+
         (*h)(*query, &results);
-        std::transform(results.begin(), results.end(),
-            std::ostream_iterator<std::string>(options.outstream(), "\n"),
-            util::Second<QuerySpec>());
     }
     catch (const ActionUnimplemented& e)
     {
-        options.outstream() << "Unknown action '"
+        out << "Unknown action '"
             << e.what() << "'.  Try 'help'." << std::endl;
     }
     catch (const ActionException)
     {
-        std::transform(results.begin(), results.end(),
-            std::ostream_iterator<std::string>(options.outstream(), "\n"),
-            util::Second<QuerySpec>());
+        /* whatever it did add has been written already */
     }
 
+    if (records.get())
+        records->finish();
+
     return true;
 }
 
+void
+BatchIOHandler::run_parallel(unsigned jobs)
+{
+    Options& options(GlobalOptions());
+    const bool ids = options.batch_ids();
+    const std::size_t window = jobs * BATCH_READAHEAD_PER_JOB;
+
+    /* a dead worker shouldn't take us with it */
+    signal(SIGPIPE, SIG_IGN);
+
+    /* bring the caches up to date once so the workers inherit them, rather
+     * than each checking the tree, regenerating whatever's stale and racing
+     * the others to save it */
+    const PackageCache& pkgcache(GlobalPkgCache(NULL));
+    GlobalMetadataCache().update(NULL);
+    GlobalEbuildCache().read_all(pkgcache);
+
+    options.outstream() << std::flush;
+
+    WorkerPool pool;
+    std::vector<Worker>& workers(pool.workers);
+
+    for (unsigned n = 0 ; n < jobs ; ++n)
+    {
+        int fds[2];
+        if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            throw ErrnoException("socketpair");
+
+        const pid_t pid = ::fork();
+        if (pid < 0)
+        {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            throw ErrnoException("fork");
+        }
+        else if (pid == 0)
+        {
+            ::close(fds[0]);
+            std::vector<Worker>::iterator i;
+            for (i = workers.begin() ; i != workers.end() ; ++i)
+                ::close(i->sock->fd());
+
+            try
+            {
+                serve(fds[1]);
+            }
+            catch (...)
+            {
+                ::_exit(EXIT_FAILURE);
+            }
+
+            ::_exit(EXIT_SUCCESS);
+        }
+
+        ::close(fds[1]);
+
+        Worker w;
+        w.pid = pid;
+        w.sock = new UnixSocket(fds[0]);
+        w.busy = false;
+        w.seq = 0;
+        workers.push_back(w);
+    }
+
+    LineReader reader(STDIN_FILENO);
+    /* replies waiting for an earlier one to finish */
+    std::map<std::size_t, std::string> done;
+    std::size_t nread = 0, nwritten = 0, nbusy = 0;
+    bool stop = false;
+
+    while (true)
+    {
+        /* hand out whatever we've read to idle workers */
+        std::vector<Worker>::iterator w = workers.begin();
+        while (not stop and w != workers.end() and
+               (nread - nwritten) < window)
+        {
+            if (w->busy)
+            {
+                ++w;
+                continue;
+            }
+
+            std::string in;
+            if (not reader.next(&in))
+                break;
+
+            if (in.empty())
+                continue;
+            else if (in == "exit" or in == "quit")
+            {
+                stop = true;
+                break;
+            }
+
+            std::string id;
+            if (ids)
+                id = take_id(&in);
+
+            w->sock->send(in);
+            w->busy = true;
+            w->seq = nread++;
+            w->id = id;
+            ++nbusy;
+        }
+
+        const bool want_input = not stop and not reader.eof() and
+                                (nread - nwritten) < window;
+        if (nbusy == 0 and not want_input)
+            break;
+
+        std::vector<struct pollfd> fds;
+        std::vector<Worker *> polled;
+        if (want_input)
+        {
+            struct pollfd p = { STDIN_FILENO, POLLIN, 0 };
+            fds.push_back(p);
+            polled.push_back(NULL);
+        }
+
+        for (w = workers.begin() ; w != workers.end() ; ++w)
+        {
+            if (not w->busy)
+                continue;
+            struct pollfd p = { w->sock->fd(), POLLIN, 0 };
+            fds.push_back(p);
+            polled.push_back(&*w);
+        }
+
+        if (::poll(&fds[0], fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw ErrnoException("poll");
+        }
+
+        for (std::size_t i = 0 ; i < fds.size() ; ++i)
+        {
+            if (not fds[i].revents)
+                continue;
+
+            if (not polled[i])
+            {
+                reader.fill();
+                continue;
+            }
+
+            Worker *worker = polled[i];
+            std::string reply;
+            if (not worker->sock->recv(&reply))
+                throw Exception("batch worker exited unexpectedly");
+
+            worker->busy = false;
+            --nbusy;
+
+            if (ids)
+            {
+                write_reply(options.outstream(), worker->id, reply);
+                ++nwritten;
+            }
+            else
+                done.insert(std::make_pair(worker->seq, reply));
+        }
+
+        /* write out everything that's now in order */
+        std::map<std::size_t, std::string>::iterator d;
+        while ((d = done.find(nwritten)) != done.end())
+        {
+            options.outstream() << d->second;
+            done.erase(d);
+            ++nwritten;
+        }
+        options.outstream() << std::flush;
+    }
+}
+
+void
+BatchIOHandler::run_threaded(unsigned jobs)
+{
+    Options& options(GlobalOptions());
+    const bool ids = options.batch_ids();
+    const std::size_t window = jobs * BATCH_READAHEAD_PER_JOB;
+    LineReader reader(STDIN_FILENO);
+    bool stop = false;
+
+    /* each context copies these */
+    options.set_color(false);
+    if (options.output() == "text")
+        options.set_quiet(true);
+
+    while (not stop)
+    {
+        std::vector<Request> requests;
+
+        while (requests.size() < window)
+        {
+            std::string in;
+            if (reader.next(&in))
+            {
+                if (in.empty())
+                    continue;
+                else if (in == "exit" or in == "quit")
+                {
+                    stop = true;
+                    break;
+                }
+
+                Request r;
+                if (ids)
+                    r.id = take_id(&in);
+                r.in = in;
+                requests.push_back(r);
+                continue;
+            }
+
+            if (reader.eof())
+            {
+                stop = true;
+                break;
+            }
+
+            /* don't wait for more if there's something to do already */
+            if (not requests.empty() and not reader.ready())
+                break;
+
+            reader.fill();
+        }
+
+        if (requests.empty())
+            break;
+
+        /* no queries are running, so the caches may be revalidated; then
+         * get everything the actions need ready so they only read it */
+        GlobalSession().begin_query();
+
+        HandlerMap<ActionHandler>&
+            handlers(GlobalHandlerMap<ActionHandler>());
+        std::map<std::string, bool> prepared;
+        std::vector<Request>::iterator r;
+        for (r = requests.begin() ; r != requests.end() ; ++r)
+        {
+            std::vector<std::string> parts;
+            util::split(r->in, std::back_inserter(parts));
+            if (parts.empty() or is_local_handler(parts.front()))
+            {
+                r->serial = true;
+                continue;
+            }
+
+            const std::string& action(parts.front());
+            std::map<std::string, bool>::iterator p = prepared.find(action);
+            if (p == prepared.end())
+                p = prepared.insert(std::make_pair(action,
+                        QueryContext::prepare(action))).first;
+
+            /* no arguments means help for most actions */
+            if (not p->second or ((parts.size() == 1) and
+                    not handlers[action]->allow_empty_query()))
+                r->serial = true;
+        }
+
+        RequestWorker::Shared shared(requests, ids);
+        {
+            ThreadGroup<RequestWorker> workers;
+            for (std::size_t n = 0 ; n < jobs and n < requests.size() ; ++n)
+                workers.add(new RequestWorker(shared));
+
+            run_threads(workers.begin(), workers.end());
+        }
+
+        /* whatever couldn't run in a context runs here, one at a time */
+        for (r = requests.begin() ; r != requests.end() ; ++r)
+        {
+            if (not r->serial)
+                continue;
+
+            Query query;
+            std::ostringstream out;
+            run(r->in, &query, out);
+            r->reply = out.str();
+
+            if (ids)
+                write_reply(options.outstream(), r->id, r->reply);
+        }
+
+        if (not ids)
+        {
+            for (r = requests.begin() ; r != requests.end() ; ++r)
+                options.outstream() << r->reply;
+        }
+
+        options.outstream() << std::flush;
+    }
+}
+
+void
+BatchIOHandler::serve(int fd)
+{
+    Options& options(GlobalOptions());
+    std::ostream * const outstream = &options.outstream();
+    UnixSocket parent(fd);
+    std::string in;
+
+    while (parent.recv(&in))
+    {
+        Query query;
+        std::ostringstream out;
+
+        /* anything an action writes directly belongs in its reply too */
+        options.set_outstream(&out);
+
+        try
+        {
+            run(in, &query, out);
+        }
+        catch (const Exception& e)
+        {
+            out << "Oops!" << std::endl << "  * " << e.backtrace(":\n  * ")
+                << e.what() << std::endl;
+        }
+        catch (const BaseException& e)
+        {
+            out << "Unhandled exception: " << e.backtrace(":\n  * ")
+                << e.what() << std::endl;
+        }
+
+        options.set_outstream(outstream);
+        parent.send(out.str());
+    }
+}
+
 /* vim: set tw=80 sw=4 fdm=marker et : */
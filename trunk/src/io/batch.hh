@@ -27,11 +27,22 @@
 # include "config.h"
 #endif
 
+#include <iosfwd>
 #include "io/handler.hh"
 
 /**
  * @class BatchIOHandler
  * @brief I/O handler for the batch front-end.
+ *
+ * Reads one request per line from stdin.  With more than one job (-j), stdin
+ * is read ahead and the requests are handed out to a pool of worker processes,
+ * each with its own handlers and caches.  Replies are written in input order,
+ * unless request ids are enabled (--batch-ids), in which case each line starts
+ * with an id and each reply is written as soon as it's ready, framed as
+ * '@<id> <number of lines>' followed by that many lines.
+ *
+ * With --threads the requests run in threads of this process instead, each
+ * in its own QueryContext, against a single copy of the caches.
  */
 
 class BatchIOHandler : public IOHandler
@@ -40,6 +51,22 @@ class BatchIOHandler : public IOHandler
         BatchIOHandler();
         virtual ~BatchIOHandler();
         virtual bool operator()(Query * const query);
+
+    private:
+        /** Run a single request, writing the reply to the given stream.
+         * @returns false if the request was 'exit' or 'quit'.
+         */
+        bool run(const std::string& in, Query * const query,
+                 std::ostream& out);
+
+        /// Run every request on stdin using the given number of workers.
+        void run_parallel(unsigned jobs);
+
+        /// Run every request on stdin using the given number of threads.
+        void run_threaded(unsigned jobs);
+
+        /// Worker process main loop; serves requests until fd is closed.
+        void serve(int fd);
 };
 
 #endif /* _HAVE_BATCH_HH */
@@ -0,0 +1,79 @@
+/*
+ * herdstat -- src/io/client.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+
+#include <herdstat/util/misc.hh>
+#include <herdstat/util/string.hh>
+
+#include "common.hh"
+#include "exceptions.hh"
+#include "io/socket.hh"
+#include "io/daemon.hh"
+#include "io/client.hh"
+
+using namespace herdstat;
+
+ClientIOHandler::ClientIOHandler(int argc, char **argv)
+    : _argc(argc), _argv(argv)
+{
+}
+
+bool
+ClientIOHandler::operator()(Query * const query LIBHERDSTAT_UNUSED)
+{
+    Options& options(GlobalOptions());
+
+    /* the options have already been checked locally; the daemon
+     * parses them again on its side. */
+    std::vector<std::string> request;
+    request.push_back(DAEMON_PROTOCOL_VERSION);
+    request.push_back(util::stringify(options.maxcol()));
+    request.push_back(util::getcwd());
+    std::transform(_argv + 1, _argv + _argc,
+        std::back_inserter(request), util::stringify<char *>);
+
+    UnixSocket sock;
+    sock.connect(daemon_socket_path());
+    sock.send(request);
+
+    std::string out, err, status;
+    if (not sock.recv(&out) or not sock.recv(&err) or not sock.recv(&status))
+        throw Exception(PACKAGE"d closed the connection without replying");
+
+    options.outstream() << out << std::flush;
+    std::cerr << err << std::flush;
+
+    if (status != "0")
+        throw ActionException();
+
+    return false;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,262 @@
+/*
+ * herdstat -- src/io/daemon.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sstream>
+#include <signal.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include <herdstat/util/misc.hh>
+#include <herdstat/util/string.hh>
+
+#include "common.hh"
+#include "exceptions.hh"
+#include "handler_map.hh"
+#include "xmlinit.hh"
+#include "session.hh"
+#include "package_cache.hh"
+#include "action/handler.hh"
+#include "io/daemon.hh"
+
+using namespace herdstat;
+
+static volatile sig_atomic_t quit_requested = 0;
+
+extern "C" void
+daemon_on_signal(int sig LIBHERDSTAT_UNUSED)
+{
+    quit_requested = 1;
+}
+
+DaemonIOHandler::DaemonIOHandler(ArgParser parse_args)
+    : _parse_args(parse_args), _socket(), _started(false), _cwd(),
+      _cwd_errno(0)
+{
+}
+
+DaemonIOHandler::~DaemonIOHandler()
+{
+}
+
+void
+DaemonIOHandler::start()
+{
+    Options& options(GlobalOptions());
+    const std::string path(daemon_socket_path());
+
+    /* no SA_RESTART, so a signal knocks us out of accept() */
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = daemon_on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    /* a client going away mid-reply shouldn't take us with it */
+    signal(SIGPIPE, SIG_IGN);
+
+    _socket.listen(path);
+    _cwd = util::getcwd();
+
+    /* everything loaded from here on stays resident; clients connecting
+     * in the meantime simply wait in the backlog. */
+    GlobalXMLInit();
+    GlobalPkgCache(NULL);
+
+    /* each request starts from the options we were started with */
+    options.save();
+    _started = true;
+
+    if (options.verbose())
+        std::cerr << PACKAGE << "d listening on " << path << std::endl;
+}
+
+bool
+DaemonIOHandler::operator()(Query * const query)
+{
+    if (not _started)
+        start();
+
+    int fd;
+    while ((fd = _socket.accept()) < 0)
+    {
+        if (quit_requested)
+        {
+            _socket.close();
+            return false;
+        }
+    }
+
+    UnixSocket client(fd);
+
+    try
+    {
+        std::vector<std::string> request;
+        if (client.recv(&request))
+        {
+            std::ostringstream out, err;
+            const int status = serve(request, query, out, err);
+
+            /* outstream points at 'out' */
+            GlobalOptions().restore();
+
+            client.send(out.str());
+            client.send(err.str());
+            client.send(util::stringify(status));
+        }
+    }
+    catch (const BaseException& e)
+    {
+        /* the client went away or sent garbage; only it suffers */
+        GlobalOptions().restore();
+        debug_msg("dropping client: %s", e.what());
+    }
+
+    /* every later request would run from the wrong directory */
+    if (_cwd_errno)
+    {
+        _socket.close();
+        errno = _cwd_errno;
+        throw ErrnoException(_cwd);
+    }
+
+    return (not quit_requested);
+}
+
+void
+DaemonIOHandler::restore_cwd()
+{
+    if (chdir(_cwd.c_str()) != 0)
+    {
+        _cwd_errno = errno;
+        throw ErrnoException(_cwd);
+    }
+}
+
+int
+DaemonIOHandler::serve(const std::vector<std::string>& request,
+                       Query * const query,
+                       std::ostream& out, std::ostream& err)
+{
+    Options& options(GlobalOptions());
+    QueryResults results;
+
+    if (request.size() < 3 or request[0] != DAEMON_PROTOCOL_VERSION)
+    {
+        err << PACKAGE << "d: unsupported request (client and daemon "
+            << "versions differ?)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    /* rebuild argv as the client saw it */
+    std::vector<std::string> args(1, PACKAGE);
+    args.insert(args.end(), request.begin() + 3, request.end());
+
+    std::vector<char *> argv;
+    std::vector<std::string>::iterator i;
+    for (i = args.begin() ; i != args.end() ; ++i)
+        argv.push_back(const_cast<char *>(i->c_str()));
+    argv.push_back(NULL);
+
+    options.restore();
+    options.set_iomethod("stream");
+    GlobalSession().begin_query();
+
+    try
+    {
+        /* 0 makes GNU getopt start over from scratch */
+        optind = 0;
+        _parse_args(args.size(), &argv.front(), query);
+
+        /* output belongs to the client, not our terminal */
+        options.set_maxcol(util::destringify<std::size_t>(request[1]));
+        options.set_outstream(&out);
+        options.set_spinner(false);
+        update_attrs();
+
+        ActionHandler *h = (GlobalHandlerMap<ActionHandler>())[query->action()];
+        if (not h)
+            throw ActionUnimplemented(query->action());
+
+        stream_results(&results, query->action());
+        init_xml_if_necessary(query->action());
+
+        if (query->empty() and h->allow_pwd_query())
+        {
+            if (chdir(request[2].c_str()) != 0)
+                throw ErrnoException(request[2]);
+
+            try
+            {
+                h->handle_pwd_query(query, &results);
+            }
+            catch (...)
+            {
+                restore_cwd();
+                throw;
+            }
+
+            restore_cwd();
+        }
+
+        (*h)(*query, &results);
+        display(results);
+    }
+    catch (const ActionException&)
+    {
+        display(results);
+        return EXIT_FAILURE;
+    }
+    catch (const ActionUnimplemented& e)
+    {
+        err << "Invalid action '" << e.what() << "'.  Try --help." << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const argsException&)
+    {
+        err << "usage: " << PACKAGE << " [options] [args]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const Exception& e)
+    {
+        err << "Oops!" << std::endl << "  * " << e.backtrace(":\n  * ")
+            << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    catch (const BaseException& e)
+    {
+        err << "Unhandled exception: " << e.backtrace(":\n  * ")
+            << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
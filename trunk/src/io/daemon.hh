@@ -0,0 +1,85 @@
+/*
+ * herdstat -- src/io/daemon.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+
+#ifndef _HAVE_IO_DAEMON_HH
+#define _HAVE_IO_DAEMON_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include "io/pretty.hh"
+#include "io/socket.hh"
+
+/// Version of the request/reply format spoken over the daemon socket.
+#define DAEMON_PROTOCOL_VERSION "1"
+
+/**
+ * @class DaemonIOHandler
+ * @brief I/O handler for herdstatd.  Serves queries forwarded by
+ * ClientIOHandler over a UNIX socket, keeping parsed XML and caches resident
+ * between them.
+ *
+ * A request is a single message holding the protocol version, the client's
+ * column width, its working directory, and its argv (minus argv[0]).  The
+ * reply is three messages: standard output, standard error and the exit
+ * status.
+ */
+
+class DaemonIOHandler : public PrettyIOHandler
+{
+    public:
+        /// Function that turns argv into a query (and sets options).
+        typedef void (*ArgParser)(int argc, char **argv, Query *query);
+
+        DaemonIOHandler(ArgParser parse_args);
+        virtual ~DaemonIOHandler();
+
+        /// Serve one connection.  Returns false once we've been told to quit.
+        virtual bool operator()(Query * const query);
+
+    private:
+        /// Load everything up front so the first client doesn't pay for it.
+        void start();
+        /// Run a single request, filling the output buffers.
+        int serve(const std::vector<std::string>& request, Query * const query,
+                  std::ostream& out, std::ostream& err);
+        /**
+         * Change back to the directory we were started from after a pwd
+         * query.  Failing to is fatal: the request fails, and operator()
+         * throws once the client has its reply.
+         */
+        void restore_cwd();
+
+        ArgParser _parse_args;
+        UnixSocket _socket;
+        bool _started;
+        std::string _cwd;
+        /* errno, if restore_cwd() failed */
+        int _cwd_errno;
+};
+
+#endif /* _HAVE_IO_DAEMON_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -32,14 +32,9 @@ using namespace herdstat;
 
 PrettyIOHandler::PrettyIOHandler()
     : output(GlobalFormatter()), attrs(output.attrs()),
-      opts(GlobalOptions()), color(GlobalColorMap())
+      opts(GlobalOptions()), color(GlobalColorMap()), records(NULL)
 {
-    /* set common format attributes */
-    attrs.set_maxlen(opts.maxcol());
-    attrs.set_quiet(opts.quiet());
-    attrs.set_label_color(color[opts.labelcolor()]);
-    attrs.set_highlight_color(color[opts.hlcolor()]);
-    attrs.set_colors(opts.color());
+    update_attrs();
 
     /* add highlights */
     const std::string user(util::current_user());
@@ -52,9 +47,60 @@ PrettyIOHandler::PrettyIOHandler()
     attrs.add_highlights(v);
 }
 
+PrettyIOHandler::~PrettyIOHandler()
+{
+    if (records)
+        delete records;
+}
+
+void
+PrettyIOHandler::update_attrs()
+{
+    /* set common format attributes */
+    attrs.set_maxlen(opts.maxcol());
+    attrs.set_quiet(opts.quiet());
+    attrs.set_label_color(color[opts.labelcolor()]);
+    attrs.set_highlight_color(color[opts.hlcolor()]);
+    attrs.set_colors(opts.color());
+}
+
+void
+PrettyIOHandler::stream_results(QueryResults *results,
+                                const std::string& action)
+{
+    /* the output stream may differ from one query to the next (daemon) */
+    if (records)
+    {
+        delete records;
+        records = NULL;
+    }
+
+    records = RecordSink::create(opts.output(), opts.outstream());
+    if (records)
+    {
+        records->begin(action);
+        results->set_sink(records);
+    }
+    else
+        results->set_sink(attrs.quiet() ? this : NULL);
+}
+
+void
+PrettyIOHandler::write(const QuerySpec& line)
+{
+    output.write(line, opts.outstream());
+}
+
 void
 PrettyIOHandler::display(const QueryResults& results)
 {
+    if (records)
+    {
+        records->finish();
+        opts.outstream() << std::flush;
+        return;
+    }
+
     /* devaway */
     if (opts.devaway())
     {
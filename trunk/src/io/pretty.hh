@@ -28,27 +28,43 @@
 #endif
 
 #include "io/handler.hh"
+#include "record_sink.hh"
 
 /**
  * @class PrettyIOHandler
  * @brief Base I/O handler for "pretty" output via the Formatter class.
  */
 
-class PrettyIOHandler : public IOHandler
+class PrettyIOHandler : public IOHandler, public ResultsSink
 {
     public:
         PrettyIOHandler();
-        virtual ~PrettyIOHandler() { }
+        virtual ~PrettyIOHandler();
+
+        virtual void write(const QuerySpec& line);
 
     protected:
-        /// Display output using the Formatter class.
+        /**
+         * Have results written out as they're added, if the current
+         * options allow formatting them a line at a time (see
+         * Formatter::write), or as records if --output isn't text;
+         * anything that's kept is still output by display().
+         * @param results Results of the query about to run.
+         * @param action Action the query is for.
+         */
+        void stream_results(QueryResults *results, const std::string& action);
+        /// Display output using the Formatter class (or end the records).
         void display(const QueryResults& results);
+        /// Re-read the option-dependent format attributes.
+        void update_attrs();
 
     private:
         Formatter& output;
         FormatAttrs& attrs;
         Options& opts;
         herdstat::util::ColorMap& color;
+        /* non-NULL while results are written as records */
+        RecordSink *records;
 };
 
 #endif /* _HAVE_IO_PRETTY_HH */
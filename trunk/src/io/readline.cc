@@ -37,6 +37,7 @@
 #include "exceptions.hh"
 #include "handler_map.hh"
 #include "xmlinit.hh"
+#include "session.hh"
 #include "action/handler.hh"
 #include "io/action/set.hh"
 #include "io/action/print.hh"
@@ -104,6 +105,8 @@ ReadLineIOHandler::operator()(Query * const query)
     static std::string::size_type pos;
     static std::vector<std::string> parts;
 
+    /* caches stay loaded; they just check they're still current */
+    GlobalSession().begin_query();
     GlobalXMLInit();
     in.clear();
     parts.clear();
@@ -200,7 +203,8 @@ ReadLineIOHandler::operator()(Query * const query)
             query->add(h->id());
             h = local_handler("help");
         }
-        
+
+        stream_results(&results, h->id());
         (*h)(*query, &results);
         display(results);
     }
@@ -0,0 +1,284 @@
+/*
+ * herdstat -- src/io/socket.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <herdstat/exceptions.hh>
+#include "io/socket.hh"
+
+/* refuse to allocate anything bigger than this for a single message */
+#define MAX_MESSAGE_SIZE (1U << 30)
+
+static void
+fill_address(const std::string& path, struct sockaddr_un *addr)
+{
+    if (path.size() >= sizeof(addr->sun_path))
+        throw herdstat::Exception("Socket path too long: " + path);
+
+    std::memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    std::strcpy(addr->sun_path, path.c_str());
+}
+
+static void
+write_all(int fd, const char *buf, std::size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, buf, len);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw herdstat::ErrnoException("write");
+        }
+
+        buf += n;
+        len -= n;
+    }
+}
+
+/* returns false on EOF before anything was read */
+static bool
+read_all(int fd, char *buf, std::size_t len)
+{
+    std::size_t have = 0;
+    while (have < len)
+    {
+        ssize_t n = ::read(fd, buf + have, len - have);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw herdstat::ErrnoException("read");
+        }
+        else if (n == 0)
+        {
+            if (have == 0)
+                return false;
+            throw herdstat::Exception("Connection closed mid-message");
+        }
+
+        have += n;
+    }
+
+    return true;
+}
+
+UnixSocket::UnixSocket()
+    : _fd(-1), _listening()
+{
+}
+
+UnixSocket::UnixSocket(int fd)
+    : _fd(fd), _listening()
+{
+}
+
+UnixSocket::~UnixSocket()
+{
+    close();
+}
+
+void
+UnixSocket::connect(const std::string& path)
+{
+    struct sockaddr_un addr;
+    fill_address(path, &addr);
+
+    close();
+    if ((_fd = ::socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        throw herdstat::ErrnoException("socket");
+
+    if (::connect(_fd, reinterpret_cast<struct sockaddr *>(&addr),
+                  sizeof(addr)) != 0)
+    {
+        int saved = errno;
+        close();
+        errno = saved;
+        throw herdstat::ErrnoException(path);
+    }
+}
+
+void
+UnixSocket::listen(const std::string& path)
+{
+    struct sockaddr_un addr;
+    fill_address(path, &addr);
+
+    /* if somebody answers, there's already a daemon on this path; if the
+     * socket refuses, it was left behind and can go.  Anything else there
+     * is left alone. */
+    struct stat st;
+    if (::lstat(path.c_str(), &st) == 0)
+    {
+        if (not S_ISSOCK(st.st_mode))
+            throw herdstat::Exception(path + " exists and is not a socket");
+
+        int fd;
+        if ((fd = ::socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+            throw herdstat::ErrnoException("socket");
+
+        const int rv = ::connect(fd, reinterpret_cast<struct sockaddr *>(&addr),
+                                 sizeof(addr));
+        const int saved = errno;
+        ::close(fd);
+
+        if (rv == 0)
+            throw herdstat::Exception("A daemon is already listening on " + path);
+        else if (saved != ECONNREFUSED)
+        {
+            errno = saved;
+            throw herdstat::ErrnoException(path);
+        }
+
+        ::unlink(path.c_str());
+    }
+
+    close();
+    if ((_fd = ::socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        throw herdstat::ErrnoException("socket");
+
+    if (::bind(_fd, reinterpret_cast<struct sockaddr *>(&addr),
+               sizeof(addr)) != 0)
+        throw herdstat::ErrnoException(path);
+
+    _listening = path;
+
+    if (::listen(_fd, SOMAXCONN) != 0)
+        throw herdstat::ErrnoException("listen");
+}
+
+int
+UnixSocket::accept()
+{
+    while (true)
+    {
+        int fd = ::accept(_fd, NULL, NULL);
+        if (fd >= 0)
+            return fd;
+        else if (errno == EINTR)
+            return -1;
+        else if (errno != ECONNABORTED)
+            throw herdstat::ErrnoException("accept");
+    }
+}
+
+void
+UnixSocket::close()
+{
+    if (_fd < 0)
+        return;
+
+    ::close(_fd);
+    _fd = -1;
+
+    if (not _listening.empty())
+    {
+        ::unlink(_listening.c_str());
+        _listening.clear();
+    }
+}
+
+void
+UnixSocket::send(const std::string& msg)
+{
+    const std::size_t len = msg.size();
+    const unsigned char hdr[4] =
+    {
+        static_cast<unsigned char>((len >> 24) & 0xff),
+        static_cast<unsigned char>((len >> 16) & 0xff),
+        static_cast<unsigned char>((len >> 8) & 0xff),
+        static_cast<unsigned char>(len & 0xff)
+    };
+
+    write_all(_fd, reinterpret_cast<const char *>(hdr), sizeof(hdr));
+    write_all(_fd, msg.data(), len);
+}
+
+void
+UnixSocket::send(const std::vector<std::string>& v)
+{
+    std::string msg;
+    std::vector<std::string>::const_iterator i;
+    for (i = v.begin() ; i != v.end() ; ++i)
+    {
+        if (i != v.begin())
+            msg += '\0';
+        msg += *i;
+    }
+
+    send(msg);
+}
+
+bool
+UnixSocket::recv(std::string *msg)
+{
+    unsigned char hdr[4];
+    if (not read_all(_fd, reinterpret_cast<char *>(hdr), sizeof(hdr)))
+        return false;
+
+    const std::size_t len = (static_cast<std::size_t>(hdr[0]) << 24) |
+                            (static_cast<std::size_t>(hdr[1]) << 16) |
+                            (static_cast<std::size_t>(hdr[2]) << 8) |
+                             static_cast<std::size_t>(hdr[3]);
+    if (len > MAX_MESSAGE_SIZE)
+        throw herdstat::Exception("Message too large");
+
+    msg->assign(len, '\0');
+    if (len > 0 and not read_all(_fd, &(*msg)[0], len))
+        throw herdstat::Exception("Connection closed mid-message");
+
+    return true;
+}
+
+bool
+UnixSocket::recv(std::vector<std::string> *v)
+{
+    std::string msg;
+    if (not recv(&msg))
+        return false;
+
+    v->clear();
+    std::string::size_type pos = 0, nul;
+    while ((nul = msg.find('\0', pos)) != std::string::npos)
+    {
+        v->push_back(msg.substr(pos, nul - pos));
+        pos = nul + 1;
+    }
+    v->push_back(msg.substr(pos));
+
+    return true;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,96 @@
+/*
+ * herdstat -- src/io/socket.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+
+#ifndef _HAVE_IO_SOCKET_HH
+#define _HAVE_IO_SOCKET_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <herdstat/noncopyable.hh>
+
+/**
+ * @class UnixSocket
+ * @brief Stream socket in the local (AF_UNIX) domain, used by the daemon and
+ * client front-ends.
+ *
+ * Messages are framed as a 4-byte big-endian length followed by that many
+ * bytes.  A list of strings is sent as a single message with the strings
+ * separated by NUL characters.
+ */
+
+class UnixSocket : private herdstat::Noncopyable
+{
+    public:
+        /// Create an unconnected socket.
+        UnixSocket();
+        /// Take ownership of an already connected descriptor.
+        explicit UnixSocket(int fd);
+        /// Destructor.  Closes the descriptor (and removes the path if we
+        /// were listening on it).
+        ~UnixSocket();
+
+        /// Connect to the socket at the given path.
+        void connect(const std::string& path);
+
+        /** Bind to and listen on the given path.  A stale socket left
+         * behind by a dead daemon is removed first.
+         * @exception herdstat::Exception if another daemon is listening, or
+         * the path is something other than a socket.
+         */
+        void listen(const std::string& path);
+
+        /** Accept a connection.
+         * @returns the new descriptor, or -1 if interrupted by a signal.
+         */
+        int accept();
+
+        /// Close the descriptor.
+        void close();
+
+        /// Get the underlying descriptor (for poll()).
+        int fd() const { return _fd; }
+
+        /// Send a single message.
+        void send(const std::string& msg);
+        /// Send a list of strings as a single message.
+        void send(const std::vector<std::string>& v);
+
+        /** Receive a single message.
+         * @returns false if the peer closed the connection.
+         */
+        bool recv(std::string *msg);
+        /// Receive a list of strings sent by send(const vector&).
+        bool recv(std::vector<std::string> *v);
+
+    private:
+        int _fd;
+        std::string _listening;
+};
+
+#endif /* _HAVE_IO_SOCKET_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -43,6 +43,7 @@ StreamIOHandler::operator()(Query * const query)
         if (not h)
             throw ActionUnimplemented(query->action());
 
+        stream_results(&results, query->action());
         init_xml_if_necessary(query->action());
 
         if (query->empty() and h->allow_pwd_query())
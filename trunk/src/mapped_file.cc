@@ -0,0 +1,95 @@
+/*
+ * herdstat -- src/mapped_file.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <herdstat/exceptions.hh>
+#include "mapped_file.hh"
+#include "profiler.hh"
+
+MappedFile::MappedFile()
+    : _path(), _data(NULL), _size(0)
+{
+}
+
+MappedFile::MappedFile(const std::string& path)
+    : _path(), _data(NULL), _size(0)
+{
+    if (not this->open(path))
+        throw herdstat::FileException(path);
+}
+
+MappedFile::~MappedFile()
+{
+    this->close();
+}
+
+bool
+MappedFile::open(const std::string& path)
+{
+    this->close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat s;
+    profile_count(Profiler::STATS);
+    if (fstat(fd, &s) != 0 or s.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void *p = mmap(NULL, s.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    /* the mapping stays valid after the descriptor is closed */
+    ::close(fd);
+
+    if (p == MAP_FAILED)
+        return false;
+
+    _path.assign(path);
+    _data = static_cast<const char *>(p);
+    _size = s.st_size;
+    return true;
+}
+
+void
+MappedFile::close()
+{
+    if (_data)
+        munmap(const_cast<char *>(_data), _size);
+
+    _data = NULL;
+    _size = 0;
+    _path.clear();
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
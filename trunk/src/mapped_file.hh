@@ -0,0 +1,68 @@
+/*
+ * herdstat -- src/mapped_file.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_MAPPED_FILE_HH
+#define _HAVE_SRC_MAPPED_FILE_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <herdstat/noncopyable.hh>
+
+/**
+ * @class MappedFile
+ * @brief A file mapped read-only into memory.  The mapping is private to
+ * this object and released when it's closed or destroyed.
+ */
+
+class MappedFile : private herdstat::Noncopyable
+{
+    public:
+        MappedFile();
+        /// Map the given file; throws FileException on failure.
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        /**
+         * Map the given file.
+         * @param path Path to file.
+         * @returns True if the file was mapped.
+         */
+        bool open(const std::string& path);
+        void close();
+
+        bool is_open() const { return (_data != NULL); }
+        const char *data() const { return _data; }
+        std::size_t size() const { return _size; }
+        const std::string& path() const { return _path; }
+
+    private:
+        std::string _path;
+        const char *_data;
+        std::size_t _size;
+};
+
+#endif /* _HAVE_SRC_MAPPED_FILE_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,162 @@
+/*
+ * herdstat -- src/md5.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cstring>
+#include <stdint.h>
+
+#include "md5.hh"
+
+namespace {
+
+    /* per-round shift amounts */
+    const unsigned shifts[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+
+    /* floor(abs(sin(i + 1)) * 2^32) */
+    const uint32_t sines[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+        0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+        0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+        0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+        0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+        0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+        0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+        0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+        0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+    };
+
+    inline uint32_t
+    rotate_left(uint32_t x, unsigned n)
+    {
+        return ((x << n) | (x >> (32 - n)));
+    }
+
+    /* process one 64 byte block */
+    void
+    transform(uint32_t state[4], const unsigned char *block)
+    {
+        uint32_t m[16];
+        for (unsigned i = 0 ; i != 16 ; ++i)
+            m[i] = (static_cast<uint32_t>(block[i * 4])) |
+                   (static_cast<uint32_t>(block[i * 4 + 1]) << 8) |
+                   (static_cast<uint32_t>(block[i * 4 + 2]) << 16) |
+                   (static_cast<uint32_t>(block[i * 4 + 3]) << 24);
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+        for (unsigned i = 0 ; i != 64 ; ++i)
+        {
+            uint32_t f;
+            unsigned g;
+
+            if (i < 16)
+            {
+                f = (b & c) | (~b & d);
+                g = i;
+            }
+            else if (i < 32)
+            {
+                f = (d & b) | (~d & c);
+                g = ((5 * i) + 1) % 16;
+            }
+            else if (i < 48)
+            {
+                f = b ^ c ^ d;
+                g = ((3 * i) + 5) % 16;
+            }
+            else
+            {
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+            }
+
+            const uint32_t tmp = d;
+            d = c;
+            c = b;
+            b = b + rotate_left(a + f + sines[i] + m[g], shifts[i]);
+            a = tmp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+
+} // namespace
+
+std::string
+md5_hex(const char *data, std::size_t size)
+{
+    uint32_t state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    std::size_t left = size;
+    for ( ; left >= 64 ; p += 64, left -= 64)
+        transform(state, p);
+
+    /* pad with 0x80, zeros and the length in bits (little endian) */
+    unsigned char tail[128];
+    std::memset(tail, 0, sizeof(tail));
+    if (left)
+        std::memcpy(tail, p, left);
+    tail[left] = 0x80;
+
+    const std::size_t tail_size = (left < 56 ? 64 : 128);
+    const uint64_t bits = static_cast<uint64_t>(size) * 8;
+    for (unsigned i = 0 ; i != 8 ; ++i)
+        tail[tail_size - 8 + i] = static_cast<unsigned char>(bits >> (i * 8));
+
+    transform(state, tail);
+    if (tail_size == 128)
+        transform(state, tail + 64);
+
+    static const char hex[] = "0123456789abcdef";
+    std::string digest;
+    digest.reserve(32);
+    for (unsigned i = 0 ; i != 16 ; ++i)
+    {
+        const unsigned char byte =
+            static_cast<unsigned char>(state[i / 4] >> ((i % 4) * 8));
+        digest += hex[byte >> 4];
+        digest += hex[byte & 0x0f];
+    }
+
+    return digest;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,43 @@
+/*
+ * herdstat -- src/md5.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_MD5_HH
+#define _HAVE_SRC_MD5_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+
+/**
+ * Compute the MD5 sum (RFC 1321) of a block of data.  Only used to check
+ * entries of the tree's metadata/md5-cache against their ebuild.
+ * @param data Data to hash.
+ * @param size Size of data.
+ * @returns MD5 sum as a lower case hex string.
+ */
+std::string md5_hex(const char *data, std::size_t size);
+
+#endif /* _HAVE_SRC_MD5_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
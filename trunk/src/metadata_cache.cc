@@ -28,133 +28,577 @@
 #include <algorithm>
 #include <functional>
 #include <cstdlib>
+#include <cstring>
 
 #include <herdstat/xml/exceptions.hh>
 #include <herdstat/util/string.hh>
 #include <herdstat/util/vars.hh>
 #include <herdstat/util/progress/percent.hh>
-#include <herdstat/util/functional.hh>
-#include <herdstat/io/binary_stream_iterator.hh>
 #include <herdstat/portage/config.hh>
 #include <herdstat/portage/metadata_xml.hh>
+#include <herdstat/xml/init.hh>
 
 #include "common.hh"
+#include "threads.hh"
 #include "package_cache.hh"
+#include "profiler.hh"
+#include "session.hh"
 #include "metadata_cache.hh"
 
 #define METACACHE               /*LOCALSTATEDIR*/"/metacache"
-#define METACACHE_EXPIRE        259200 /* 3 days */
 #define METACACHE_DELIM         "%%%"
 
 using namespace herdstat;
 using namespace herdstat::portage;
 using namespace herdstat::xml;
 
-MetadataCache::MetadataCache()
-    : Cache(GlobalOptions().localstatedir()+METACACHE),
-      _spinner(NULL),
-      _portdir(_options.portdir()),
-      _overlays(_options.overlays())
+MetadataShard::MetadataShard(const PackageShard& pkgs)
+    : Cache(shard_path(GlobalOptions().localstatedir()+METACACHE,
+                       pkgs.repo()), pkgs.repo()),
+      _pkgs(pkgs), _spinner(NULL),
+      _metadatas(), _stamps(), _decoded(), _records(NULL),
+      _paths(), _have_paths(false), _stale(), _stale_index()
 {
 }
 
-MetadataCache::~MetadataCache() throw()
+MetadataShard::~MetadataShard() throw()
+{
+}
+
+bool
+MetadataShard::update(bool fill)
+{
+    if (this->is_loaded() and this->is_current())
+        return true;
+
+    if (this->is_valid())
+        this->load();
+    else if (fill)
+    {
+        this->fill();
+        this->dump();
+    }
+    else
+    {
+        /* whatever we had no longer matches the tree */
+        if (this->is_loaded())
+            this->unload();
+        return false;
+    }
+
+    return true;
+}
+
+void
+MetadataShard::do_unload()
 {
+    _records = NULL;
+    _metadatas.clear();
+    _stamps.clear();
+    _decoded.clear();
+    _paths.clear();
+    _have_paths = false;
+
+    for (int i = HERDS ; i <= DEVS ; ++i)
+    {
+        _indexes[i].clear();
+        _unmaintained[i].clear();
+    }
 }
 
 std::size_t
-MetadataCache::cache_size() const
+MetadataShard::cache_size() const
 {
     return _metadatas.size();
 }
 
+/*
+ * Each record is:
+ *   cat/pkg, herd1,herd2, dev1,dev2, longdesc, path, mtime, size
+ *
+ * followed by the index tables:
+ *   1: herd, ids
+ *   2: developer, ids
+ *   3: ids of entries with no herds, ids of entries with no developers
+ *
+ * where ids is an array of uint32_t's in ascending order.  The keys of
+ * tables 1 and 2 are sorted.
+ */
+
+#define HERD_INDEX_TABLE        1
+#define DEV_INDEX_TABLE         2
+#define UNMAINTAINED_TABLE      3
+#define NTABLES                 4
+
+std::size_t
+MetadataShard::record_fields() const
+{
+    return 7;
+}
+
 const char * const
-MetadataCache::name() const
+MetadataShard::name() const
 {
     return "metadata";
 }
 
+unsigned
+MetadataShard::format() const
+{
+    return 4;
+}
+
+/*
+ * Decode a record into a Metadata object and its Stamp.
+ */
+
+static void
+decode_record(const CacheFileReader& file, std::size_t n,
+              Metadata *meta, MetadataShard::Stamp *stamp)
+{
+    *meta = Metadata(file.field(n, 0).str());
+    portage::Herds& herds(meta->herds());
+    portage::Developers& devs(meta->devs());
+
+    /* assign herds */
+    util::split(file.field(n, 1).str(), std::inserter(herds, herds.end()), ",");
+    /* assign developers */
+    util::split(file.field(n, 2).str(), std::inserter(devs, devs.end()), ",");
+
+    /* assign longdesc */
+    meta->set_longdesc(file.field(n, 3).str());
+
+    /* where it came from */
+    stamp->path.assign(file.field(n, 4).str());
+    stamp->mtime = util::destringify<long>(file.field(n, 5).str());
+    stamp->size = util::destringify<unsigned long>(file.field(n, 6).str());
+}
+
+static void
+encode_record(const Metadata& meta, const MetadataShard::Stamp& stamp,
+              std::vector<std::string> *record)
+{
+    (*record)[0].assign(meta.pkg());
+    (*record)[1].assign(util::join(meta.herds().begin(),
+                                   meta.herds().end(), ","));
+    (*record)[2].assign(util::join(meta.devs().begin(),
+                                   meta.devs().end(), ","));
+    (*record)[3].assign(util::tidy_whitespace(meta.longdesc()));
+    (*record)[4].assign(stamp.path);
+    (*record)[5].assign(util::stringify(static_cast<long>(stamp.mtime)));
+    (*record)[6].assign(util::stringify(stamp.size));
+}
+
+void
+MetadataShard::decode(size_type n) const
+{
+    assert(_records);
+    decode_record(*_records, n, &_metadatas[n], &_stamps[n]);
+    _decoded[n] = true;
+}
+
+void
+MetadataShard::decode_all() const
+{
+    if (not _have_paths)
+        this->build_paths();
+
+    if (not _records)
+        return;
+
+    for (size_type n = 0 ; n != this->size() ; ++n)
+    {
+        if (not _decoded[n])
+            this->decode(n);
+    }
+}
+
+void
+MetadataShard::build_paths() const
+{
+    _paths.clear();
+
+    for (size_type n = 0 ; n != this->size() ; ++n)
+    {
+        /* don't decode the whole record just for its path */
+        if (_records and not _decoded[n])
+            _paths.insert(std::make_pair(_records->field(n, 4).str(), n));
+        else
+            _paths.insert(std::make_pair(_stamps[n].path, n));
+    }
+
+    _have_paths = true;
+}
+
+MetadataShard::size_type
+MetadataShard::find_path(const std::string& path) const
+{
+    if (not _have_paths)
+        this->build_paths();
+
+    paths_type::const_iterator i = _paths.find(path);
+    return (i == _paths.end() ? this->size() : i->second);
+}
+
+/*
+ * Inverted indexes.
+ */
+
+void
+MetadataShard::build_indexes()
+{
+    TraceContext c("MetadataShard::build_indexes()");
+
+    _indexes[HERDS].clear();
+    _indexes[DEVS].clear();
+    _unmaintained[HERDS].clear();
+    _unmaintained[DEVS].clear();
+
+    for (size_type n = 0 ; n != this->size() ; ++n)
+    {
+        const value_type& meta((*this)[n]);
+
+        const portage::Herds& herds(meta.herds());
+        if (herds.empty())
+            _unmaintained[HERDS].push_back(n);
+        for (portage::Herds::const_iterator h = herds.begin() ;
+                h != herds.end() ; ++h)
+            _indexes[HERDS][h->name()].push_back(n);
+
+        const portage::Developers& devs(meta.devs());
+        if (devs.empty())
+            _unmaintained[DEVS].push_back(n);
+        for (portage::Developers::const_iterator d = devs.begin() ;
+                d != devs.end() ; ++d)
+            _indexes[DEVS][d->user()].push_back(n);
+    }
+}
+
+void
+MetadataShard::find(Index index, const std::string& key, ids_type *ids) const
+{
+    /* developers are keyed on user name */
+    std::string k(key);
+    if (index == DEVS)
+    {
+        std::string::size_type pos = k.find('@');
+        if (pos != std::string::npos)
+            k.erase(pos);
+    }
+
+    ids->clear();
+
+    if (not _records)
+    {
+        index_type::const_iterator i = _indexes[index].find(k);
+        if (i != _indexes[index].end())
+            *ids = i->second;
+        return;
+    }
+
+    /* binary search the sorted keys */
+    const CacheTable& table(_records->table(index == HERDS ?
+                            HERD_INDEX_TABLE : DEV_INDEX_TABLE));
+    std::size_t lo = 0, hi = table.size();
+    while (lo < hi)
+    {
+        const std::size_t mid = lo + ((hi - lo) / 2);
+        const int r = table.field(mid, 0).compare(k);
+        if (r == 0)
+        {
+            decode_ids(table.field(mid, 1), ids);
+            return;
+        }
+        else if (r < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+}
+
+void
+MetadataShard::find(Index index, const util::Regex& regex, ids_type *ids) const
+{
+    ids->clear();
+
+    if (not _records)
+    {
+        index_type::const_iterator i;
+        for (i = _indexes[index].begin() ; i != _indexes[index].end() ; ++i)
+            if (regex == i->first)
+                merge_ids(i->second, ids);
+        return;
+    }
+
+    const CacheTable& table(_records->table(index == HERDS ?
+                            HERD_INDEX_TABLE : DEV_INDEX_TABLE));
+    ids_type tmp;
+    for (std::size_t n = 0 ; n != table.size() ; ++n)
+    {
+        if (regex == table.field(n, 0).str())
+        {
+            decode_ids(table.field(n, 1), &tmp);
+            merge_ids(tmp, ids);
+        }
+    }
+}
+
+void
+MetadataShard::keys(Index index, std::vector<std::string> *keys) const
+{
+    keys->clear();
+
+    if (not _records)
+    {
+        index_type::const_iterator i;
+        for (i = _indexes[index].begin() ; i != _indexes[index].end() ; ++i)
+            keys->push_back(i->first);
+        return;
+    }
+
+    const CacheTable& table(_records->table(index == HERDS ?
+                            HERD_INDEX_TABLE : DEV_INDEX_TABLE));
+    keys->reserve(table.size());
+    for (std::size_t n = 0 ; n != table.size() ; ++n)
+        keys->push_back(table.field(n, 0).str());
+}
+
+void
+MetadataShard::find_unmaintained(Index index, ids_type *ids) const
+{
+    if (_records)
+        decode_ids(_records->table(UNMAINTAINED_TABLE).field(0, index), ids);
+    else
+        *ids = _unmaintained[index];
+}
+
 /*
  * Is the cache valid?
  */
 
 bool
-MetadataCache::do_is_valid()
+MetadataShard::do_is_valid()
 {
-    BacktraceContext c("MetadataCache::do_is_valid()");
-
-    const util::Stat mcache(this->path());
-    bool valid = false;
+    TraceContext c("MetadataShard::do_is_valid()");
+    return this->is_fresh();
+}
 
-    const std::string expire(_options.metacache_expire());
-    const std::string lastsync(_options.localstatedir()+LASTSYNC);
+/*
+ * Stat pkg's metadata.xml and either reuse the entry from the expired cache
+ * (if the file hasn't changed since) or parse it.  Returns false if the
+ * package doesn't have a metadata.xml.  Only reads from the expired cache,
+ * so it's safe to call from multiple threads.
+ */
 
-    if (mcache.exists())
+bool
+MetadataShard::refresh(const std::string& path,
+                       const Package& pkg,
+                       value_type *meta,
+                       Stamp *stamp,
+                       bool *reused) const
+{
+    profile_count(Profiler::STATS);
+    const util::Stat st(path);
+    if (not st.exists())
+        return false;
+
+    stamp->path.assign(path);
+    stamp->mtime = st.mtime();
+    stamp->size = st.size();
+
+    stale_type::const_iterator i = _stale_index.find(path);
+    *reused = ((i != _stale_index.end()) and
+        (_stale.field(i->second, 5) ==
+            util::stringify(static_cast<long>(stamp->mtime))) and
+        (_stale.field(i->second, 6) == util::stringify(stamp->size)));
+
+    if (*reused)
     {
-        if (expire == "lastsync")
+        Stamp unused;
+        decode_record(_stale, i->second, meta, &unused);
+    }
+    else
+    {
+        const MetadataXML mxml(path, pkg);
+        *meta = mxml.data();
+    }
+
+    return true;
+}
+
+/*
+ * Worker for a multi-threaded fill.  Each worker repeatedly grabs the next
+ * chunk of packages off the shared list, parses their metadata.xml's and
+ * stores the result in the slot that corresponds to the package's position
+ * in the package cache, so merging them back is simply a walk over the slots
+ * (which keeps the original tree order).
+ */
+
+class MetadataFillWorker : public Thread
+{
+    public:
+        struct Shared
         {
-            const std::string path(this->_portdir + "/metadata/timestamp");
-            bool has_timestamp = util::is_file(path);
-            bool has_lastsync  = util::is_file(lastsync);
+            /* p.begin() decodes a mapped shard, which isn't thread-safe;
+             * so that happens here, before any worker starts */
+            Shared(const MetadataShard& c, const PackageShard& p)
+                : cache(c), pkgs(p.begin()), slots(p.size()),
+                  stamps(p.size()), have(p.size(), false), next(0), done(0),
+                  reused(0), failed(false) { }
+
+            const MetadataShard& cache;
+            const PackageShard::const_iterator pkgs;
+            std::vector<Metadata> slots;
+            std::vector<MetadataShard::Stamp> stamps;
+            std::vector<char> have;
+            std::size_t next;
+            std::size_t done;
+            std::size_t reused;
+
+            /* first error encountered by any worker */
+            bool failed;
+            std::string error_file;
+            std::string error_msg;
+
+            Mutex mutex;
+            Condition progress;
+        };
+
+        MetadataFillWorker(Shared& shared) : _shared(shared) { }
+        virtual ~MetadataFillWorker() { }
+
+    protected:
+        virtual void run();
+
+    private:
+        /* number of packages grabbed at a time */
+        static const std::size_t chunk_size = 32;
+
+        bool next_chunk(std::size_t *begin, std::size_t *end);
+        void chunk_done(std::size_t n, std::size_t reused);
+        void fail(const std::string& file, const std::string& msg);
+
+        Shared& _shared;
+};
 
-            if (has_timestamp and has_lastsync)
-            {
-                util::File t(path), l(lastsync);
+bool
+MetadataFillWorker::next_chunk(std::size_t *begin, std::size_t *end)
+{
+    MutexLock lock(_shared.mutex);
 
-                if (_options.debug())
-                {
-                    debug_msg("Checking timestamps...");
-                    t.dump(std::cout);
-                    l.dump(std::cout);
-                }
+    if (_shared.failed or (_shared.next >= _shared.slots.size()))
+        return false;
+
+    *begin = _shared.next;
+    *end = std::min(_shared.next + chunk_size, _shared.slots.size());
+    _shared.next = *end;
+    return true;
+}
+
+void
+MetadataFillWorker::chunk_done(std::size_t n, std::size_t reused)
+{
+    MutexLock lock(_shared.mutex);
+    _shared.done += n;
+    _shared.reused += reused;
+    _shared.progress.signal();
+}
+
+void
+MetadataFillWorker::fail(const std::string& file, const std::string& msg)
+{
+    MutexLock lock(_shared.mutex);
+
+    if (not _shared.failed)
+    {
+        _shared.failed = true;
+        _shared.error_file.assign(file);
+        _shared.error_msg.assign(msg);
+    }
+
+    _shared.progress.signal();
+}
+
+void
+MetadataFillWorker::run()
+{
+    std::size_t begin, end;
+    while (next_chunk(&begin, &end))
+    {
+        std::string path;
+        std::size_t reused = 0;
+
+        try
+        {
+            for (std::size_t n = begin ; n != end ; ++n)
+            {
+                const Package& pkg(*(_shared.pkgs + n));
+                path.assign(pkg.path()+"/metadata.xml");
 
-                valid = (t == l);
-                
-                if (not valid)
+                bool r;
+                if (_shared.cache.refresh(path, pkg, &_shared.slots[n],
+                                          &_shared.stamps[n], &r))
                 {
-                    debug_msg("timestamps don't match ; replacing lastsync");
-                    t.close(); l.close();
-                    util::copy_file(path, lastsync);
+                    _shared.have[n] = true;
+                    if (r)
+                        ++reused;
                 }
             }
-            else if (has_lastsync)
-            {
-                unlink(LASTSYNC);
-                valid = ((std::time(NULL) - mcache.mtime())
-                        < METACACHE_EXPIRE);
-            }
-            else if (has_timestamp)
-                util::copy_file(path, lastsync);
-            else
-                valid = ((std::time(NULL) - mcache.mtime())
-                        < METACACHE_EXPIRE);
         }
-        else
-            valid = ((std::time(NULL) - mcache.mtime()) <
-                    std::strtol(expire.c_str(), NULL, 10));
+        catch (const ParserException& e)
+        {
+            fail(e.file(), e.error());
+            return;
+        }
+        catch (const BaseException& e)
+        {
+            fail(path, e.what());
+            return;
+        }
 
-        /* only valid if size > 0 */
-        if (valid)
-            valid = (mcache.size() > 0);
+        chunk_done(end - begin, reused);
     }
+}
+
+/*
+ * Map the expired cache (if there is one) so do_fill() only has to parse
+ * the metadata.xml's that have changed since.
+ */
+
+void
+MetadataShard::load_stale()
+{
+    TraceContext c("MetadataShard::load_stale()");
+
+    _stale_index.clear();
+
+    if (not this->open_stale(_stale))
+        return;
 
-    return valid;
+    for (std::size_t n = 0 ; n != _stale.size() ; ++n)
+        _stale_index.insert(std::make_pair(_stale.field(n, 4).str(), n));
+
+    debug_msg("loaded %d entries from expired cache", _stale_index.size());
 }
 
 /*
- * Find and parse every metadata.xml in the tree,
- * filling our container with data.
+ * Find and parse every metadata.xml in the tree, filling our container with
+ * data.  Entries from the expired cache whose metadata.xml hasn't changed
+ * (same mtime and size) are reused instead of being parsed again.
  */
 
 void
-MetadataCache::do_fill()
+MetadataShard::do_fill()
 {
-    BacktraceContext c("MetadataCache::do_fill()");
+    TraceContext c("MetadataShard::do_fill()");
 
     const bool status = (not _options.quiet() and not _options.debug());
         
-    const PackageCache& pkgcache(GlobalPkgCache(_spinner));
-    debug_msg("pkgcache.size() == %d", pkgcache.size());
+    const PackageShard& pkgcache(_pkgs);
+    debug_msg("%s: pkgcache.size() == %d", pkgcache.repo().c_str(),
+        pkgcache.size());
+
+    this->load_stale();
 
     if (_spinner)
         _spinner->stop();
@@ -164,116 +608,348 @@ MetadataCache::do_fill()
         percentage.start(pkgcache.size(), "Generating metadata.xml cache:");
 
     /* we will contain at most pkgcache.size() elements */
+    this->do_unload();
     _metadatas.reserve(pkgcache.size());
+    _stamps.reserve(pkgcache.size());
+
+    std::size_t reused = 0;
+
+    unsigned nthreads = _options.metacache_threads();
+    if (nthreads == 0)
+        nthreads = available_cpus();
+    /* not worth the overhead for tiny trees */
+    if (pkgcache.size() < (nthreads * 64))
+        nthreads = 1;
+
+    debug_msg("filling metadata cache using %d thread(s)", nthreads);
+
+    if (nthreads == 1)
+    {
+        Metadata meta;
+        Stamp stamp;
+
+        /* for each pkg */
+        PackageCache::const_iterator i, end;
+        for (i = pkgcache.begin(), end = pkgcache.end() ; i != end ; ++i)
+        {
+            if (status)
+                ++percentage;
 
-    /* for each pkg */
-    PackageCache::const_iterator i, end;
-    for (i = pkgcache.begin(), end = pkgcache.end() ; i != end ; ++i)
+            bool r;
+            if (this->refresh(i->path()+"/metadata.xml", *i,
+                              &meta, &stamp, &r))
+            {
+                _metadatas.push_back(meta);
+                _stamps.push_back(stamp);
+                if (r)
+                    ++reused;
+            }
+        }
+    }
+    else
     {
-        if (status)
-            ++percentage;
+        /* libxml2 must be initialized from the main thread before any
+         * worker starts parsing */
+        xml::GlobalInit(_options.qa());
+
+        MetadataFillWorker::Shared shared(*this, pkgcache);
+        /* joined before shared goes away, however we leave */
+        ThreadGroup<MetadataFillWorker> workers;
+        for (unsigned n = 0 ; n != nthreads ; ++n)
+            workers.add(new MetadataFillWorker(shared));
+
+        start_threads(workers.begin(), workers.end());
 
-        const std::string path(i->path()+"/metadata.xml");
-        if (util::file_exists(path))
+        /* the progress meter isn't thread-safe, so only we touch it */
         {
-            /* parse it */
-            const MetadataXML meta(path, *i);
-            _metadatas.push_back(meta.data());
+            MutexLock lock(shared.mutex);
+            std::size_t shown = 0;
+            while (not shared.failed and (shown < shared.slots.size()))
+            {
+                while (not shared.failed and (shown == shared.done))
+                    shared.progress.wait(shared.mutex);
+
+                for ( ; shown < shared.done ; ++shown)
+                    if (status)
+                        ++percentage;
+            }
+        }
+
+        join_threads(workers.begin(), workers.end());
+
+        if (shared.failed)
+            throw ParserException(shared.error_file, shared.error_msg);
+
+        /* merge back in tree order */
+        for (std::size_t n = 0 ; n != shared.slots.size() ; ++n)
+        {
+            if (shared.have[n])
+            {
+                _metadatas.push_back(shared.slots[n]);
+                _stamps.push_back(shared.stamps[n]);
+            }
         }
+
+        reused = shared.reused;
     }
 
+    debug_msg("reused %d of %d entries from the expired cache",
+        reused, _metadatas.size());
+
+    /* no longer needed */
+    stale_type().swap(_stale_index);
+    _stale.close();
+
+    this->build_indexes();
+
     /* trim unused space */
     if (_metadatas.capacity() > (_metadatas.size() + 10))
-        std::vector<Metadata>(_metadatas).swap(_metadatas);
+    {
+        container_type(_metadatas).swap(_metadatas);
+        std::vector<Stamp>(_stamps).swap(_stamps);
+    }
+}
+
+/*
+ * Load cache from disk.  Records are only decoded when they're accessed.
+ */
+
+void
+MetadataShard::do_load(const CacheFileReader& file)
+{
+    TraceContext c("MetadataShard::do_load()");
+
+    if (file.tables() != NTABLES)
+        throw ParserException(this->path(), "Invalid format.");
+
+    _records = &file;
+    _metadatas.clear();
+    _stamps.clear();
+    _metadatas.resize(file.size());
+    _stamps.resize(file.size());
+    _decoded.assign(file.size(), false);
+    _have_paths = false;
+}
+
+/*
+ * Dump cache to disk.
+ */
+
+void
+MetadataShard::do_dump(CacheFileWriter& file)
+{
+    TraceContext c("MetadataShard::do_dump()");
+
+    std::vector<std::string> record(this->record_fields());
+
+    for (size_type n = 0 ; n != this->size() ; ++n)
+    {
+        const value_type& meta((*this)[n]);
+        encode_record(meta, _stamps[n], &record);
+        file.add(record);
+    }
+
+    if (_records)
+        this->build_indexes();
+
+    /* indexes; std::map keeps the keys sorted for us */
+    record.resize(2);
+    const std::size_t tables[] = { file.add_table(2), file.add_table(2) };
+    for (int index = HERDS ; index <= DEVS ; ++index)
+    {
+        index_type::const_iterator i;
+        for (i = _indexes[index].begin() ; i != _indexes[index].end() ; ++i)
+        {
+            record[0].assign(i->first);
+            record[1].assign(encode_ids(i->second));
+            file.add(tables[index], record);
+        }
+    }
+
+    record[0].assign(encode_ids(_unmaintained[HERDS]));
+    record[1].assign(encode_ids(_unmaintained[DEVS]));
+    file.add(file.add_table(2), record);
+}
+
+void
+MetadataShard::dump_text(std::ostream& stream)
+{
+    TraceContext c("MetadataShard::dump_text()");
+
+    std::vector<std::string> record(this->record_fields());
+
+    for (size_type n = 0 ; n != this->size() ; ++n)
+    {
+        const value_type& meta((*this)[n]);
+        encode_record(meta, _stamps[n], &record);
+        stream << util::join(record.begin(), record.end(), METACACHE_DELIM)
+               << std::endl;
+    }
 }
 
 /*
- * Load cache from disk.
+ * The whole (sharded) cache.
  */
 
-struct CacheEntryToMetadata
-    : std::binary_function<std::string, util::ProgressMeter *, portage::Metadata>
+MetadataCache::MetadataCache()
+    : _lock(), _shards(), _offsets(), _size(0), _checked(0),
+      _complete(false)
+{
+}
+
+MetadataCache::~MetadataCache()
 {
-    portage::Metadata
-    operator()(const std::string& entry, util::ProgressMeter *progress) const
+    shards_type::iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        delete *s;
+}
+
+void
+MetadataCache::update(util::ProgressMeter *spinner, bool fill)
+{
+    MutexLock l(_lock);
+
+    shards_type::iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        (*s)->set_spinner(spinner);
+
+    /* an update that didn't fill has to be finished by one that does */
+    if (GlobalSession().checked(&_checked) and (_complete or not fill))
+        return;
+
+    TraceContext c("MetadataCache::update()");
+
+    /* the package cache's shards live as long as we do */
+    const PackageCache::shards_type& pkgs(GlobalPkgCache(spinner).shards());
+    if (_shards.empty())
     {
-        if (progress)
-            ++*progress;
+        PackageCache::shards_type::const_iterator p;
+        for (p = pkgs.begin() ; p != pkgs.end() ; ++p)
+        {
+            _shards.push_back(new MetadataShard(**p));
+            _shards.back()->set_spinner(spinner);
+        }
+    }
 
-        std::vector<std::string> parts;
-        util::split(entry, std::back_inserter(parts), METACACHE_DELIM, true);
-        if (parts.size() != 4)
-            throw ParserException(GlobalOptions().localstatedir()+METACACHE,
-                                  "Invalid format: '"+entry+"'.");
+    _offsets.clear();
+    _size = 0;
+    _complete = true;
 
-        portage::Metadata meta(parts[0]);
-        portage::Herds& herds(meta.herds());
-        portage::Developers& devs(meta.devs());
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+    {
+        if (not (*s)->update(fill))
+            _complete = false;
 
-        /* assign herds */
-        util::split(parts[1], std::inserter(herds, herds.end()), ",");
-        /* assign developers */
-        util::split(parts[2], std::inserter(devs, devs.end()), ",");
+        _offsets.push_back(_size);
+        _size += (*s)->size();
+    }
+}
 
-        /* assign longdesc */
-        meta.set_longdesc(parts[3]);
+void
+MetadataCache::decode_all() const
+{
+    shards_type::const_iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        (*s)->decode_all();
+}
 
-        return meta;
+const MetadataCache::value_type *
+MetadataCache::find_current(const std::string& path) const
+{
+    for (std::size_t s = 0 ; s != _shards.size() ; ++s)
+    {
+        const MetadataShard& shard(*_shards[s]);
+        const size_type n = shard.find_path(path);
+        if (n == shard.size())
+            continue;
+
+        profile_count(Profiler::STATS);
+        const util::Stat st(path);
+        const MetadataShard::Stamp& stamp(shard.stamp(n));
+        if (not st.exists() or (st.mtime() != stamp.mtime) or
+            (static_cast<unsigned long>(st.size()) != stamp.size))
+            return NULL;
+
+        return &shard[n];
     }
-};
 
-struct MetadataToCacheEntry
+    return NULL;
+}
+
+/* add each of ids (local to shard n) to result as global ids */
+static void
+append_ids(const MetadataTypes::ids_type& ids, std::size_t offset,
+           MetadataTypes::ids_type *result)
 {
-    std::string
-    operator()(const portage::Metadata& meta) const
+    MetadataTypes::ids_type::const_iterator i;
+    for (i = ids.begin() ; i != ids.end() ; ++i)
+        result->push_back(*i + offset);
+}
+
+void
+MetadataCache::find(Index index, const std::string& key, ids_type *ids) const
+{
+    ids->clear();
+
+    ids_type tmp;
+    for (std::size_t s = 0 ; s != _shards.size() ; ++s)
     {
-        /*
-         * format is the form of:
-         *   cat/pkg:herd1,herd2:dev1,dev2:longdesc
-         */
-
-        return (meta.pkg() + METACACHE_DELIM +
-                util::join(meta.herds().begin(),
-                           meta.herds().end(), ",") + METACACHE_DELIM +
-                util::join(meta.devs().begin(),
-                           meta.devs().end(), ",") + METACACHE_DELIM +
-                util::tidy_whitespace(meta.longdesc()));
+        _shards[s]->find(index, key, &tmp);
+        append_ids(tmp, _offsets[s], ids);
     }
-};
+}
 
 void
-MetadataCache::do_load(io::BinaryIStream& stream)
+MetadataCache::find(Index index, const util::Regex& regex, ids_type *ids) const
 {
-    BacktraceContext c("MetadataCache::load()");
+    ids->clear();
 
-    _metadatas.reserve(this->header_size());
-    std::transform(io::BinaryIStreamIterator<std::string>(stream),
-                   io::BinaryIStreamIterator<std::string>(),
-                   std::back_inserter(_metadatas),
-                   std::bind2nd(CacheEntryToMetadata(), _spinner));
+    ids_type tmp;
+    for (std::size_t s = 0 ; s != _shards.size() ; ++s)
+    {
+        _shards[s]->find(index, regex, &tmp);
+        append_ids(tmp, _offsets[s], ids);
+    }
 }
 
-/*
- * Dump cache to disk.
- */
+void
+MetadataCache::keys(Index index, std::vector<std::string> *keys) const
+{
+    keys->clear();
+
+    std::vector<std::string> tmp;
+    for (std::size_t s = 0 ; s != _shards.size() ; ++s)
+    {
+        _shards[s]->keys(index, &tmp);
+        keys->insert(keys->end(), tmp.begin(), tmp.end());
+    }
+
+    if (_shards.size() > 1)
+    {
+        std::sort(keys->begin(), keys->end());
+        keys->erase(std::unique(keys->begin(), keys->end()), keys->end());
+    }
+}
 
 void
-MetadataCache::do_dump(io::BinaryOStream& stream)
+MetadataCache::find_unmaintained(Index index, ids_type *ids) const
 {
-    BacktraceContext c("MetadataCache::do_dump()");
+    ids->clear();
 
-    std::transform(_metadatas.begin(), _metadatas.end(),
-        io::BinaryOStreamIterator<std::string>(stream),
-        MetadataToCacheEntry());
+    ids_type tmp;
+    for (std::size_t s = 0 ; s != _shards.size() ; ++s)
+    {
+        _shards[s]->find_unmaintained(index, &tmp);
+        append_ids(tmp, _offsets[s], ids);
+    }
 }
 
 void
 MetadataCache::dump_text(std::ostream& stream)
 {
-    BacktraceContext c("MetadataCache::dump_text()");
-    std::transform(_metadatas.begin(), _metadatas.end(),
-        std::ostream_iterator<std::string>(stream, "\n"),
-        MetadataToCacheEntry());
+    shards_type::iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        (*s)->dump_text(stream);
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
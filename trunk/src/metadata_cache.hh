@@ -28,76 +28,302 @@
 #endif
 
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <iterator>
+#include <ctime>
+#include <stdint.h>
+#include <herdstat/noncopyable.hh>
+#include <herdstat/util/regex.hh>
 #include <herdstat/util/progress/meter.hh>
 #include <herdstat/portage/metadata.hh>
+#include <herdstat/portage/package.hh>
 
 #include "cache.hh"
+#include "threads.hh"
+
+class PackageShard;
+
+/*
+ * Types shared by the metadata cache and its shards.
+ */
+
+struct MetadataTypes
+{
+    /// Inverted indexes kept alongside the entries.
+    enum Index { HERDS, DEVS };
+
+    /// Entry ids (for use with operator[]) in ascending order.
+    typedef std::vector<uint32_t> ids_type;
+};
 
 /*
- * A cache of all metadata.xml's.
+ * A cache of every metadata.xml in a single repository.
  */
 
-class MetadataCache : public Cache
+class MetadataShard : public Cache, public MetadataTypes
 {
     public:
         typedef std::vector<herdstat::portage::Metadata> container_type;
         typedef container_type::value_type value_type;
-        typedef container_type::iterator iterator;
-        typedef container_type::const_iterator const_iterator;
         typedef container_type::size_type size_type;
 
-        MetadataCache();
-        virtual ~MetadataCache() throw();
+        /// metadata.xml's mtime/size at the time it was parsed.
+        struct Stamp
+        {
+            Stamp() : path(), mtime(0), size(0) { }
 
-        inline const_iterator begin() const;
-        inline const_iterator end() const;
-        inline size_type size() const;
-        inline bool empty() const;
+            std::string path;
+            std::time_t mtime;
+            unsigned long size;
+        };
 
+        MetadataShard(const PackageShard& pkgs);
+        virtual ~MetadataShard() throw();
+
+        /**
+         * Load the shard if it's valid, otherwise fill and save it.  Does
+         * nothing if the shard is already loaded and still current.
+         * @param fill Whether to regenerate the shard if it isn't valid.
+         * If not, it's left empty until an update() that does fill.
+         * @returns false if the shard was left empty.
+         */
+        bool update(bool fill = true);
+
+        /// Progress meter to use from now on (may be NULL).
         inline void set_spinner(herdstat::util::ProgressMeter *spinner)
         { _spinner = spinner; }
 
+        /// Get the n'th entry.  Loaded entries are decoded on first access.
+        inline const value_type& operator[](size_type n) const;
+        inline size_type size() const;
+        inline bool empty() const;
+
+        /// Get the n'th entry's Stamp.
+        inline const Stamp& stamp(size_type n) const;
+
+        /// Decode every entry now, so reading them no longer modifies
+        /// anything (see QueryContext).
+        void decode_all() const;
+
+        /**
+         * Find the entry for a metadata.xml.
+         * @param path Path to the metadata.xml.
+         * @returns The entry's id, or size() if there's none.
+         */
+        size_type find_path(const std::string& path) const;
+
+        /**
+         * Find entries maintained by the given herd or developer.
+         * @param index HERDS or DEVS.
+         * @param key Herd name, or developer user name/email address.
+         * @param ids Vector to store the (sorted) entry ids in.
+         */
+        void find(Index index, const std::string& key, ids_type *ids) const;
+
+        /**
+         * Find entries maintained by any herd or developer whose name
+         * matches the given regular expression.
+         */
+        void find(Index index, const herdstat::util::Regex& regex,
+                  ids_type *ids) const;
+
+        /// Get every herd name (HERDS) or developer user (DEVS), sorted.
+        void keys(Index index, std::vector<std::string> *keys) const;
+
+        /// Find entries with no herds (HERDS) or developers (DEVS).
+        void find_unmaintained(Index index, ids_type *ids) const;
+
         virtual void dump_text(std::ostream& stream);
 
     protected:
         virtual std::size_t cache_size() const;
+        virtual std::size_t record_fields() const;
         virtual const char * const name() const;
+        virtual unsigned format() const;
+        /// metadata.xml's are edited in place, so they're fingerprinted too.
+        virtual bool uses_packages() const { return true; }
         virtual bool do_is_valid();
         virtual void do_fill();
-        virtual void do_load(herdstat::io::BinaryIStream& stream);
-        virtual void do_dump(herdstat::io::BinaryOStream& stream);
+        virtual void do_load(const CacheFileReader& file);
+        virtual void do_dump(CacheFileWriter& file);
+        virtual void do_unload();
 
     private:
+        friend class MetadataFillWorker;
+
+        /* record number in _stale keyed on metadata.xml path */
+        typedef std::map<std::string, std::size_t> stale_type;
+        typedef std::map<std::string, ids_type> index_type;
+        /* entry id keyed on metadata.xml path */
+        typedef std::map<std::string, size_type> paths_type;
+
+        void load_stale();
+        void build_indexes();
+        void build_paths() const;
+        bool refresh(const std::string& path,
+                     const herdstat::portage::Package& pkg,
+                     value_type *meta, Stamp *stamp, bool *reused) const;
+        void decode(size_type n) const;
+
+        const PackageShard& _pkgs;
         herdstat::util::ProgressMeter *_spinner;
-        const std::string& _portdir;
-        const std::vector<std::string>& _overlays;
-        container_type _metadatas;
+        mutable container_type _metadatas;
+        /* parallel to _metadatas */
+        mutable std::vector<Stamp> _stamps;
+        /* whether _metadatas[n] has been decoded from _records yet */
+        mutable std::vector<char> _decoded;
+        const CacheFileReader *_records;
+        /* only used when not loaded from disk */
+        index_type _indexes[2];
+        ids_type _unmaintained[2];
+        /* built on first use */
+        mutable paths_type _paths;
+        mutable bool _have_paths;
+        /* expired cache being refreshed */
+        CacheFileReader _stale;
+        stale_type _stale_index;
 };
 
-inline MetadataCache::const_iterator
-MetadataCache::begin() const
+inline const MetadataShard::value_type&
+MetadataShard::operator[](size_type n) const
 {
-    return _metadatas.begin();
+    if (_records and not _decoded[n])
+        this->decode(n);
+    return _metadatas[n];
 }
 
-inline MetadataCache::const_iterator
-MetadataCache::end() const
+inline const MetadataShard::Stamp&
+MetadataShard::stamp(size_type n) const
 {
-    return _metadatas.end();
+    if (_records and not _decoded[n])
+        this->decode(n);
+    return _stamps[n];
 }
 
-inline MetadataCache::size_type
-MetadataCache::size() const
+inline MetadataShard::size_type
+MetadataShard::size() const
 {
     return _metadatas.size();
 }
 
 inline bool
-MetadataCache::empty() const
+MetadataShard::empty() const
 {
     return _metadatas.empty();
 }
 
+/*
+ * A cache of all metadata.xml's.  Each repository (PORTDIR and each overlay)
+ * is cached in its own shard, so only the shards whose repository changed
+ * are regenerated.  Entry ids are global: the shards' entries are numbered
+ * one after the other, in the order of the package cache's shards.
+ */
+
+class MetadataCache : private herdstat::Noncopyable, public MetadataTypes
+{
+    public:
+        typedef MetadataShard::container_type container_type;
+        typedef MetadataShard::value_type value_type;
+        typedef MetadataShard::size_type size_type;
+
+        ~MetadataCache();
+
+        /**
+         * Load each valid shard and regenerate the others.  Once loaded,
+         * the shards are only revalidated (once per query; see Session) and
+         * reloaded if they've changed.  Safe to call from concurrent
+         * queries.
+         * @param spinner Progress meter to use (may be NULL).
+         * @param fill Whether to regenerate the shards that aren't valid.
+         * If not, only the valid ones are loaded, and the others are
+         * regenerated by the next update() that does fill.
+         */
+        void update(herdstat::util::ProgressMeter *spinner, bool fill = true);
+
+        /// Get the n'th entry.  Loaded entries are decoded on first access.
+        inline const value_type& operator[](size_type n) const;
+        inline size_type size() const { return _size; }
+        inline bool empty() const { return (_size == 0); }
+
+        /// @see MetadataShard::decode_all
+        void decode_all() const;
+
+        /**
+         * Get the entry for a metadata.xml, provided it's cached and the
+         * file hasn't changed since (same mtime and size).
+         * @param path Path to the metadata.xml.
+         * @returns Pointer to the entry, or NULL.
+         */
+        const value_type *find_current(const std::string& path) const;
+
+        /// @see MetadataShard::find
+        void find(Index index, const std::string& key, ids_type *ids) const;
+        /// @see MetadataShard::find
+        void find(Index index, const herdstat::util::Regex& regex,
+                  ids_type *ids) const;
+        /// @see MetadataShard::keys
+        void keys(Index index, std::vector<std::string> *keys) const;
+        /// @see MetadataShard::find_unmaintained
+        void find_unmaintained(Index index, ids_type *ids) const;
+
+        void dump_text(std::ostream& stream);
+
+    private:
+        friend MetadataCache& GlobalMetadataCache();
+        MetadataCache();
+
+        typedef std::vector<MetadataShard *> shards_type;
+
+        Mutex _lock;
+        shards_type _shards;
+        /* id of each shard's first entry */
+        std::vector<size_type> _offsets;
+        size_type _size;
+        /* query we were last revalidated in */
+        unsigned long _checked;
+        /* whether every shard was up to date as of then */
+        bool _complete;
+};
+
+/// The metadata cache, shared by every action handler.
+inline MetadataCache&
+GlobalMetadataCache()
+{
+    static MetadataCache m;
+    return m;
+}
+
+inline const MetadataCache::value_type&
+MetadataCache::operator[](size_type n) const
+{
+    /* last shard starting at or before n */
+    const std::size_t s = (std::upper_bound(_offsets.begin(),
+                            _offsets.end(), n) - _offsets.begin()) - 1;
+    return (*_shards[s])[n - _offsets[s]];
+}
+
+/**
+ * Merge a list of entry ids into another, keeping it sorted and unique.
+ * @param ids Ids to add.
+ * @param result Ids to add to.
+ */
+inline void
+merge_ids(const MetadataTypes::ids_type& ids, MetadataTypes::ids_type *result)
+{
+    if (result->empty())
+    {
+        *result = ids;
+        return;
+    }
+
+    MetadataTypes::ids_type merged;
+    merged.reserve(result->size() + ids.size());
+    std::set_union(result->begin(), result->end(), ids.begin(), ids.end(),
+        std::back_inserter(merged));
+    result->swap(merged);
+}
+
 #endif /* HAVE_METADATA_CACHE_HH */
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
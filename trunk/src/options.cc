@@ -79,22 +79,89 @@ struct ShowDeprecatedOptionWarning
 
 Options::Options()
     : _verbose(false), _quiet(false), _debug(false), _timer(false),
-      _dev(false), _count(false), _color(true), _overlay(true),
+      _all(false), _dev(false), _count(false), _color(true), _overlay(true),
       _eregex(false), _regex(false), _qa(false), _meta(false),
       _metacache(true), _devaway(true), _fetch(false),
-      _spinner(true), _devaway_expire(84600),
-      _maxcol(79), _outstream(&std::cout), _outfile("stdout"),
+      _spinner(true), _batch_ids(false),
+      _batch_threads(false), _devaway_expire(84600),
+      _maxcol(79), _metacache_threads(0), _batch_jobs(1), _outstream(&std::cout), _outfile("stdout"),
       _localstatedir(LOCALSTATEDIR), _labelcolor("green"),
       _hlcolor("yellow"), _metacache_expire("lastsync"),
       _locale(std::locale::classic().name()),
       _prompt(PACKAGE"> "),
       _action("unspecified"),
       _iomethod("stream"),
+      _output("text"),
       _portdir(portage::GlobalConfig().portdir()),
-      _overlays(portage::GlobalConfig().overlays())
+      _overlays(portage::GlobalConfig().overlays()),
+      _saved(NULL)
 {
 }
 
+void
+Options::save()
+{
+    if (not _saved)
+        _saved = new Options();
+    _saved->assign(*this);
+}
+
+void
+Options::restore()
+{
+    if (_saved)
+        assign(*_saved);
+}
+
+void
+Options::assign(const Options& that)
+{
+    _verbose = that._verbose;
+    _quiet = that._quiet;
+    _debug = that._debug;
+    _timer = that._timer;
+    _all = that._all;
+    _dev = that._dev;
+    _count = that._count;
+    _color = that._color;
+    _overlay = that._overlay;
+    _eregex = that._eregex;
+    _regex = that._regex;
+    _qa = that._qa;
+    _meta = that._meta;
+    _metacache = that._metacache;
+    _devaway = that._devaway;
+    _fetch = that._fetch;
+    _spinner = that._spinner;
+    _batch_ids = that._batch_ids;
+    _batch_threads = that._batch_threads;
+    _devaway_expire = that._devaway_expire;
+    _maxcol = that._maxcol;
+    _metacache_threads = that._metacache_threads;
+    _batch_jobs = that._batch_jobs;
+    _outstream = that._outstream;
+    _outfile = that._outfile;
+    _cvsdir = that._cvsdir;
+    _herdsxml = that._herdsxml;
+    _devawayxml = that._devawayxml;
+    _userinfoxml = that._userinfoxml;
+    _with_herd = that._with_herd;
+    _with_dev = that._with_dev;
+    _localstatedir = that._localstatedir;
+    _wgetopts = that._wgetopts;
+    _labelcolor = that._labelcolor;
+    _hlcolor = that._hlcolor;
+    _metacache_expire = that._metacache_expire;
+    _highlights = that._highlights;
+    _locale = that._locale;
+    _prompt = that._prompt;
+    _action = that._action;
+    _iomethod = that._iomethod;
+    _socket = that._socket;
+    _output = that._output;
+    _trace = that._trace;
+}
+
 void
 Options::read_configs()
 {
@@ -153,10 +220,22 @@ Options::set_options_from_config(util::Vars& vars)
         set_metacache(util::destringify<bool>(vars["use_metacache"]));
     if (not vars["metacache_expire"].empty())
 	set_metacache_expire(vars["metacache_expire"]);
+    if (not vars["metacache_threads"].empty())
+        set_metacache_threads(util::destringify<unsigned>(vars["metacache_threads"]));
+    if (not vars["batch_jobs"].empty())
+        set_batch_jobs(util::destringify<unsigned>(vars["batch_jobs"]));
+    if (not vars["batch_ids"].empty())
+        set_batch_ids(util::destringify<bool>(vars["batch_ids"]));
+    if (not vars["batch_threads"].empty())
+        set_batch_threads(util::destringify<bool>(vars["batch_threads"]));
     if (not vars["highlights"].empty())
         set_highlights(vars["highlights"]);
     if (not vars["frontend"].empty())
         set_iomethod(vars["frontend"]);
+    if (not vars["daemon_socket"].empty())
+        set_socket(vars["daemon_socket"]);
+    if (not vars["output"].empty())
+        set_output(vars["output"]);
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
@@ -40,6 +40,11 @@ class Options : private herdstat::Noncopyable
     public:
         void read_configs();
 
+        /// Remember the current settings so they can be put back later.
+        void save();
+        /// Put back the settings remembered by the last save().
+        void restore();
+
         bool verbose() const { return _verbose; }
         void set_verbose(bool v) { _verbose = v; }
         bool quiet() const { return _quiet; }
@@ -80,6 +85,16 @@ class Options : private herdstat::Noncopyable
         void set_devaway_expire(long v) { _devaway_expire = v; }
         const size_t& maxcol() const { return _maxcol; }
         void set_maxcol(size_t v) { _maxcol = v; }
+        /* 0 means one thread per online processor */
+        const unsigned& metacache_threads() const { return _metacache_threads; }
+        void set_metacache_threads(unsigned v) { _metacache_threads = v; }
+        /* 0 means one worker per online processor */
+        const unsigned& batch_jobs() const { return _batch_jobs; }
+        void set_batch_jobs(unsigned v) { _batch_jobs = v; }
+        bool batch_ids() const { return _batch_ids; }
+        void set_batch_ids(bool v) { _batch_ids = v; }
+        bool batch_threads() const { return _batch_threads; }
+        void set_batch_threads(bool v) { _batch_threads = v; }
 
         std::ostream& outstream() const { return *_outstream; }
         void set_outstream(std::ostream *s) { _outstream = s; }
@@ -119,6 +134,15 @@ class Options : private herdstat::Noncopyable
 
         const std::string& iomethod() const { return _iomethod; }
         void set_iomethod(const std::string& v) { _iomethod.assign(v); }
+        /* empty means ${localstatedir}/herdstatd.sock */
+        const std::string& socket() const { return _socket; }
+        void set_socket(const std::string& v) { _socket.assign(v); }
+        /* text (Formatter), json (JSON Lines) or binary; see record_sink.hh */
+        const std::string& output() const { return _output; }
+        void set_output(const std::string& v) { _output.assign(v); }
+        /* empty means --timer prints a summary rather than a trace */
+        const std::string& trace() const { return _trace; }
+        void set_trace(const std::string& v) { _trace.assign(v); }
 
         /* read-only */
         const std::string& portdir() const { return _portdir; }
@@ -126,9 +150,11 @@ class Options : private herdstat::Noncopyable
 
     private:
         friend Options& GlobalOptions();
+        friend class QueryContext;
         Options();
 
         void set_options_from_config(herdstat::util::Vars& v);
+        void assign(const Options& that);
 
         bool _verbose;
         bool _quiet;
@@ -147,9 +173,13 @@ class Options : private herdstat::Noncopyable
         bool _devaway;
         bool _fetch;
         bool _spinner;
+        bool _batch_ids;
+        bool _batch_threads;
 
         long _devaway_expire;
         size_t _maxcol;
+        unsigned _metacache_threads;
+        unsigned _batch_jobs;
 
         std::ostream *_outstream;
         std::string _outfile;
@@ -169,18 +199,28 @@ class Options : private herdstat::Noncopyable
         std::string _prompt;
         std::string _action;
         std::string _iomethod;
+        std::string _socket;
+        std::string _output;
+        std::string _trace;
 
 //        fields_type _fields;
 
         const std::string& _portdir;
         const std::vector<std::string>& _overlays;
+
+        Options *_saved;
 };
 
+/* options of the query running in the calling thread, or NULL if it isn't
+ * running one; see QueryContext */
+Options *context_options();
+
 inline Options&
 GlobalOptions()
 {
     static Options o;
-    return o;
+    Options * const context = context_options();
+    return (context ? *context : o);
 }
 
 #endif
@@ -27,24 +27,74 @@
 #include <herdstat/util/string.hh>
 #include <herdstat/util/progress/meter.hh>
 #include <herdstat/util/progress/spinner.hh>
+#include <cassert>
+#include <cctype>
+#include <iterator>
+#include <algorithm>
 #include <herdstat/xml/exceptions.hh>
-#include <herdstat/io/binary_stream_iterator.hh>
 
 #include "common.hh"
+#include "session.hh"
+#include "hash_map.hh"
+#include "trigram.hh"
 #include "package_cache.hh"
 
 #define PKGCACHE  /*LOCALSTATEDIR*/"/pkgcache"
-#define PKGCACHE_EXPIRE  259200 /* 3 days */
+
+/*
+ * Each record is: cat/pkg, portdir
+ *
+ * followed by the index tables:
+ *   1: ids by cat/pkg, ids by package name, ids by category
+ *   2: trigram, ids
+ *
+ * where ids is an array of uint32_t's (see encode_ids) in ascending order.
+ * Table 1 has a record per hash bucket, holding the records whose key
+ * hashes (hash_string) to that bucket; categories are folded to lower case
+ * first, for case insensitive regexes (see find_regex_candidates).  Table 2
+ * holds the records whose cat/pkg (folded to lower case) contains each
+ * trigram, sorted by trigram.
+ */
+
+#define INDEX_TABLE     1
+#define TRIGRAM_TABLE   2
+#define NTABLES         3
 
 using namespace herdstat;
 using namespace herdstat::xml;
 
-PackageCache::PackageCache(herdstat::util::ProgressMeter *progress)
-    : Cache(GlobalOptions().localstatedir()+PKGCACHE),
-      _portdir(_options.portdir()), _overlays(_options.overlays()),
-      _pkgs(_portdir, _overlays, false),
-      _spinner(progress)
+static inline char
+fold_char(char c)
+{
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+/* fold a string to lower case */
+static std::string
+fold(const std::string& s)
+{
+    std::string folded(s);
+    std::transform(folded.begin(), folded.end(), folded.begin(), fold_char);
+    return folded;
+}
+
+PackageShard::PackageShard(const std::string& repo)
+    : Cache(shard_path(GlobalOptions().localstatedir()+PKGCACHE, repo), repo),
+      _repo(repo), _no_overlays(), _pkgs(_repo, _no_overlays, false),
+      _records(NULL), _index(NULL), _spinner(NULL)
 {
+}
+
+PackageShard::~PackageShard() throw()
+{
+}
+
+bool
+PackageShard::update()
+{
+    if (this->is_loaded() and this->is_current())
+        return false;
+
     if (this->is_valid())
         this->load();
     else
@@ -52,145 +102,508 @@ PackageCache::PackageCache(herdstat::util::ProgressMeter *progress)
         this->fill();
         this->dump();
     }
-}
 
-PackageCache::~PackageCache() throw()
-{
+    return true;
 }
 
 const char * const
-PackageCache::name() const
+PackageShard::name() const
 {
     return "package";
 }
 
 std::size_t
-PackageCache::cache_size() const
+PackageShard::cache_size() const
+{
+    return this->size();
+}
+
+std::size_t
+PackageShard::record_fields() const
+{
+    return 2;
+}
+
+unsigned
+PackageShard::format() const
+{
+    return 4;
+}
+
+bool
+PackageShard::do_check(const CacheFileReader& file)
 {
-    return _pkgs.size();
+    return ((file.tables() == NTABLES) and
+            (file.table(INDEX_TABLE).fields() == NKEYS) and
+            (file.table(INDEX_TABLE).size() != 0) and
+            (file.table(TRIGRAM_TABLE).fields() == 2));
 }
 
 bool
-PackageCache::do_is_valid()
+PackageShard::do_is_valid()
+{
+    TraceContext c("PackageShard::do_is_valid()");
+    return this->is_fresh();
+}
+
+void
+PackageShard::do_fill()
+{
+    TraceContext c("PackageShard::do_fill()");
+    _records = NULL;
+    _index = NULL;
+    _pkgs.fill(_spinner);
+    this->build_index();
+}
+
+void
+PackageShard::do_load(const CacheFileReader& file)
 {
-    BacktraceContext c("PackageCache::do_is_valid()");
+    TraceContext c("PackageShard::do_load()");
 
-    const util::Stat pkgcache(this->path());
-    bool valid = false;
+    /* decoded when (if) it's needed */
+    _pkgs.clear();
+    _records = &file;
+    /* the index stays usable after decoding, since _pkgs keeps the order */
+    _index = &file;
+    for (int key = FULL ; key != NKEYS ; ++key)
+        std::vector<ids_type>().swap(_buckets[key]);
+    _trigrams.clear();
+}
+
+/*
+ * Hash index.
+ */
 
-    const std::string& expire(_options.metacache_expire());
-    const std::string lastsync(_options.localstatedir()+LASTSYNC);
+void
+PackageShard::build_index()
+{
+    TraceContext c("PackageShard::build_index()");
 
-    if (pkgcache.exists())
+    const std::size_t nbuckets = std::max<std::size_t>(_pkgs.size(), 1);
+    for (int key = FULL ; key != NKEYS ; ++key)
+        _buckets[key].assign(nbuckets, ids_type());
+    _trigrams.clear();
+
+    std::vector<std::string> t;
+    uint32_t n = 0;
+    const_iterator i;
+    for (i = _pkgs.begin() ; i != _pkgs.end() ; ++i, ++n)
+    {
+        const std::string pkg(i->full());
+        _buckets[FULL][hash_string(pkg) % nbuckets].push_back(n);
+
+        trigrams(pkg, &t);
+        for (std::vector<std::string>::iterator g = t.begin() ;
+                g != t.end() ; ++g)
+            _trigrams[*g].push_back(n);
+
+        /* categories have neither */
+        const std::string::size_type pos = pkg.rfind('/');
+        if (pos == std::string::npos)
+            continue;
+
+        const std::string name(pkg.substr(pos+1)), cat(pkg.substr(0, pos));
+        _buckets[NAME][hash_string(name) % nbuckets].push_back(n);
+        _buckets[CATEGORY][hash_string(fold(cat)) % nbuckets].push_back(n);
+    }
+}
+
+/*
+ * Get the ids in value's bucket; they still have to be checked against
+ * value, since other values may share the bucket.
+ */
+
+void
+PackageShard::lookup(Key key, const std::string& value, ids_type *ids) const
+{
+    ids->clear();
+
+    if (_index)
     {
-        if (expire == "lastsync")
+        const CacheTable& table(_index->table(INDEX_TABLE));
+        decode_ids(table.field(hash_string(value) % table.size(), key), ids);
+    }
+    else if (not _buckets[key].empty())
+        *ids = _buckets[key][hash_string(value) % _buckets[key].size()];
+}
+
+/*
+ * Get the ids of the records containing the given trigram.
+ */
+
+void
+PackageShard::lookup(const std::string& trigram, ids_type *ids) const
+{
+    ids->clear();
+
+    if (not _index)
+    {
+        trigrams_type::const_iterator i = _trigrams.find(trigram);
+        if (i != _trigrams.end())
+            *ids = i->second;
+        return;
+    }
+
+    /* binary search the sorted trigrams */
+    const CacheTable& table(_index->table(TRIGRAM_TABLE));
+    std::size_t lo = 0, hi = table.size();
+    while (lo < hi)
+    {
+        const std::size_t mid = lo + ((hi - lo) / 2);
+        const int r = table.field(mid, 0).compare(trigram);
+        if (r == 0)
         {
-            const std::string path(_portdir+"/metadata/timestamp");
-            bool has_timestamp = util::is_file(path);
-            bool has_lastsync  = util::is_file(lastsync);
-
-            if (has_timestamp and has_lastsync)
-            {
-                util::File t(path), l(lastsync);
-                valid = (t == l);
-                if (not valid)
-                {
-                    debug_msg("timestamp != lastsync ; replacing lastsync");
-                    t.close(); l.close();
-                    util::copy_file(path, lastsync);
-                }
-            }
-            else if (has_lastsync)
-            {
-                unlink(lastsync.c_str());
-                valid = ((std::time(NULL) - pkgcache.mtime()) < PKGCACHE_EXPIRE);
-            }
-            else if (has_timestamp)
-                util::copy_file(path, lastsync);
-            else
-                valid = ((std::time(NULL) - pkgcache.mtime()) < PKGCACHE_EXPIRE);
+            decode_ids(table.field(mid, 1), ids);
+            return;
         }
-        /* otherwise, treat it as a long int */
+        else if (r < 0)
+            lo = mid + 1;
         else
+            hi = mid;
+    }
+}
+
+std::string
+PackageShard::full(std::size_t n) const
+{
+    if (not _records)
+        return (_pkgs.begin() + n)->full();
+
+    return _records->field(n, 0).str();
+}
+
+portage::Package
+PackageShard::package(std::size_t n) const
+{
+    if (not _records)
+        return *(_pkgs.begin() + n);
+
+    return portage::Package(_records->field(n, 0).str(),
+                            _records->field(n, 1).str());
+}
+
+const PackageShard::container_type&
+PackageShard::pkgs() const
+{
+    if (_records)
+    {
+        TraceContext c("PackageShard::pkgs()");
+
+        _pkgs.reserve(_records->size());
+        for (std::size_t n = 0 ; n != _records->size() ; ++n)
         {
-            long ex = util::destringify<long>(expire);
-            valid = ((std::time(NULL) - pkgcache.mtime()) < ex);
+            if (_spinner)
+                ++*_spinner;
+
+            _pkgs.push_back(portage::Package(_records->field(n, 0).str(),
+                                             _records->field(n, 1).str()));
         }
 
-        /* only valid if size > 0 */
-        if (valid)
-            valid = (pkgcache.size() > 0);
+        _records = NULL;
     }
 
-    return valid;
+    return _pkgs;
 }
 
+PackageShard::size_type
+PackageShard::size() const
+{
+    return (_records ? _records->size() : _pkgs.size());
+}
+
+/*
+ * Look criteria up in the index; only matches are turned into Package
+ * objects.  If criteria contains a '/' it must match cat/pkg exactly,
+ * otherwise it may match either a category or the package name part of
+ * cat/pkg.
+ */
+
 void
-PackageCache::do_fill()
+PackageShard::find(const std::string& criteria,
+                   std::vector<portage::Package> *results) const
 {
-    BacktraceContext c("PackageCache::do_fill()");
-    _pkgs.fill(_spinner);
+    TraceContext c("PackageShard::find("+criteria+")");
+
+    const bool full = (criteria.find('/') != std::string::npos);
+
+    ids_type ids;
+    this->lookup(FULL, criteria, &ids);
+    if (not full)
+    {
+        ids_type names;
+        this->lookup(NAME, criteria, &names);
+        ids.insert(ids.end(), names.begin(), names.end());
+
+        /* keep them in the order they're in the shard */
+        std::sort(ids.begin(), ids.end());
+        ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    }
+
+    for (ids_type::iterator i = ids.begin() ; i != ids.end() ; ++i)
+    {
+        const std::string pkg(this->full(*i));
+        const std::string::size_type pos = pkg.rfind('/');
+
+        if ((pkg == criteria) or (not full and
+            (pos != std::string::npos) and
+            (pkg.compare(pos+1, std::string::npos, criteria) == 0)))
+            results->push_back(this->package(*i));
+    }
 }
 
-struct CacheEntryToPackage
-    : std::binary_function<std::string, util::ProgressMeter *, portage::Package>
+/*
+ * Intersect the posting lists of each trigram; whatever's left contains all
+ * of them.
+ */
+
+void
+PackageShard::find_trigrams(const std::vector<std::string>& trigrams,
+                            std::vector<portage::Package> *results) const
 {
-    portage::Package
-    operator()(const std::string& entry, util::ProgressMeter *spinner) const
+    TraceContext c("PackageShard::find_trigrams()");
+
+    if (trigrams.empty())
+        return;
+
+    ids_type ids, tmp, both;
+    this->lookup(trigrams.front(), &ids);
+
+    std::vector<std::string>::const_iterator t;
+    for (t = trigrams.begin() + 1 ; t != trigrams.end() and not ids.empty() ;
+            ++t)
     {
-        if (spinner)
-            ++*spinner;
+        this->lookup(*t, &tmp);
+        both.clear();
+        std::set_intersection(ids.begin(), ids.end(), tmp.begin(), tmp.end(),
+                              std::back_inserter(both));
+        ids.swap(both);
+    }
 
-        std::string::size_type pos = entry.find(':');
-        if (pos == std::string::npos)
-            throw ParserException(GlobalOptions().localstatedir()+PKGCACHE,
-                                  "Invalid format: '"+entry+"'.");
+    for (ids_type::iterator i = ids.begin() ; i != ids.end() ; ++i)
+        results->push_back(this->package(*i));
+}
 
-        return portage::Package(entry.substr(0, pos), entry.substr(pos+1));
+void
+PackageShard::find_category(const std::string& category,
+                            std::vector<portage::Package> *results) const
+{
+    TraceContext c("PackageShard::find_category("+category+")");
+
+    const std::string folded(fold(category));
+
+    ids_type ids;
+    this->lookup(CATEGORY, folded, &ids);
+
+    for (ids_type::iterator i = ids.begin() ; i != ids.end() ; ++i)
+    {
+        const std::string pkg(this->full(*i));
+        if ((pkg.rfind('/') == folded.size()) and
+            (fold(pkg.substr(0, folded.size())) == folded))
+            results->push_back(this->package(*i));
     }
-};
+}
+
+void
+PackageShard::do_dump(CacheFileWriter& file)
+{
+    TraceContext c("PackageShard::do_dump()");
+
+    std::vector<std::string> record(2);
+
+    const_iterator i;
+    for (i = this->begin() ; i != this->end() ; ++i)
+    {
+        if (_spinner)
+            ++*_spinner;
+
+        record[0].assign(i->full());
+        record[1].assign(i->portdir());
+        file.add(record);
+    }
+
+    /* only ever dumped right after being filled */
+    assert(not _buckets[FULL].empty());
+
+    record.resize(NKEYS);
+    const std::size_t table = file.add_table(NKEYS);
+    for (std::size_t b = 0 ; b != _buckets[FULL].size() ; ++b)
+    {
+        for (int key = FULL ; key != NKEYS ; ++key)
+            record[key].assign(encode_ids(_buckets[key][b]));
+        file.add(table, record);
+    }
+
+    /* std::map keeps the trigrams sorted for us */
+    record.resize(2);
+    const std::size_t trigram_table = file.add_table(2);
+    trigrams_type::const_iterator t;
+    for (t = _trigrams.begin() ; t != _trigrams.end() ; ++t)
+    {
+        record[0].assign(t->first);
+        record[1].assign(encode_ids(t->second));
+        file.add(trigram_table, record);
+    }
+}
+
+void
+PackageShard::dump_text(std::ostream& stream)
+{
+    TraceContext c("PackageShard::dump_text()");
+
+    const_iterator i;
+    for (i = this->begin() ; i != this->end() ; ++i)
+        stream << i->full() << ":" << i->portdir() << std::endl;
+}
+
+PackageCache::PackageCache()
+    : _lock(), _shards(), _pkgs(GlobalOptions().portdir(),
+                       std::vector<std::string>(), false),
+      _combined(false), _checked(0)
+{
+    const Options& options(GlobalOptions());
+
+    _shards.push_back(new PackageShard(options.portdir()));
+    std::vector<std::string>::const_iterator i;
+    for (i = options.overlays().begin() ; i != options.overlays().end() ; ++i)
+        _shards.push_back(new PackageShard(*i));
+}
 
 void
-PackageCache::do_load(herdstat::io::BinaryIStream& stream)
+PackageCache::update(herdstat::util::ProgressMeter *progress)
+{
+    MutexLock l(_lock);
+
+    shards_type::iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        (*s)->set_spinner(progress);
+
+    if (GlobalSession().checked(&_checked))
+        return;
+
+    TraceContext c("PackageCache::update()");
+
+    bool changed = false;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+    {
+        if ((*s)->update())
+            changed = true;
+    }
+
+    /* recombine right away; PackageFinder's hold on to _pkgs */
+    if (changed and _combined)
+    {
+        _pkgs.clear();
+        _combined = false;
+        this->pkgs();
+    }
+}
+
+PackageCache::~PackageCache()
+{
+    shards_type::iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        delete *s;
+}
+
+PackageCache::size_type
+PackageCache::size() const
 {
-    _pkgs.reserve(this->header_size());
-    std::transform(io::BinaryIStreamIterator<std::string>(stream),
-                   io::BinaryIStreamIterator<std::string>(),
-                   std::back_inserter(_pkgs),
-                   std::bind2nd(CacheEntryToPackage(), _spinner));
+    if (_combined)
+        return _pkgs.size();
+
+    size_type n = 0;
+    shards_type::const_iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        n += (*s)->size();
+    return n;
 }
 
-struct PackageToCacheEntry
-    : std::binary_function<portage::Package, util::ProgressMeter *, std::string>
+const PackageCache::container_type&
+PackageCache::pkgs() const
 {
-    std::string
-    operator()(const portage::Package& pkg, util::ProgressMeter *spinner) const
+    if (not _combined)
     {
-        if (spinner)
-            ++*spinner;
+        TraceContext c("PackageCache::pkgs()");
+
+        _pkgs.reserve(this->size());
 
-        return (pkg.full()+":"+pkg.portdir());
+        shards_type::const_iterator s;
+        for (s = _shards.begin() ; s != _shards.end() ; ++s)
+            _pkgs.insert(_pkgs.end(), (*s)->begin(), (*s)->end());
+
+        /* interleave overlays like a single PackageList would */
+        if (_shards.size() > 1)
+            std::sort(_pkgs.begin(), _pkgs.end());
+
+        _combined = true;
     }
-};
+
+    return _pkgs;
+}
 
 void
-PackageCache::do_dump(io::BinaryOStream& stream)
+PackageCache::find(const std::string& criteria,
+                   std::vector<portage::Package> *results) const
 {
-     BacktraceContext c("PackageCache::do_dump()");
+    const std::size_t first = results->size();
+
+    shards_type::const_iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        (*s)->find(criteria, results);
 
-     std::transform(_pkgs.begin(), _pkgs.end(),
-        io::BinaryOStreamIterator<std::string>(stream),
-        std::bind2nd(PackageToCacheEntry(), _spinner));
+    if (_shards.size() > 1)
+        std::sort(results->begin() + first, results->end());
+}
+
+bool
+PackageCache::find_regex_candidates(const std::string& regex, bool extended,
+                            std::vector<portage::Package> *results) const
+{
+    const std::size_t first = results->size();
+
+    /* a regex anchored to a category only has to be run on its packages */
+    std::string category;
+    if (regex_category(regex, extended, &category))
+    {
+        this->find_category(category, results);
+        return true;
+    }
+
+    std::vector<std::string> t;
+    if (not regex_trigrams(regex, extended, &t))
+        return false;
+
+    shards_type::const_iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        (*s)->find_trigrams(t, results);
+
+    if (_shards.size() > 1)
+        std::sort(results->begin() + first, results->end());
+
+    return true;
 }
 
 void
-PackageCache::dump_text(std::ostream& stream)
+PackageCache::find_category(const std::string& category,
+                            std::vector<portage::Package> *results) const
 {
-    BacktraceContext c("PackageCache::dump_text()");
+    const std::size_t first = results->size();
+
+    shards_type::const_iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        (*s)->find_category(category, results);
 
-     std::transform(_pkgs.begin(), _pkgs.end(),
-        std::ostream_iterator<std::string>(stream, "\n"),
-        std::bind2nd(PackageToCacheEntry(), _spinner));
+    if (_shards.size() > 1)
+        std::sort(results->begin() + first, results->end());
+}
+
+void
+PackageCache::dump_text(std::ostream& stream)
+{
+    shards_type::iterator s;
+    for (s = _shards.begin() ; s != _shards.end() ; ++s)
+        (*s)->dump_text(stream);
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
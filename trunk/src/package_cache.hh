@@ -27,12 +27,25 @@
 # include "config.h"
 #endif
 
+#include <map>
+#include <vector>
+#include <stdint.h>
+#include <herdstat/noncopyable.hh>
 #include <herdstat/portage/package_list.hh>
 
 #include "options.hh"
 #include "cache.hh"
+#include "threads.hh"
 
-class PackageCache : public Cache
+/**
+ * @class PackageShard
+ * @brief Every package in a single repository (PORTDIR or an overlay),
+ * with a hash index on cat/pkg, package name and category, so looking a
+ * package up doesn't mean scanning all of them, and a trigram index on
+ * cat/pkg to narrow down regular expression searches.
+ */
+
+class PackageShard : public Cache
 {
     public:
         typedef herdstat::portage::PackageList container_type;
@@ -41,39 +54,190 @@ class PackageCache : public Cache
         typedef container_type::size_type size_type;
         typedef container_type::value_type value_type;
 
-        virtual ~PackageCache() throw();
+        PackageShard(const std::string& repo);
+        virtual ~PackageShard() throw();
+
+        /**
+         * Load the shard if it's valid, otherwise fill and save it.  Does
+         * nothing if the shard is already loaded and still current.
+         * @returns true if the shard was (re)loaded.
+         */
+        bool update();
+
+        /// Progress meter to use from now on (may be NULL).
+        inline void set_spinner(herdstat::util::ProgressMeter *progress)
+        { _spinner = progress; }
+
+        inline const std::string& repo() const { return _repo; }
 
-        inline operator const container_type&() const { return _pkgs; }
+        /* these decode the whole shard if it hasn't been already */
+        inline const_iterator begin() const { return pkgs().begin(); }
+        inline const_iterator end() const { return pkgs().end(); }
 
-        inline const_iterator begin() const { return _pkgs.begin(); }
-        inline const_iterator end() const { return _pkgs.end(); }
-        inline size_type size() const { return _pkgs.size(); }
-        inline bool empty() const { return _pkgs.empty(); }
+        size_type size() const;
+        inline bool empty() const { return (this->size() == 0); }
+
+        /**
+         * Find all packages matching the given criteria (either a category,
+         * cat/pkg, or pkg name) without decoding the entire shard.
+         * @param criteria Search criteria.
+         * @param results Vector to append matches to.
+         */
+        void find(const std::string& criteria,
+                  std::vector<herdstat::portage::Package> *results) const;
+
+        /**
+         * Find all packages in the given category, ignoring case.
+         * @param category Category.
+         * @param results Vector to append matches to.
+         */
+        void find_category(const std::string& category,
+                  std::vector<herdstat::portage::Package> *results) const;
+
+        /**
+         * Find all packages whose cat/pkg (folded to lower case) contains
+         * every one of the given trigrams.
+         * @param trigrams Trigrams (see trigrams()).
+         * @param results Vector to append matches to.
+         */
+        void find_trigrams(const std::vector<std::string>& trigrams,
+                  std::vector<herdstat::portage::Package> *results) const;
 
         virtual void dump_text(std::ostream& stream);
 
     protected:
         virtual std::size_t cache_size() const;
+        virtual std::size_t record_fields() const;
         virtual const char * const name() const;
+        virtual unsigned format() const;
+        virtual bool do_check(const CacheFileReader& file);
         virtual bool do_is_valid();
-        virtual void do_load(herdstat::io::BinaryIStream& stream);
-        virtual void do_dump(herdstat::io::BinaryOStream& stream);
+        virtual void do_load(const CacheFileReader& file);
+        virtual void do_dump(CacheFileWriter& file);
         virtual void do_fill();
 
     private:
-        friend const PackageCache& GlobalPkgCache(herdstat::util::ProgressMeter *);
-        PackageCache(herdstat::util::ProgressMeter *progress);
+        typedef std::vector<uint32_t> ids_type;
+        typedef std::map<std::string, ids_type> trigrams_type;
+
+        /// Index keys.
+        enum Key { FULL, NAME, CATEGORY, NKEYS };
 
-        const std::string& _portdir;
-        const std::vector<std::string>& _overlays;
-        container_type _pkgs;
+        const container_type& pkgs() const;
+        void build_index();
+        void lookup(Key key, const std::string& value, ids_type *ids) const;
+        void lookup(const std::string& trigram, ids_type *ids) const;
+        std::string full(std::size_t n) const;
+        herdstat::portage::Package package(std::size_t n) const;
+
+        const std::string _repo;
+        const std::vector<std::string> _no_overlays;
+        mutable container_type _pkgs;
+        /* non-NULL until the mapped cache has been decoded into _pkgs */
+        mutable const CacheFileReader *_records;
+        /* the mapped cache's index; NULL if we were filled */
+        const CacheFileReader *_index;
+        /* _pkgs' ids by bucket, for each key (when not using _records) */
+        std::vector<ids_type> _buckets[NKEYS];
+        /* _pkgs' ids by trigram (likewise) */
+        trigrams_type _trigrams;
         herdstat::util::ProgressMeter *_spinner;
 };
 
-inline const PackageCache&
+/**
+ * @class PackageCache
+ * @brief Every package in PORTDIR and each overlay.  Each repository is
+ * cached in its own shard, so a change in one of them only causes that
+ * shard to be regenerated.
+ */
+
+class PackageCache : private herdstat::Noncopyable
+{
+    public:
+        typedef herdstat::portage::PackageList container_type;
+        typedef container_type::iterator iterator;
+        typedef container_type::const_iterator const_iterator;
+        typedef container_type::size_type size_type;
+        typedef container_type::value_type value_type;
+        typedef std::vector<PackageShard *> shards_type;
+
+        ~PackageCache();
+
+        /* these decode every shard if they haven't been already */
+        inline operator const container_type&() const { return pkgs(); }
+        inline const_iterator begin() const { return pkgs().begin(); }
+        inline const_iterator end() const { return pkgs().end(); }
+
+        size_type size() const;
+        inline bool empty() const { return (this->size() == 0); }
+
+        /// Shards, PORTDIR's first and then each overlay's (in order).
+        inline const shards_type& shards() const { return _shards; }
+
+        /**
+         * Find all packages matching the given criteria (either a category,
+         * cat/pkg, or pkg name) without decoding the entire cache.
+         * @param criteria Search criteria.
+         * @param results Vector to append matches to.
+         */
+        void find(const std::string& criteria,
+                  std::vector<herdstat::portage::Package> *results) const;
+
+        /**
+         * Find all packages in the given category, ignoring case.
+         * @param category Category.
+         * @param results Vector to append matches to.
+         */
+        void find_category(const std::string& category,
+                  std::vector<herdstat::portage::Package> *results) const;
+
+        /**
+         * Find the packages that could match a regular expression, using
+         * the category index if it's anchored to a category (see
+         * regex_category), or else the trigram index; the regex itself
+         * still has to be run on them.
+         * @param regex POSIX regular expression.
+         * @param extended Is regex an extended regular expression?
+         * @param results Vector to append candidates to.
+         * @returns false if nothing could be extracted from regex to look
+         * up, in which case every package has to be searched.
+         */
+        bool find_regex_candidates(const std::string& regex, bool extended,
+                  std::vector<herdstat::portage::Package> *results) const;
+
+        void dump_text(std::ostream& stream);
+
+        /**
+         * Bring each shard up to date (once per query; see Session).  Safe
+         * to call from concurrent queries.
+         * @param progress Progress meter to use (may be NULL).
+         */
+        void update(herdstat::util::ProgressMeter *progress);
+
+    private:
+        friend PackageCache& GlobalPkgCache(herdstat::util::ProgressMeter *);
+        PackageCache();
+
+        const container_type& pkgs() const;
+
+        Mutex _lock;
+        shards_type _shards;
+        /* combined shards, once somebody wants them all */
+        mutable container_type _pkgs;
+        mutable bool _combined;
+        /* query we were last revalidated in */
+        unsigned long _checked;
+};
+
+/**
+ * The package cache, loaded once per process and revalidated once per
+ * query.
+ */
+inline PackageCache&
 GlobalPkgCache(herdstat::util::ProgressMeter *spinner)
 {
-    static PackageCache p(spinner);
+    static PackageCache p;
+    p.update(spinner);
     return p;
 }
 
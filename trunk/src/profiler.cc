@@ -0,0 +1,209 @@
+/*
+ * herdstat -- src/profiler.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cstdio>
+#include <algorithm>
+#include <sys/time.h>
+#include <unistd.h>
+#include <herdstat/exceptions.hh>
+
+#include "profiler.hh"
+
+static const char * const counter_names[Profiler::NCOUNTERS] =
+{
+    "files stat'ed",
+    "XML files parsed",
+    "regex evaluations",
+    "result lines"
+};
+
+Profiler::Profiler()
+    : _enabled(false), _epoch_sec(0), _epoch_usec(0), _trace(), _lock(),
+      _events(), _totals(), _tids(), _threads(0)
+{
+    std::fill(_counters, _counters + NCOUNTERS, 0);
+}
+
+void
+Profiler::enable(const std::string& trace)
+{
+    if (not trace.empty())
+    {
+        _trace.open(trace.c_str());
+        if (not _trace)
+            throw herdstat::FileException(trace);
+    }
+
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    _epoch_sec = tv.tv_sec;
+    _epoch_usec = tv.tv_usec;
+    _enabled = true;
+}
+
+long
+Profiler::now() const
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return ((tv.tv_sec - _epoch_sec) * 1000000L) + (tv.tv_usec - _epoch_usec);
+}
+
+unsigned
+Profiler::tid()
+{
+    unsigned *id = _tids.get();
+    if (not id)
+    {
+        id = new unsigned(++_threads);
+        _tids.set(id);
+    }
+    return *id;
+}
+
+void
+Profiler::add(const char *name, const char *cat, long start, long dur)
+{
+    MutexLock l(_lock);
+
+    std::string key(name);
+    if (cat)
+        key += std::string(" (") + cat + ")";
+
+    Total& t(_totals[key]);
+    ++t.calls;
+    t.total += dur;
+    t.max = std::max(t.max, dur);
+
+    if (_trace.is_open())
+    {
+        Event e;
+        e.name.assign(name);
+        if (cat)
+            e.cat.assign(cat);
+        e.start = start;
+        e.dur = dur;
+        e.tid = this->tid();
+        _events.push_back(e);
+    }
+}
+
+void
+Profiler::count(Counter c, unsigned long n)
+{
+    MutexLock l(_lock);
+    _counters[c] += n;
+}
+
+void
+Profiler::report(std::ostream& stream)
+{
+    MutexLock l(_lock);
+
+    if (_trace.is_open())
+    {
+        this->write_trace(_trace);
+        _trace.close();
+    }
+    else
+        this->write_summary(stream);
+}
+
+/* most time first */
+struct TotalGreater
+{
+    template <typename T>
+    bool operator()(const T& t1, const T& t2) const
+    { return (t1.second.total > t2.second.total); }
+};
+
+static std::string
+ms(long usec)
+{
+    char buf[32];
+    std::sprintf(buf, "%.3f", usec / 1000.0);
+    return buf;
+}
+
+void
+Profiler::write_summary(std::ostream& stream) const
+{
+    std::vector<std::pair<std::string, Total> >
+        totals(_totals.begin(), _totals.end());
+    std::stable_sort(totals.begin(), totals.end(), TotalGreater());
+
+    char buf[128];
+    std::sprintf(buf, "%-36s %8s %12s %12s", "phase", "calls",
+        "total ms", "max ms");
+    stream << buf << std::endl;
+
+    std::vector<std::pair<std::string, Total> >::iterator i;
+    for (i = totals.begin() ; i != totals.end() ; ++i)
+    {
+        std::sprintf(buf, "%-36.36s %8lu %12s %12s", i->first.c_str(),
+            i->second.calls, ms(i->second.total).c_str(),
+            ms(i->second.max).c_str());
+        stream << buf << std::endl;
+    }
+
+    stream << std::endl;
+    for (std::size_t n = 0 ; n != NCOUNTERS ; ++n)
+    {
+        std::sprintf(buf, "%-36s %8lu", counter_names[n], _counters[n]);
+        stream << buf << std::endl;
+    }
+}
+
+/* phase names and categories are literals of ours, so need no escaping */
+void
+Profiler::write_trace(std::ostream& stream) const
+{
+    const pid_t pid = getpid();
+
+    stream << "{\"traceEvents\":[" << std::endl;
+
+    std::vector<Event>::const_iterator i;
+    for (i = _events.begin() ; i != _events.end() ; ++i)
+    {
+        stream << "{\"name\":\"" << i->name << "\",\"cat\":\"" << i->cat
+               << "\",\"ph\":\"X\",\"ts\":" << i->start
+               << ",\"dur\":" << i->dur << ",\"pid\":" << pid
+               << ",\"tid\":" << i->tid << "}," << std::endl;
+    }
+
+    /* counters as of the end */
+    stream << "{\"name\":\"counters\",\"ph\":\"C\",\"ts\":" << this->now()
+           << ",\"pid\":" << pid << ",\"tid\":1,\"args\":{";
+    for (std::size_t n = 0 ; n != NCOUNTERS ; ++n)
+    {
+        if (n != 0)
+            stream << ",";
+        stream << "\"" << counter_names[n] << "\":" << _counters[n];
+    }
+    stream << "}}" << std::endl << "],\"displayTimeUnit\":\"ms\"}" << std::endl;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,177 @@
+/*
+ * herdstat -- src/profiler.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_PROFILER_HH
+#define _HAVE_SRC_PROFILER_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <herdstat/noncopyable.hh>
+
+#include "threads.hh"
+
+/**
+ * @class Profiler
+ * @brief What --timer measures.  Phases (spans of time; see ProfileScope)
+ * and counters are only recorded once it's been enabled.  report() then
+ * writes either a summary of each phase and counter, or, with --trace, a
+ * Chrome trace (the JSON that chrome://tracing and Perfetto load) with an
+ * event per phase.  Batch worker processes (-j) keep their own, which are
+ * never reported.
+ */
+
+class Profiler : private herdstat::Noncopyable
+{
+    public:
+        enum Counter
+        {
+            STATS,          ///< files stat'ed by herdstat (not libherdstat)
+            XML_PARSES,     ///< XML documents parsed (not loaded from cache)
+            REGEX_EVALS,    ///< strings matched against a regex
+            RESULT_LINES,   ///< result lines added by actions
+            NCOUNTERS
+        };
+
+        /**
+         * Start recording.
+         * @param trace Path to write a trace to, or empty for a summary.
+         * @exception herdstat::FileException if trace can't be written.
+         */
+        void enable(const std::string& trace);
+        bool enabled() const { return _enabled; }
+
+        /// Microseconds since enable().
+        long now() const;
+
+        /**
+         * Record a phase.
+         * @param name Phase.
+         * @param cat What it's a phase of (action or cache), or NULL.
+         * @param start When it started (see now()).
+         * @param dur How long it took, in microseconds.
+         */
+        void add(const char *name, const char *cat, long start, long dur);
+
+        /// Add to a counter.
+        void count(Counter c, unsigned long n);
+
+        /// Write the summary to the given stream, or the trace to its file.
+        void report(std::ostream& stream);
+
+    private:
+        friend Profiler& GlobalProfiler();
+        Profiler();
+
+        struct Event
+        {
+            std::string name;
+            std::string cat;
+            long start;
+            long dur;
+            unsigned tid;
+        };
+
+        struct Total
+        {
+            Total() : calls(0), total(0), max(0) { }
+
+            unsigned long calls;
+            long total;
+            long max;
+        };
+
+        /* small per-thread number for trace events; _lock must be held */
+        unsigned tid();
+
+        void write_summary(std::ostream& stream) const;
+        void write_trace(std::ostream& stream) const;
+
+        bool _enabled;
+        long _epoch_sec;
+        long _epoch_usec;
+        std::ofstream _trace;
+        Mutex _lock;
+        /* only kept when writing a trace */
+        std::vector<Event> _events;
+        /* keyed on "name (cat)" */
+        std::map<std::string, Total> _totals;
+        unsigned long _counters[NCOUNTERS];
+        ThreadSpecific<unsigned> _tids;
+        unsigned _threads;
+};
+
+/// The profiler, shared by every thread.
+inline Profiler&
+GlobalProfiler()
+{
+    static Profiler p;
+    return p;
+}
+
+/// Add to a counter if --timer is on.
+inline void
+profile_count(Profiler::Counter c, unsigned long n = 1)
+{
+    Profiler& p(GlobalProfiler());
+    if (p.enabled())
+        p.count(c, n);
+}
+
+/**
+ * @class ProfileScope
+ * @brief Records its own lifetime as a phase, if --timer is on.
+ */
+
+class ProfileScope : private herdstat::Noncopyable
+{
+    public:
+        /**
+         * @param name Phase (must outlive the scope; normally a literal).
+         * @param cat What it's a phase of, or NULL.
+         */
+        ProfileScope(const char *name, const char *cat = NULL)
+            : _name(name), _cat(cat),
+              _start(GlobalProfiler().enabled() ? GlobalProfiler().now() : -1)
+        { }
+
+        ~ProfileScope()
+        {
+            if (_start >= 0)
+                GlobalProfiler().add(_name, _cat, _start,
+                    GlobalProfiler().now() - _start);
+        }
+
+    private:
+        const char * const _name;
+        const char * const _cat;
+        const long _start;
+};
+
+#endif /* _HAVE_SRC_PROFILER_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -54,9 +54,9 @@ class QuerySpec
         QuerySpec& operator= (const std::pair<first_type, second_type>& p)
         { first.assign(p.first) ; second.assign(p.second) ; return *this; }
 
-        bool operator== (const std::pair<first_type, second_type>& p)
+        bool operator== (const std::pair<first_type, second_type>& p) const
         { return ((p.first == first) and (p.second == second)); }
-        bool operator!= (const std::pair<first_type, second_type>& p)
+        bool operator!= (const std::pair<first_type, second_type>& p) const
         { return not (*this == p); }
 
         first_type first;
@@ -174,6 +174,9 @@ class QueryBase
         container_type& container() { return _query; }
         const container_type& container() const { return _query; }
 
+        /// Every add()/push_back() ends up here.
+        virtual void append(const value_type& v) { _query.push_back(v); }
+
     private:
         container_type _query;
 };
@@ -259,13 +262,13 @@ QueryBase::push_back(const std::string& val)
 inline void
 QueryBase::push_back(const value_type& v)
 {
-    _query.push_back(v);
+    this->append(v);
 }
 
 inline void
 QueryBase::push_back(const std::pair<std::string, std::string>& p)
 {
-    _query.push_back(p);
+    this->append(p);
 }
 
 inline QueryBase::iterator
@@ -310,7 +313,7 @@ QueryBase::add(const std::string& val)
 inline void
 QueryBase::add(const std::string& field, const std::string& val)
 {
-    _query.push_back(value_type(field, val));
+    this->append(value_type(field, val));
 }
 
 inline void
@@ -340,13 +343,13 @@ QueryBase::add(const std::string& field, const char * const val)
 inline void
 QueryBase::add(const value_type& v)
 {
-    _query.push_back(v);
+    this->append(v);
 }
 
 inline void
 QueryBase::add(const std::pair<std::string, std::string>& p)
 {
-    _query.push_back(p);
+    this->append(p);
 }
 
 template <typename T>
@@ -0,0 +1,133 @@
+/*
+ * herdstat -- src/query_context.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <memory>
+
+#include "exceptions.hh"
+#include "threads.hh"
+#include "handler_map.hh"
+#include "action/handler.hh"
+#include "query_context.hh"
+
+static ThreadSpecific<QueryContext>&
+running()
+{
+    static ThreadSpecific<QueryContext> t;
+    return t;
+}
+
+/* makes a context current in the calling thread for its lifetime */
+class RunningContext : private herdstat::Noncopyable
+{
+    public:
+        RunningContext(QueryContext *context)
+            : _previous(running().get()) { running().set(context); }
+        ~RunningContext() { running().set(_previous); }
+
+    private:
+        QueryContext *_previous;
+};
+
+Options *
+context_options()
+{
+    QueryContext * const context = running().get();
+    return (context ? &context->options() : NULL);
+}
+
+TraceContext::TraceContext(const std::string& context)
+    : _context(running().get() ? NULL :
+               new herdstat::BacktraceContext(context))
+{
+}
+
+TraceContext::~TraceContext()
+{
+    if (_context)
+        delete _context;
+}
+
+QueryContext::QueryContext()
+    : _options(new Options())
+{
+    _options->assign(GlobalOptions());
+    /* the spinner can't tell whose query it's showing */
+    _options->set_spinner(false);
+}
+
+QueryContext::~QueryContext()
+{
+    delete _options;
+}
+
+QueryContext *
+QueryContext::current()
+{
+    return running().get();
+}
+
+static ActionHandler *
+prototype(const std::string& action)
+{
+    HandlerMap<ActionHandler>& handlers(GlobalHandlerMap<ActionHandler>());
+    HandlerMap<ActionHandler>::iterator i = handlers.find(action);
+    return (i == handlers.end() ? NULL : i->second);
+}
+
+bool
+QueryContext::prepare(const std::string& action)
+{
+    ActionHandler * const p = prototype(action);
+    if (not p)
+        return false;
+
+    std::auto_ptr<ActionHandler> h(p->create());
+    if (not h.get())
+        return false;
+
+    h->prepare();
+    return true;
+}
+
+void
+QueryContext::operator()(const std::string& action, Query& query,
+                         QueryResults * const results)
+{
+    ActionHandler * const p = prototype(action);
+    if (not p)
+        throw ActionUnimplemented(action);
+
+    RunningContext r(this);
+
+    /* created here so it picks up our options */
+    std::auto_ptr<ActionHandler> h(p->create());
+    if (not h.get())
+        throw ActionUnimplemented(action);
+
+    (*h)(query, results);
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
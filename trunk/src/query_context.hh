@@ -0,0 +1,91 @@
+/*
+ * herdstat -- src/query_context.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_QUERY_CONTEXT_HH
+#define _HAVE_SRC_QUERY_CONTEXT_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <herdstat/noncopyable.hh>
+
+#include "options.hh"
+#include "query.hh"
+#include "query_results.hh"
+
+/**
+ * @class QueryContext
+ * @brief Runs a query so that any number of them can run in parallel
+ * threads.
+ *
+ * Each context carries its own copy of the options, taken when it's
+ * created.  While a query runs, GlobalOptions() returns that copy in the
+ * running thread, so whatever the action changes stays within the query.
+ * The action runs in a fresh handler (see ActionHandler::create()), so
+ * handlers' per-query state isn't shared either.
+ *
+ * The XML documents and the package and metadata caches are shared by every
+ * query.  Call prepare() for each action to be run before starting any
+ * queries.  It brings the shared data up to date and decodes it fully, so
+ * the queries only ever read it.  Neither prepare() nor
+ * Session::begin_query() may be called while queries are running.
+ */
+
+class QueryContext : private herdstat::Noncopyable
+{
+    public:
+        /// Take a copy of the calling thread's current options.
+        QueryContext();
+        ~QueryContext();
+
+        /// This query's options.
+        Options& options() { return *_options; }
+        const Options& options() const { return *_options; }
+
+        /**
+         * Run an action.
+         * @exception ActionUnimplemented if there's no such action or it
+         * can't run in a context.
+         * @exception ActionException as thrown by the action.
+         */
+        void operator()(const std::string& action, Query& query,
+                        QueryResults * const results);
+
+        /**
+         * Bring the data an action uses up to date for queries about to
+         * run concurrently.
+         * @returns false if the action can't run in a context.
+         */
+        static bool prepare(const std::string& action);
+
+        /// Context the calling thread is running a query in, or NULL.
+        static QueryContext *current();
+
+    private:
+        Options *_options;
+};
+
+#endif /* _HAVE_SRC_QUERY_CONTEXT_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
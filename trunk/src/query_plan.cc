@@ -0,0 +1,146 @@
+/*
+ * herdstat -- src/query_plan.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cstring>
+
+#include "common.hh"
+#include "profiler.hh"
+#include "query_plan.hh"
+
+using namespace herdstat;
+
+QueryPlan::QueryPlan()
+    : _regexes(), _combined(), _str()
+{
+}
+
+void
+QueryPlan::clear()
+{
+    _regexes.clear();
+    _combined = util::Regex();
+    _str.clear();
+}
+
+/*
+ * Can a term go into the alternation as is?  Not if it has a back-reference,
+ * since wrapping each term in a group renumbers them, nor any escape besides
+ * an escaped special character (\w and the like are GNU extensions, and a
+ * trailing '\' would escape the closing parenthesis).
+ */
+
+static bool
+combinable(const std::string& term)
+{
+    std::string::size_type i;
+    for (i = term.find('\\') ; i != std::string::npos ;
+            i = term.find('\\', i + 2))
+    {
+        if (((i + 1) == term.size()) or (term[i+1] == '\0') or
+            not std::strchr(".[]()*+?{}|^$\\", term[i+1]))
+            return false;
+    }
+
+    return true;
+}
+
+void
+QueryPlan::compile(const Query& query, int cflags)
+{
+    TraceContext c("QueryPlan::compile()");
+
+    this->clear();
+
+    /* compile in place; copying a Regex means compiling it again */
+    _regexes.reserve(query.size());
+
+    std::string alternation;
+    bool combine = true;
+    for (Query::const_iterator q = query.begin() ; q != query.end() ; ++q)
+    {
+        _regexes.push_back(util::Regex());
+        _regexes.back().assign(q->second, cflags);
+
+        if (not _str.empty())
+        {
+            _str += "', '";
+            alternation += "|";
+        }
+
+        _str += q->second;
+        alternation += "(" + q->second + ")";
+        combine = (combine and combinable(q->second));
+    }
+
+    /* basic regular expressions have no (portable) alternation */
+    if (combine and (_regexes.size() > 1) and
+        (cflags & util::Regex::extended))
+        _combined.assign(alternation, cflags);
+}
+
+bool
+QueryPlan::matches(const std::string& s) const
+{
+    if (not _combined.empty())
+    {
+        profile_count(Profiler::REGEX_EVALS);
+        return (_combined == s);
+    }
+
+    std::vector<util::Regex>::const_iterator i;
+    for (i = _regexes.begin() ; i != _regexes.end() ; ++i)
+    {
+        profile_count(Profiler::REGEX_EVALS);
+        if (*i == s)
+            return true;
+    }
+
+    return false;
+}
+
+bool
+QueryPlan::matches(const std::string& s, hits_type *hits) const
+{
+    hits->clear();
+
+    /* most strings won't match anything, so rule that out with one test
+     * before trying the terms individually */
+    if (not _combined.empty())
+    {
+        profile_count(Profiler::REGEX_EVALS);
+        if (_combined != s)
+            return false;
+    }
+
+    profile_count(Profiler::REGEX_EVALS, _regexes.size());
+    for (std::size_t n = 0 ; n != _regexes.size() ; ++n)
+        if (_regexes[n] == s)
+            hits->push_back(n);
+
+    return (not hits->empty());
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
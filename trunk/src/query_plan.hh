@@ -0,0 +1,95 @@
+/*
+ * herdstat -- src/query_plan.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_QUERY_PLAN_HH
+#define _HAVE_SRC_QUERY_PLAN_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <herdstat/noncopyable.hh>
+#include <herdstat/util/regex.hh>
+
+#include "query.hh"
+
+/**
+ * @class QueryPlan
+ * @brief Regular expressions for each term of a query, compiled once up
+ * front.  When extended regular expressions are used and there's more than
+ * one term, the terms are also combined into a single alternation so a
+ * string can be tested against all of them at once (unless a term has a
+ * back-reference or an escape that wouldn't survive being combined).
+ */
+
+class QueryPlan : private herdstat::Noncopyable
+{
+    public:
+        typedef std::vector<std::size_t> hits_type;
+
+        QueryPlan();
+
+        /**
+         * Compile each term of the given query.
+         * @param query Query object.
+         * @param cflags Regex flags.
+         * @exception herdstat::BadRegex
+         */
+        void compile(const Query& query, int cflags);
+        void clear();
+
+        bool empty() const { return _regexes.empty(); }
+        std::size_t size() const { return _regexes.size(); }
+
+        /// Get the compiled regex for the n'th term.
+        const herdstat::util::Regex& operator[](std::size_t n) const
+        { return _regexes[n]; }
+        /// Get the n'th term.
+        const std::string& term(std::size_t n) const
+        { return _regexes[n](); }
+        /// All terms combined into one regex; empty if they couldn't be.
+        const herdstat::util::Regex& combined() const { return _combined; }
+        /// All terms, for use in messages.
+        const std::string& str() const { return _str; }
+
+        /// Does the given string match any of the terms?
+        bool matches(const std::string& s) const;
+
+        /**
+         * Find which terms the given string matches.
+         * @param s String to match.
+         * @param hits Vector to store the term numbers in (cleared first).
+         * @returns True if at least one term matched.
+         */
+        bool matches(const std::string& s, hits_type *hits) const;
+
+    private:
+        std::vector<herdstat::util::Regex> _regexes;
+        herdstat::util::Regex _combined;
+        std::string _str;
+};
+
+#endif /* _HAVE_SRC_QUERY_PLAN_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
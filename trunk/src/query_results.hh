@@ -27,15 +27,96 @@
 # include "config.h"
 #endif
 
+#include <ostream>
+
 #include "query_base.hh"
+#include "profiler.hh"
+
+/**
+ * @class ResultsSink
+ * @brief Somewhere to write result lines to as they're added, rather than
+ * keeping them all until the query is done.
+ */
+
+class ResultsSink
+{
+    public:
+        virtual ~ResultsSink() { }
+
+        /// Write a result line.
+        virtual void write(const QuerySpec& line) = 0;
+};
+
+/**
+ * @class StreamSink
+ * @brief Writes the data part of each result line to a stream, one per line
+ * (the way the batch front-end has always output results).
+ */
+
+class StreamSink : public ResultsSink
+{
+    public:
+        StreamSink(std::ostream& stream) : _stream(stream) { }
+
+        virtual void write(const QuerySpec& line)
+        {
+            ProfileScope p("output");
+            _stream << line.second << "\n";
+        }
+
+    private:
+        std::ostream& _stream;
+};
+
+/**
+ * @class QueryResults
+ * @brief Result lines of a query.  They're kept until the front-end
+ * displays them, unless a sink has been set, in which case each is written
+ * to the sink as it's added and none are kept.
+ */
 
 class QueryResults : public QueryBase
 {
     public:
+        QueryResults() : _sink(NULL), _lines(0), _last(std::string()) { }
         virtual ~QueryResults() { }
 
         /// Add an empty line.
         inline void add_linebreak();
+
+        /**
+         * Write lines to the given sink from now on (NULL to keep them,
+         * which is the default).
+         */
+        void set_sink(ResultsSink *sink) { _sink = sink; }
+        /// Are lines being written to a sink rather than kept?
+        bool streaming() const { return (_sink != NULL); }
+
+        /// Number of lines added so far, whether they were kept or not.
+        size_type lines() const { return _lines; }
+        /// The last line added (kept or not); only valid if lines() != 0.
+        const value_type& last() const
+        { return (this->empty() ? _last : this->back()); }
+
+    protected:
+        virtual void append(const value_type& v)
+        {
+            ++_lines;
+            profile_count(Profiler::RESULT_LINES);
+
+            if (_sink)
+            {
+                _last = v;
+                _sink->write(v);
+            }
+            else
+                this->container().push_back(v);
+        }
+
+    private:
+        ResultsSink *_sink;
+        size_type _lines;
+        value_type _last;
 };
 
 inline void
@@ -0,0 +1,201 @@
+/*
+ * herdstat -- src/record_sink.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cstdio>
+
+#include "exceptions.hh"
+#include "profiler.hh"
+#include "record_sink.hh"
+
+/* drop terminal color sequences (ESC [ ... m) */
+static std::string
+uncolor(const std::string& str)
+{
+    if (str.find('\033') == std::string::npos)
+        return str;
+
+    std::string result;
+    result.reserve(str.size());
+
+    std::string::size_type i = 0;
+    while (i != str.size())
+    {
+        if (str[i] == '\033')
+        {
+            const std::string::size_type end = str.find('m', i);
+            if (end == std::string::npos)
+                break;
+            i = end + 1;
+        }
+        else
+            result += str[i++];
+    }
+
+    return result;
+}
+
+RecordSink *
+RecordSink::create(const std::string& format, std::ostream& stream)
+{
+    if (format == "text")
+        return NULL;
+    else if (format == "json")
+        return new JsonSink(stream);
+    else if (format == "binary")
+        return new BinarySink(stream);
+
+    throw BadOption("Unknown output format '" + format +
+        "'.  Use text, json or binary.");
+}
+
+bool
+RecordSink::is_format(const std::string& format)
+{
+    return (format == "text" or format == "json" or format == "binary");
+}
+
+void
+RecordSink::begin(const std::string& action)
+{
+    _action.assign(action);
+    _fields.clear();
+}
+
+void
+RecordSink::write(const QuerySpec& line)
+{
+    if (line.first.empty() and line.second.empty())
+        finish();
+    else
+        _fields.push_back(QuerySpec(uncolor(line.first), uncolor(line.second)));
+}
+
+void
+RecordSink::finish()
+{
+    if (_fields.empty())
+        return;
+
+    ProfileScope p("output");
+    write_record(_stream, _action, _fields);
+    _fields.clear();
+}
+
+static void
+write_json_string(std::ostream& stream, const std::string& str)
+{
+    stream << '"';
+
+    std::string::const_iterator i;
+    for (i = str.begin() ; i != str.end() ; ++i)
+    {
+        const unsigned char c = *i;
+        switch (c)
+        {
+            case '"':  stream << "\\\""; break;
+            case '\\': stream << "\\\\"; break;
+            case '\n': stream << "\\n"; break;
+            case '\t': stream << "\\t"; break;
+            case '\r': stream << "\\r"; break;
+            default:
+                if (c < 0x20)
+                {
+                    char buf[7];
+                    std::sprintf(buf, "\\u%04x", c);
+                    stream << buf;
+                }
+                else
+                    stream << *i;
+        }
+    }
+
+    stream << '"';
+}
+
+void
+JsonSink::write_record(std::ostream& stream, const std::string& action,
+                       const fields_type& fields)
+{
+    stream << "{\"action\":";
+    write_json_string(stream, action);
+    stream << ",\"fields\":[";
+
+    fields_type::const_iterator i;
+    for (i = fields.begin() ; i != fields.end() ; ++i)
+    {
+        if (i != fields.begin())
+            stream << ',';
+
+        stream << '{';
+        if (not i->first.empty())
+        {
+            stream << "\"label\":";
+            write_json_string(stream, i->first);
+            stream << ',';
+        }
+        stream << "\"value\":";
+        write_json_string(stream, i->second);
+        stream << '}';
+    }
+
+    stream << "]}\n";
+}
+
+static void
+put_u32(std::string *buf, unsigned long n)
+{
+    for (int i = 0 ; i != 4 ; ++i, n >>= 8)
+        *buf += static_cast<char>(n & 0xff);
+}
+
+static void
+put_string(std::string *buf, const std::string& str)
+{
+    put_u32(buf, str.size());
+    buf->append(str);
+}
+
+void
+BinarySink::write_record(std::ostream& stream, const std::string& action,
+                         const fields_type& fields)
+{
+    std::string body;
+    put_string(&body, action);
+    put_u32(&body, fields.size());
+
+    fields_type::const_iterator i;
+    for (i = fields.begin() ; i != fields.end() ; ++i)
+    {
+        put_string(&body, i->first);
+        put_string(&body, i->second);
+    }
+
+    std::string length;
+    put_u32(&length, body.size());
+    stream << length << body;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
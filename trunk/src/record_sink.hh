@@ -0,0 +1,132 @@
+/*
+ * herdstat -- src/record_sink.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_RECORD_SINK_HH
+#define _HAVE_RECORD_SINK_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "query_results.hh"
+
+/**
+ * @class RecordSink
+ * @brief Writes result lines as machine-readable records instead of
+ * passing them through the Formatter.  A record is a run of lines up to the
+ * next empty line (or the end of the query), which is how every action
+ * already separates one herd, developer or package from the next.  Each
+ * field keeps its label and its value, minus any colors.
+ */
+
+class RecordSink : public ResultsSink
+{
+    public:
+        /**
+         * Create a sink for the given output format (the --output option).
+         * @param format "text", "json" or "binary".
+         * @param stream Stream to write records to.
+         * @returns NULL for "text", which goes through the Formatter.
+         * @exception BadOption if the format is unknown.
+         */
+        static RecordSink *create(const std::string& format,
+                                  std::ostream& stream);
+
+        /// Is the given name one create() knows?
+        static bool is_format(const std::string& format);
+
+        virtual ~RecordSink() { }
+
+        /**
+         * Start on the results of a query; each record written from now on
+         * names the given action.
+         */
+        void begin(const std::string& action);
+
+        /// Add a line to the current record, or end it if the line is empty.
+        virtual void write(const QuerySpec& line);
+
+        /// Write out the last record of the query, if it isn't empty.
+        void finish();
+
+    protected:
+        RecordSink(std::ostream& stream)
+            : _stream(stream), _action(), _fields() { }
+
+        typedef std::vector<QuerySpec> fields_type;
+
+        /// Write a single (non-empty) record.
+        virtual void write_record(std::ostream& stream,
+                                  const std::string& action,
+                                  const fields_type& fields) = 0;
+
+    private:
+        std::ostream& _stream;
+        std::string _action;
+        fields_type _fields;
+};
+
+/**
+ * @class JsonSink
+ * @brief One JSON object per line:
+ * {"action":"herd","fields":[{"label":"Herd","value":"netmon"},...]}
+ * "label" is left out of fields that don't have one.
+ */
+
+class JsonSink : public RecordSink
+{
+    public:
+        JsonSink(std::ostream& stream) : RecordSink(stream) { }
+
+    protected:
+        virtual void write_record(std::ostream& stream,
+                                  const std::string& action,
+                                  const fields_type& fields);
+};
+
+/**
+ * @class BinarySink
+ * @brief Length-prefixed records.  Every integer is an unsigned 32-bit
+ * little-endian one, and every string is its length followed by its bytes:
+ *
+ * record length (bytes that follow), action, number of fields, then the
+ * label and value of each field.
+ */
+
+class BinarySink : public RecordSink
+{
+    public:
+        BinarySink(std::ostream& stream) : RecordSink(stream) { }
+
+    protected:
+        virtual void write_record(std::ostream& stream,
+                                  const std::string& action,
+                                  const fields_type& fields);
+};
+
+#endif /* _HAVE_RECORD_SINK_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,82 @@
+/*
+ * herdstat -- src/session.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+
+#ifndef _HAVE_SRC_SESSION_HH
+#define _HAVE_SRC_SESSION_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <herdstat/noncopyable.hh>
+
+/**
+ * @class Session
+ * @brief Counts the queries run by this process.
+ *
+ * The package and metadata caches and the parsed XML documents are loaded
+ * once and kept for as long as the process runs.  Front-ends that run more
+ * than one query (batch, readline, daemon) call begin_query() before each
+ * one; the first time a cache is used in a query it revalidates itself
+ * (by stat'ing its sources) and only reloads if something changed.
+ *
+ * Queries running concurrently (see QueryContext) all belong to the same
+ * session query; begin_query() mustn't be called while any of them run.
+ */
+
+class Session : private herdstat::Noncopyable
+{
+    public:
+        /// Start a new query.
+        void begin_query() { ++_query; }
+
+        /**
+         * Has a cache already been revalidated during this query?  If not,
+         * it's marked as such, and the caller should revalidate it.
+         * @param checked Query the cache was last revalidated in.
+         */
+        bool checked(unsigned long *checked) const
+        {
+            if (*checked == _query)
+                return true;
+            *checked = _query;
+            return false;
+        }
+
+    private:
+        friend Session& GlobalSession();
+        Session() : _query(1) { }
+
+        unsigned long _query;
+};
+
+inline Session&
+GlobalSession()
+{
+    static Session s;
+    return s;
+}
+
+#endif /* _HAVE_SRC_SESSION_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
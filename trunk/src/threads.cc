@@ -0,0 +1,84 @@
+/*
+ * herdstat -- src/threads.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cassert>
+#include <unistd.h>
+
+#include "exceptions.hh"
+#include "threads.hh"
+
+Thread::Thread()
+    : _thread(), _started(false)
+{
+}
+
+Thread::~Thread()
+{
+    /* derivatives must join() before they're destroyed; by the time we get
+     * here run() would be calling into a half-destroyed object. */
+    assert(not _started);
+}
+
+void *
+Thread::entry(void *arg)
+{
+    static_cast<Thread *>(arg)->run();
+    return NULL;
+}
+
+void
+Thread::start()
+{
+    assert(not _started);
+
+    if (pthread_create(&_thread, NULL, &Thread::entry, this) != 0)
+        throw herdstat::ErrnoException("pthread_create");
+
+    _started = true;
+}
+
+void
+Thread::join()
+{
+    if (not _started)
+        return;
+
+    pthread_join(_thread, NULL);
+    _started = false;
+}
+
+unsigned
+available_cpus()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n > 0)
+        return static_cast<unsigned>(n);
+#endif
+    return 1;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
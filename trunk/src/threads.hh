@@ -0,0 +1,231 @@
+/*
+ * herdstat -- src/threads.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_THREADS_HH
+#define _HAVE_SRC_THREADS_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vector>
+#include <memory>
+#include <pthread.h>
+#include <herdstat/noncopyable.hh>
+
+/**
+ * @class Mutex
+ * @brief Thin wrapper around pthread_mutex_t.
+ */
+
+class Mutex : private herdstat::Noncopyable
+{
+    public:
+        Mutex() { pthread_mutex_init(&_mutex, NULL); }
+        ~Mutex() { pthread_mutex_destroy(&_mutex); }
+
+        void lock() { pthread_mutex_lock(&_mutex); }
+        void unlock() { pthread_mutex_unlock(&_mutex); }
+
+    private:
+        friend class Condition;
+        pthread_mutex_t _mutex;
+};
+
+/**
+ * @class MutexLock
+ * @brief Locks a Mutex for the lifetime of the object.
+ */
+
+class MutexLock : private herdstat::Noncopyable
+{
+    public:
+        explicit MutexLock(Mutex& m) : _mutex(m) { _mutex.lock(); }
+        ~MutexLock() { _mutex.unlock(); }
+
+    private:
+        Mutex& _mutex;
+};
+
+/**
+ * @class Condition
+ * @brief Thin wrapper around pthread_cond_t.
+ */
+
+class Condition : private herdstat::Noncopyable
+{
+    public:
+        Condition() { pthread_cond_init(&_cond, NULL); }
+        ~Condition() { pthread_cond_destroy(&_cond); }
+
+        /// Wait for a signal.  The mutex must be locked by the caller.
+        void wait(Mutex& m) { pthread_cond_wait(&_cond, &m._mutex); }
+        void signal() { pthread_cond_signal(&_cond); }
+        void broadcast() { pthread_cond_broadcast(&_cond); }
+
+    private:
+        pthread_cond_t _cond;
+};
+
+/**
+ * @class ThreadSpecific
+ * @brief Thin wrapper around pthread_key_t; holds a pointer per thread.
+ */
+
+template <typename T>
+class ThreadSpecific : private herdstat::Noncopyable
+{
+    public:
+        ThreadSpecific() { pthread_key_create(&_key, NULL); }
+        ~ThreadSpecific() { pthread_key_delete(_key); }
+
+        /// Get the calling thread's pointer (NULL if never set).
+        T *get() const { return static_cast<T *>(pthread_getspecific(_key)); }
+        /// Set the calling thread's pointer.
+        void set(T *p) { pthread_setspecific(_key, p); }
+
+    private:
+        pthread_key_t _key;
+};
+
+/**
+ * @class Thread
+ * @brief Base class for a joinable thread.  Derivatives implement run().
+ */
+
+class Thread : private herdstat::Noncopyable
+{
+    public:
+        virtual ~Thread();
+
+        /// Start executing run() in a new thread.
+        void start();
+        /// Wait for run() to finish.
+        void join();
+
+    protected:
+        Thread();
+
+        /// Thread body.
+        virtual void run() = 0;
+
+    private:
+        static void *entry(void *arg);
+
+        pthread_t _thread;
+        bool _started;
+};
+
+/**
+ * Number of threads to use when the user asked for "auto" (0).
+ * @returns number of online processors (at least 1).
+ */
+unsigned available_cpus();
+
+/**
+ * @class ThreadGroup
+ * @brief Owns a group of heap-allocated threads, joining and deleting them
+ * when it's destroyed.
+ */
+
+template <typename T>
+class ThreadGroup : private herdstat::Noncopyable
+{
+    public:
+        typedef typename std::vector<T *>::iterator iterator;
+
+        ThreadGroup() : _threads() { }
+        ~ThreadGroup()
+        {
+            for (iterator i = _threads.begin() ; i != _threads.end() ; ++i)
+            {
+                (*i)->join();
+                delete *i;
+            }
+        }
+
+        /// Take ownership of a thread.
+        void add(T *thread)
+        {
+            std::auto_ptr<T> p(thread);
+            _threads.push_back(thread);
+            p.release();
+        }
+
+        iterator begin() { return _threads.begin(); }
+        iterator end() { return _threads.end(); }
+
+    private:
+        std::vector<T *> _threads;
+};
+
+/**
+ * Start a group of threads.  If one of them can't be started, those that
+ * were are joined before the exception is rethrown.
+ * @param first,last range of Thread pointers.
+ */
+template <typename InputIterator>
+void
+start_threads(InputIterator first, InputIterator last)
+{
+    InputIterator i;
+    try
+    {
+        for (i = first ; i != last ; ++i)
+            (*i)->start();
+    }
+    catch (...)
+    {
+        /* join() does nothing for those that never started */
+        for (i = first ; i != last ; ++i)
+            (*i)->join();
+        throw;
+    }
+}
+
+/**
+ * Join a group of threads.
+ * @param first,last range of Thread pointers.
+ */
+template <typename InputIterator>
+void
+join_threads(InputIterator first, InputIterator last)
+{
+    for (InputIterator i = first ; i != last ; ++i)
+        (*i)->join();
+}
+
+/**
+ * Start and join a group of threads (see start_threads).
+ * @param first,last range of Thread pointers.
+ */
+template <typename InputIterator>
+void
+run_threads(InputIterator first, InputIterator last)
+{
+    start_threads(first, last);
+    join_threads(first, last);
+}
+
+#endif /* _HAVE_SRC_THREADS_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
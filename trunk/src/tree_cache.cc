@@ -0,0 +1,165 @@
+/*
+ * herdstat -- src/tree_cache.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include <herdstat/util/file.hh>
+#include <herdstat/util/string.hh>
+
+#include "common.hh"
+#include "mapped_file.hh"
+#include "md5.hh"
+#include "profiler.hh"
+#include "tree_cache.hh"
+
+#define MD5CACHE            "/metadata/md5-cache/"
+#define FLATCACHE           "/metadata/cache/"
+
+using namespace herdstat;
+using namespace herdstat::portage;
+
+/*
+ * metadata/cache entries have one variable per line, in this order (we only
+ * need a few of them).
+ */
+
+static const struct { std::size_t line; const char * const name; }
+flat_vars[] = {
+    { 5, "HOMEPAGE" },
+    { 6, "LICENSE" },
+    { 7, "DESCRIPTION" },
+    { 8, "KEYWORDS" }
+};
+
+#define NFLAT_VARS          (sizeof(flat_vars) / sizeof(flat_vars[0]))
+
+/* split ebuild's path into its repository and its cat/pvr */
+static bool
+split_ebuild_path(const std::string& ebuild, std::string *repo,
+                  std::string *cpv)
+{
+    const std::string::size_type suffix = ebuild.rfind(".ebuild");
+    if (suffix == std::string::npos)
+        return false;
+
+    /* repo/cat/pkg/pvr.ebuild */
+    std::string::size_type pos[3];
+    std::string::size_type end = suffix;
+    for (int n = 0 ; n != 3 ; ++n)
+    {
+        if (end == 0)
+            return false;
+        pos[n] = ebuild.rfind('/', end - 1);
+        if (pos[n] == std::string::npos)
+            return false;
+        end = pos[n];
+    }
+
+    repo->assign(ebuild, 0, pos[2]);
+    cpv->assign(ebuild, pos[2] + 1, pos[1] - pos[2]);
+    cpv->append(ebuild, pos[0] + 1, suffix - pos[0] - 1);
+    return true;
+}
+
+static bool
+read_md5_cache(const std::string& ebuild, const std::string& entry,
+               Ebuild *vars)
+{
+    MappedFile file;
+    if (not file.open(entry))
+        return false;
+
+    const char *p = file.data();
+    const char * const end = p + file.size();
+
+    Ebuild tmp;
+    std::string md5;
+    while (p < end)
+    {
+        const char *eol = std::find(p, end, '\n');
+        const char *eq = std::find(p, eol, '=');
+        if (eq != eol)
+        {
+            const std::string key(p, eq);
+            if (key == "_md5_")
+                md5.assign(eq + 1, eol);
+            else
+                tmp[key].assign(eq + 1, eol);
+        }
+        p = eol + 1;
+    }
+
+    MappedFile data;
+    if (md5.empty() or not data.open(ebuild) or
+        (md5_hex(data.data(), data.size()) != md5))
+        return false;
+
+    for (std::size_t n = 0 ; n != NFLAT_VARS ; ++n)
+        (*vars)[flat_vars[n].name] = tmp[flat_vars[n].name];
+
+    return true;
+}
+
+static bool
+read_flat_cache(const std::string& ebuild, const std::string& entry,
+                Ebuild *vars)
+{
+    /* portage gives each entry the mtime of its ebuild */
+    profile_count(Profiler::STATS, 2);
+    const util::Stat st(entry);
+    if (not st.exists() or (st.mtime() != util::Stat(ebuild).mtime()))
+        return false;
+
+    MappedFile file;
+    if (not file.open(entry))
+        return false;
+
+    std::vector<std::string> lines;
+    util::split(std::string(file.data(), file.size()),
+                std::back_inserter(lines), "\n", true);
+
+    for (std::size_t n = 0 ; n != NFLAT_VARS ; ++n)
+        (*vars)[flat_vars[n].name] = (flat_vars[n].line < lines.size() ?
+                lines[flat_vars[n].line] : std::string());
+
+    return true;
+}
+
+bool
+read_tree_cache(const std::string& ebuild, Ebuild *vars)
+{
+    std::string repo, cpv;
+    if (not split_ebuild_path(ebuild, &repo, &cpv))
+        return false;
+
+    if (read_md5_cache(ebuild, repo+MD5CACHE+cpv, vars))
+        return true;
+
+    return read_flat_cache(ebuild, repo+FLATCACHE+cpv, vars);
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
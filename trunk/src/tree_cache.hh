@@ -0,0 +1,50 @@
+/*
+ * herdstat -- src/tree_cache.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_TREE_CACHE_HH
+#define _HAVE_SRC_TREE_CACHE_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <herdstat/portage/ebuild.hh>
+
+/**
+ * Read an ebuild's variables from the metadata cache its repository ships
+ * with: metadata/md5-cache, or metadata/cache in older trees.  The entries
+ * are already flattened (eclasses and all), so this is both quicker and
+ * more accurate than reading the ebuild itself.
+ *
+ * @param ebuild Path to ebuild.
+ * @param vars Ebuild to assign the entry's variables to.
+ * @returns false if there's no entry or it's out of date: md5-cache entries
+ * are checked against the ebuild's MD5 sum, metadata/cache entries against
+ * its mtime.
+ */
+bool read_tree_cache(const std::string& ebuild,
+                     herdstat::portage::Ebuild *vars);
+
+#endif /* _HAVE_SRC_TREE_CACHE_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,292 @@
+/*
+ * herdstat -- src/trigram.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cctype>
+#include <cstring>
+#include <algorithm>
+
+#include "trigram.hh"
+
+typedef std::string::size_type size_type;
+
+static inline char
+fold(char c)
+{
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static void
+add_trigrams(const std::string& s, std::vector<std::string> *v)
+{
+    for (size_type i = 0 ; (i + 3) <= s.size() ; ++i)
+    {
+        std::string t(s, i, 3);
+        std::transform(t.begin(), t.end(), t.begin(), fold);
+        v->push_back(t);
+    }
+}
+
+static void
+sort_unique(std::vector<std::string> *v)
+{
+    std::sort(v->begin(), v->end());
+    v->erase(std::unique(v->begin(), v->end()), v->end());
+}
+
+void
+trigrams(const std::string& s, std::vector<std::string> *v)
+{
+    v->clear();
+    add_trigrams(s, v);
+    sort_unique(v);
+}
+
+/*
+ * Skip the bracket expression starting at s[i] ('[').  Returns the
+ * position after it, or npos if it isn't terminated.
+ */
+
+static size_type
+skip_bracket(const std::string& s, size_type i)
+{
+    ++i;
+    if ((i < s.size()) and (s[i] == '^'))
+        ++i;
+    /* a leading ']' is part of the list */
+    if ((i < s.size()) and (s[i] == ']'))
+        ++i;
+
+    while (i < s.size())
+    {
+        if (s[i] == ']')
+            return (i + 1);
+
+        /* [:class:], [.coll.] and [=equiv=] may contain ']' */
+        if ((s[i] == '[') and ((i + 1) < s.size()) and
+            std::strchr(":.=", s[i+1]))
+        {
+            const char end[] = { s[i+1], ']', '\0' };
+            const size_type pos = s.find(end, i + 2);
+            if (pos == std::string::npos)
+                return std::string::npos;
+            i = pos + 2;
+        }
+        else
+            ++i;
+    }
+
+    return std::string::npos;
+}
+
+/*
+ * Skip the group starting at s[i] ('(', or "\(" in a basic regex).  Returns
+ * the position after it, or npos if it isn't terminated.
+ */
+
+static size_type
+skip_group(const std::string& s, size_type i, bool extended)
+{
+    int depth = 0;
+    while (i < s.size())
+    {
+        if (s[i] == '[')
+        {
+            if ((i = skip_bracket(s, i)) == std::string::npos)
+                return i;
+            continue;
+        }
+
+        if (s[i] == '\\')
+        {
+            if ((i + 1) == s.size())
+                return std::string::npos;
+            if (not extended and (s[i+1] == '('))
+                ++depth;
+            else if (not extended and (s[i+1] == ')') and (--depth == 0))
+                return (i + 2);
+            i += 2;
+            continue;
+        }
+
+        if (extended and (s[i] == '('))
+            ++depth;
+        else if (extended and (s[i] == ')') and (--depth == 0))
+            return (i + 1);
+        ++i;
+    }
+
+    return std::string::npos;
+}
+
+/*
+ * Walk the top level of the regex, collecting runs of consecutive literals.
+ * Anything that isn't a literal (., bracket expressions, anchors, groups,
+ * escapes like \w) ends the current run, and a literal followed by *, ? or
+ * an interval is optional so it's dropped from the run.  Groups are
+ * skipped entirely rather than analysed.  A top level alternation means
+ * nothing is required at all.
+ */
+
+bool
+regex_trigrams(const std::string& regex, bool extended,
+               std::vector<std::string> *v)
+{
+    v->clear();
+
+    std::vector<std::string> runs;
+    std::string run;
+    /* is the last character of run the last atom we saw? */
+    bool literal = false;
+
+    size_type i = 0;
+    while (i < regex.size())
+    {
+        const size_type start = i;
+        char c = regex[i++];
+        bool special;
+
+        if (c == '\\')
+        {
+            if (i == regex.size())
+                return false;
+
+            c = regex[i++];
+            special = (not extended and std::strchr("(){}|+?", c));
+
+            /* \w, \b, back-references and the like */
+            if (not special and std::isalnum(static_cast<unsigned char>(c)))
+            {
+                runs.push_back(run);
+                run.clear();
+                literal = false;
+                continue;
+            }
+        }
+        else if (extended)
+            special = std::strchr("(){}|+?*.[^$", c);
+        else
+            special = std::strchr("*.[^$", c);
+
+        if (not special)
+        {
+            run += c;
+            literal = true;
+            continue;
+        }
+
+        switch (c)
+        {
+            case '|':
+                return false;
+            case ')':
+            case '}':
+                /* unbalanced; let the regex library deal with it */
+                return false;
+            case '(':
+                if ((i = skip_group(regex, start, extended)) ==
+                        std::string::npos)
+                    return false;
+                break;
+            case '[':
+                if ((i = skip_bracket(regex, start)) == std::string::npos)
+                    return false;
+                break;
+            case '{':
+                if ((i = regex.find(extended ? "}" : "\\}", i)) ==
+                        std::string::npos)
+                    return false;
+                i += (extended ? 1 : 2);
+                /* FALLTHROUGH */
+            case '*':
+            case '?':
+                if (literal)
+                    run.erase(run.size() - 1);
+                break;
+            default:
+                /* + (the literal before it is still required), ., ^, $ */
+                break;
+        }
+
+        runs.push_back(run);
+        run.clear();
+        literal = false;
+    }
+
+    runs.push_back(run);
+
+    std::vector<std::string>::iterator r;
+    for (r = runs.begin() ; r != runs.end() ; ++r)
+        add_trigrams(*r, v);
+    sort_unique(v);
+
+    return (not v->empty());
+}
+
+/*
+ * Only letters, digits, '-' and '_' are taken as literals in the category,
+ * and the '/' mustn't be followed by anything that makes it optional.  Any
+ * '|' gives up, as a top level alternation could match outside of it.
+ */
+
+bool
+regex_category(const std::string& regex, bool extended, std::string *category)
+{
+    category->clear();
+
+    if ((regex.size() < 3) or (regex[0] != '^') or
+        (regex.find('|') != std::string::npos))
+        return false;
+
+    const size_type slash = regex.find('/');
+    if ((slash == std::string::npos) or (slash == 1))
+        return false;
+
+    for (size_type i = 1 ; i != slash ; ++i)
+    {
+        const char c = regex[i];
+        if (not std::isalnum(static_cast<unsigned char>(c)) and
+            (c != '-') and (c != '_'))
+            return false;
+    }
+
+    const size_type next = slash + 1;
+    if (next < regex.size())
+    {
+        const char c = regex[next];
+        if ((c == '*') or (extended and std::strchr("?{", c)))
+            return false;
+        if (not extended and (c == '\\') and ((next + 1) < regex.size()) and
+            std::strchr("?{", regex[next + 1]))
+            return false;
+    }
+
+    category->assign(regex, 1, slash - 1);
+    std::transform(category->begin(), category->end(), category->begin(),
+                   fold);
+    return true;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -0,0 +1,70 @@
+/*
+ * herdstat -- src/trigram.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_TRIGRAM_HH
+#define _HAVE_SRC_TRIGRAM_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+
+/**
+ * Get the trigrams (every run of three characters) of a string, folded to
+ * lower case.
+ * @param s String.
+ * @param trigrams Vector to store them in (sorted, without duplicates).
+ */
+void trigrams(const std::string& s, std::vector<std::string> *trigrams);
+
+/**
+ * Get trigrams that any string matched by a regular expression has to
+ * contain (folded to lower case, so it holds for case insensitive matching
+ * too).  Only literals that are required at the top level of the regex are
+ * considered, so the trigrams are a necessary, not sufficient, condition.
+ * @param regex POSIX regular expression.
+ * @param extended Is regex an extended regular expression?
+ * @param trigrams Vector to store them in (sorted, without duplicates).
+ * @returns false if no trigrams could be extracted (e.g. the regex is an
+ * alternation, or has no literals of at least three characters), in which
+ * case everything has to be searched.
+ */
+bool regex_trigrams(const std::string& regex, bool extended,
+                    std::vector<std::string> *trigrams);
+
+/**
+ * Get the category a regular expression is anchored to, if any: one that
+ * starts with ^, a literal category and a '/' can only match packages in
+ * that category.
+ * @param regex POSIX regular expression.
+ * @param extended Is regex an extended regular expression?
+ * @param category String to store the category in (folded to lower case).
+ * @returns false if the regex isn't anchored to a category.
+ */
+bool regex_category(const std::string& regex, bool extended,
+                    std::string *category);
+
+#endif /* _HAVE_SRC_TRIGRAM_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
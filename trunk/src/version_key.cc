@@ -0,0 +1,237 @@
+/*
+ * herdstat -- src/version_key.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <cctype>
+
+#include "version_key.hh"
+
+/*
+ * Keys are made up of these parts, in order:
+ *
+ *   numeric components  COMPONENT_NUMBER int, or COMPONENT_STRING digits 0x00
+ *                       for each component, then END_COMPONENTS
+ *   letter              the letter, or 0x00 if there is none
+ *   suffixes            suffix rank int for each suffix, then END_SUFFIXES
+ *   revision            int
+ *
+ * where int is a byte holding the number of digits (leading zeros stripped)
+ * followed by the digits, so that longer means bigger.  Components after the
+ * first that start with a '0' are compared as strings (with trailing zeros
+ * stripped) and always sort before those that don't, so they're tagged
+ * differently.  Since both keys are in the same part at the first byte they
+ * differ in, a byte comparison compares whichever part that is.
+ */
+
+#define END_COMPONENTS      '\001'
+#define COMPONENT_STRING    '\002'
+#define COMPONENT_NUMBER    '\003'
+
+/* suffix ranks; no (more) suffixes sorts between _rc and _p */
+#define SUFFIX_ALPHA        '\001'
+#define SUFFIX_BETA         '\002'
+#define SUFFIX_PRE          '\003'
+#define SUFFIX_RC           '\004'
+#define END_SUFFIXES        '\005'
+#define SUFFIX_P            '\006'
+
+/* invalid versions sort after every valid one */
+#define INVALID             '\377'
+
+static const struct { const char * const name; char rank; } suffixes[] = {
+    { "alpha",  SUFFIX_ALPHA },
+    { "beta",   SUFFIX_BETA },
+    { "pre",    SUFFIX_PRE },
+    { "rc",     SUFFIX_RC },
+    { "p",      SUFFIX_P }
+};
+
+#define NSUFFIXES           (sizeof(suffixes) / sizeof(suffixes[0]))
+
+static inline bool
+is_digit(char c)
+{
+    return std::isdigit(static_cast<unsigned char>(c));
+}
+
+/* append the digits in [begin, end) as an int */
+static void
+append_int(std::string::const_iterator begin,
+           std::string::const_iterator end, std::string *key)
+{
+    while ((begin != end) and (*begin == '0'))
+        ++begin;
+
+    key->push_back(static_cast<char>(end - begin));
+    key->append(begin, end);
+}
+
+/* parse a run of digits at pos */
+static bool
+digits(const std::string& s, std::string::size_type *pos,
+       std::string::const_iterator *begin, std::string::const_iterator *end)
+{
+    std::string::size_type p = *pos;
+    while ((p != s.size()) and is_digit(s[p]))
+        ++p;
+
+    if (p == *pos)
+        return false;
+
+    *begin = s.begin() + *pos;
+    *end = s.begin() + p;
+    *pos = p;
+    return true;
+}
+
+static bool
+encode(const std::string& version, std::string *key)
+{
+    std::string::size_type pos = 0;
+    std::string::const_iterator begin, end;
+
+    /* numeric components */
+    if (not digits(version, &pos, &begin, &end))
+        return false;
+    /* the first is always a number */
+    key->push_back(COMPONENT_NUMBER);
+    append_int(begin, end, key);
+
+    while ((pos != version.size()) and (version[pos] == '.'))
+    {
+        ++pos;
+        if (not digits(version, &pos, &begin, &end))
+            return false;
+
+        if (*begin == '0')
+        {
+            while ((end != begin) and (*(end - 1) == '0'))
+                --end;
+            key->push_back(COMPONENT_STRING);
+            key->append(begin, end);
+            key->push_back('\0');
+        }
+        else
+        {
+            key->push_back(COMPONENT_NUMBER);
+            append_int(begin, end, key);
+        }
+    }
+    key->push_back(END_COMPONENTS);
+
+    /* letter */
+    if ((pos != version.size()) and std::islower(
+            static_cast<unsigned char>(version[pos])))
+        key->push_back(version[pos++]);
+    else
+        key->push_back('\0');
+
+    /* suffixes */
+    while ((pos != version.size()) and (version[pos] == '_'))
+    {
+        ++pos;
+
+        std::size_t n;
+        for (n = 0 ; n != NSUFFIXES ; ++n)
+        {
+            const std::string::size_type len =
+                std::char_traits<char>::length(suffixes[n].name);
+            if (version.compare(pos, len, suffixes[n].name) == 0)
+            {
+                /* "p" is a prefix of "pre" */
+                if ((pos + len != version.size()) and
+                    std::islower(static_cast<unsigned char>(version[pos + len])))
+                    continue;
+
+                pos += len;
+                break;
+            }
+        }
+
+        if (n == NSUFFIXES)
+            return false;
+
+        key->push_back(suffixes[n].rank);
+        if (digits(version, &pos, &begin, &end))
+            append_int(begin, end, key);
+        else
+            key->push_back('\0');
+    }
+    key->push_back(END_SUFFIXES);
+
+    /* revision */
+    if (pos == version.size())
+    {
+        key->push_back('\0');
+        return true;
+    }
+
+    if (version.compare(pos, 2, "-r") != 0)
+        return false;
+
+    pos += 2;
+    if (not digits(version, &pos, &begin, &end) or (pos != version.size()))
+        return false;
+
+    append_int(begin, end, key);
+    return true;
+}
+
+bool
+version_key(const std::string& version, std::string *key)
+{
+    key->clear();
+    key->reserve(version.size() + 8);
+
+    if (encode(version, key))
+        return true;
+
+    key->assign(1, INVALID);
+    key->append(version);
+    return false;
+}
+
+bool
+ebuild_version_key(const std::string& pkg, const std::string& ebuild,
+                   std::string *key)
+{
+    static const std::string suffix(".ebuild");
+
+    if ((ebuild.size() <= (pkg.size() + 1 + suffix.size())) or
+        (ebuild.compare(0, pkg.size(), pkg) != 0) or
+        (ebuild[pkg.size()] != '-') or
+        (ebuild.compare(ebuild.size() - suffix.size(),
+                        suffix.size(), suffix) != 0))
+    {
+        key->assign(1, INVALID);
+        key->append(ebuild);
+        return false;
+    }
+
+    return version_key(ebuild.substr(pkg.size() + 1,
+                ebuild.size() - pkg.size() - 1 - suffix.size()), key);
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
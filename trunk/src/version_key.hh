@@ -0,0 +1,59 @@
+/*
+ * herdstat -- src/version_key.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_VERSION_KEY_HH
+#define _HAVE_SRC_VERSION_KEY_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string>
+
+/**
+ * Encode a version into a sort key, so that comparing two keys byte by byte
+ * (std::string::compare, memcmp) gives the same order as comparing the
+ * versions themselves, without having to tokenize them again on every
+ * comparison.
+ *
+ * @param version Version, including any suffixes and revision (e.g.
+ * 1.2.3b_pre4_p1-r2).
+ * @param key String to store the key in.
+ * @returns false if version isn't a valid version.  key is then set to
+ * something that sorts after every valid version (and by version string
+ * among the invalid ones), so callers needn't treat them specially.
+ */
+bool version_key(const std::string& version, std::string *key);
+
+/**
+ * Encode the version of an ebuild.
+ * @param pkg Package name.
+ * @param ebuild Ebuild file name (<pkg>-<version>.ebuild).
+ * @param key String to store the key in.
+ * @returns false if the file name isn't a valid ebuild name for pkg.
+ */
+bool ebuild_version_key(const std::string& pkg, const std::string& ebuild,
+                        std::string *key);
+
+#endif /* _HAVE_SRC_VERSION_KEY_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
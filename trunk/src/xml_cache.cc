@@ -0,0 +1,449 @@
+/*
+ * herdstat -- src/xml_cache.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <memory>
+#include <herdstat/exceptions.hh>
+#include <herdstat/util/file.hh>
+#include <herdstat/util/string.hh>
+
+#include "common.hh"
+#include "hash_map.hh"
+#include "mapped_file.hh"
+#include "session.hh"
+#include "threads.hh"
+#include "xml_cache.hh"
+
+#define HERDSXML_CACHE      /*LOCALSTATEDIR*/"/herdsxml.cache"
+#define DEVAWAYXML_CACHE    /*LOCALSTATEDIR*/"/devawayxml.cache"
+#define USERINFOXML_CACHE   /*LOCALSTATEDIR*/"/userinfoxml.cache"
+
+/* tables besides the developer records (table 0) */
+#define HERDS_TABLE         1
+#define KEY_TABLE           2
+
+#define HERD_FIELDS         3
+#define DEVELOPER_FIELDS    13
+#define KEY_FIELDS          4
+
+using namespace herdstat;
+using namespace herdstat::portage;
+
+XMLCache::XMLCache(const std::string& name, const std::string& source,
+                   const std::string& location)
+    : Cache(GlobalOptions().localstatedir()+name),
+      _source(source), _location(location),
+      _source_key(), _have_source_key(false)
+{
+}
+
+std::size_t
+XMLCache::record_fields() const
+{
+    return DEVELOPER_FIELDS;
+}
+
+bool
+XMLCache::do_is_valid()
+{
+    profile_count(Profiler::STATS);
+    return util::is_file(_source);
+}
+
+bool
+XMLCache::do_is_current()
+{
+    /* nothing to compare against (e.g. a remote userinfo.xml) */
+    if (not _have_source_key)
+        return true;
+
+    Key key;
+    return (this->source_key(&key, false) and
+            (key.mtime == _source_key.mtime) and (key.size == _source_key.size));
+}
+
+bool
+XMLCache::source_key(Key *key, bool with_hash) const
+{
+    profile_count(Profiler::STATS);
+    const util::Stat st(_source);
+    if (not st.exists())
+        return false;
+
+    key->mtime = st.mtime();
+    key->size = st.size();
+
+    if (with_hash)
+    {
+        try
+        {
+            MappedFile file(_source);
+            key->hash = hash64(file.data(), file.size());
+        }
+        catch (const FileException&)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+XMLCache::do_check(const CacheFileReader& file)
+{
+    if (file.tables() <= KEY_TABLE)
+        return false;
+
+    const CacheTable& table(file.table(KEY_TABLE));
+    if (table.size() != 1 or table.fields() != KEY_FIELDS)
+        return false;
+
+    if (table.field(0, 0) != _source)
+        return false;
+
+    /* cheap checks first; only hash the document if they pass */
+    Key key;
+    if (not this->source_key(&key, false))
+        return false;
+
+    if (table.field(0, 1) != util::stringify(key.mtime) or
+        table.field(0, 2) != util::stringify(key.size))
+        return false;
+
+    if (not this->source_key(&key, true))
+        return false;
+
+    return (table.field(0, 3) == util::stringify(key.hash));
+}
+
+void
+XMLCache::update()
+{
+    TraceContext c("XMLCache::update("+_source+")");
+
+    _have_source_key = this->source_key(&_source_key, false);
+
+    if (this->is_valid())
+    {
+        this->load();
+        return;
+    }
+
+    this->fill();
+
+    /* nothing to key a snapshot on (e.g. a remote userinfo.xml) */
+    profile_count(Profiler::STATS);
+    if (not util::is_file(_source))
+        return;
+
+    /* not being able to save the snapshot only costs us the next parse */
+    try
+    {
+        this->dump();
+    }
+    catch (const FileException& e)
+    {
+        debug_msg("failed to save the %s cache: %s", this->name(), e.what());
+    }
+}
+
+void
+XMLCache::do_load(const CacheFileReader& file)
+{
+    this->decode(file.table(HERDS_TABLE), file.table(0));
+}
+
+void
+XMLCache::do_dump(CacheFileWriter& file)
+{
+    records_type herds, devs;
+    this->encode(&herds, &devs);
+
+    records_type::iterator i;
+    for (i = devs.begin() ; i != devs.end() ; ++i)
+        file.add(*i);
+
+    const std::size_t herds_table = file.add_table(HERD_FIELDS);
+    for (i = herds.begin() ; i != herds.end() ; ++i)
+        file.add(herds_table, *i);
+
+    /* key the snapshot on the document it was made from */
+    Key key;
+    this->source_key(&key, true);
+
+    record_type record;
+    record.push_back(_source);
+    record.push_back(util::stringify(key.mtime));
+    record.push_back(util::stringify(key.size));
+    record.push_back(util::stringify(key.hash));
+
+    const std::size_t key_table = file.add_table(KEY_FIELDS);
+    file.add(key_table, record);
+}
+
+void
+XMLCache::dump_text(std::ostream& stream)
+{
+    records_type herds, devs;
+    this->encode(&herds, &devs);
+
+    records_type::iterator i;
+    for (i = herds.begin() ; i != herds.end() ; ++i)
+        stream << util::join(i->begin(), i->end(), ":") << std::endl;
+    for (i = devs.begin() ; i != devs.end() ; ++i)
+        stream << util::join(i->begin(), i->end(), ":") << std::endl;
+}
+
+void
+XMLCache::encode_herd(const Herd& herd, record_type *record)
+{
+    record->push_back(herd.name());
+    record->push_back(herd.email());
+    record->push_back(herd.desc());
+}
+
+void
+XMLCache::decode_herd(const CacheTable& table, std::size_t n, Herd *herd)
+{
+    herd->set_name(table.field(n, 0).str());
+    herd->set_email(table.field(n, 1).str());
+    herd->set_desc(table.field(n, 2).str());
+}
+
+void
+XMLCache::encode_developer(const Developer& dev, const std::string& owner,
+                           record_type *record)
+{
+    record->push_back(owner);
+    record->push_back(dev.user());
+    record->push_back(dev.email());
+    record->push_back(dev.name());
+    record->push_back(dev.pgpkey());
+    record->push_back(dev.joined());
+    record->push_back(dev.birthday());
+    record->push_back(dev.status());
+    record->push_back(dev.role());
+    record->push_back(dev.location());
+    record->push_back(dev.awaymsg());
+    record->push_back(dev.is_away() ? "1" : "");
+    record->push_back(util::join(dev.herds().begin(),
+                                 dev.herds().end(), ","));
+}
+
+std::string
+XMLCache::developer_owner(const CacheTable& table, std::size_t n)
+{
+    return table.field(n, 0).str();
+}
+
+void
+XMLCache::decode_developer(const CacheTable& table, std::size_t n,
+                           Developer *dev)
+{
+    dev->set_user(table.field(n, 1).str());
+    dev->set_email(table.field(n, 2).str());
+    dev->set_name(table.field(n, 3).str());
+    dev->set_pgpkey(table.field(n, 4).str());
+    dev->set_joined(table.field(n, 5).str());
+    dev->set_birthday(table.field(n, 6).str());
+    dev->set_status(table.field(n, 7).str());
+    dev->set_role(table.field(n, 8).str());
+    dev->set_location(table.field(n, 9).str());
+    dev->set_awaymsg(table.field(n, 10).str());
+    dev->set_away(not table.field(n, 11).empty());
+
+    const CacheField herds(table.field(n, 12));
+    if (not herds.empty())
+    {
+        std::vector<std::string> v;
+        util::split(herds.str(), std::back_inserter(v), ",");
+        dev->set_herds(v);
+    }
+}
+
+HerdsXMLCache::HerdsXMLCache(const std::string& source,
+                             const std::string& location)
+    : XMLCache(HERDSXML_CACHE, source, location), _xml(GlobalHerdsXML())
+{
+}
+
+const char * const
+HerdsXMLCache::name() const
+{
+    return "herds.xml";
+}
+
+std::size_t
+HerdsXMLCache::cache_size() const
+{
+    return _xml.herds().size();
+}
+
+void
+HerdsXMLCache::do_fill()
+{
+    ProfileScope p("xml parse", this->name());
+    profile_count(Profiler::XML_PARSES);
+    _xml.parse(this->location());
+}
+
+void
+HerdsXMLCache::encode(records_type *herds, records_type *devs)
+{
+    const Herds& h(_xml.herds());
+
+    std::size_t n = 0;
+    Herds::const_iterator i;
+    for (i = h.begin() ; i != h.end() ; ++i, ++n)
+    {
+        herds->push_back(record_type());
+        encode_herd(*i, &herds->back());
+
+        /* developers are tagged with the index of the herd they belong to */
+        const std::string owner(util::stringify(n));
+        Herd::const_iterator d;
+        for (d = i->begin() ; d != i->end() ; ++d)
+        {
+            devs->push_back(record_type());
+            encode_developer(*d, owner, &devs->back());
+        }
+    }
+}
+
+void
+HerdsXMLCache::decode(const CacheTable& herds, const CacheTable& devs)
+{
+    std::vector<Herd> v(herds.size());
+    for (std::size_t n = 0 ; n != herds.size() ; ++n)
+        decode_herd(herds, n, &v[n]);
+
+    for (std::size_t n = 0 ; n != devs.size() ; ++n)
+    {
+        const std::size_t owner =
+            util::destringify<std::size_t>(developer_owner(devs, n));
+        if (owner >= v.size())
+            continue;
+
+        Developer dev;
+        decode_developer(devs, n, &dev);
+        v[owner].insert(dev);
+    }
+
+    Herds& h(_xml.herds());
+    h.clear();
+    h.insert(v.begin(), v.end());
+}
+
+static unsigned long generation = 1;
+
+/* serializes the parse_*() functions, for queries running concurrently */
+static Mutex&
+xml_lock()
+{
+    static Mutex m;
+    return m;
+}
+
+unsigned long
+xml_generation()
+{
+    MutexLock l(xml_lock());
+    return generation;
+}
+
+/* (re)load the document behind cache unless it's already been checked
+ * during this query or hasn't changed */
+static void
+refresh(XMLCache& cache, unsigned long *checked)
+{
+    if (GlobalSession().checked(checked))
+        return;
+    if (cache.is_loaded() and cache.is_current())
+        return;
+
+    cache.update();
+    ++generation;
+}
+
+void
+parse_herdsxml()
+{
+    TraceContext c("parse_herdsxml()");
+    MutexLock l(xml_lock());
+    const Options& options(GlobalOptions());
+    static std::auto_ptr<HerdsXMLCache> cache;
+    static unsigned long checked = 0;
+
+    if (not cache.get() or (cache->source() != herdsxml_path()))
+    {
+        cache.reset(new HerdsXMLCache(herdsxml_path(), options.herdsxml()));
+        checked = 0;
+    }
+
+    refresh(*cache, &checked);
+}
+
+void
+parse_devawayxml()
+{
+    TraceContext c("parse_devawayxml()");
+    MutexLock l(xml_lock());
+    const Options& options(GlobalOptions());
+    static std::auto_ptr<DevelopersXMLCache<DevawayXML> > cache;
+    static unsigned long checked = 0;
+
+    if (not cache.get() or (cache->source() != devawayxml_path()))
+    {
+        cache.reset(new DevelopersXMLCache<DevawayXML>("devaway.xml",
+            DEVAWAYXML_CACHE, GlobalDevawayXML(), devawayxml_path(),
+            options.devawayxml()));
+        checked = 0;
+    }
+
+    refresh(*cache, &checked);
+}
+
+void
+parse_userinfoxml()
+{
+    TraceContext c("parse_userinfoxml()");
+    MutexLock l(xml_lock());
+    const Options& options(GlobalOptions());
+    static std::auto_ptr<DevelopersXMLCache<UserinfoXML> > cache;
+    static unsigned long checked = 0;
+
+    if (not cache.get() or (cache->source() != options.userinfoxml()))
+    {
+        cache.reset(new DevelopersXMLCache<UserinfoXML>("userinfo.xml",
+            USERINFOXML_CACHE, GlobalUserinfoXML(), options.userinfoxml(),
+            options.userinfoxml()));
+        checked = 0;
+    }
+
+    refresh(*cache, &checked);
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
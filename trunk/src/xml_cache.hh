@@ -0,0 +1,237 @@
+/*
+ * herdstat -- src/xml_cache.hh
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+#ifndef _HAVE_SRC_XML_CACHE_HH
+#define _HAVE_SRC_XML_CACHE_HH 1
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vector>
+#include <ctime>
+#include <stdint.h>
+#include <herdstat/portage/developer.hh>
+#include <herdstat/portage/herds_xml.hh>
+#include <herdstat/portage/devaway_xml.hh>
+#include <herdstat/portage/userinfo_xml.hh>
+
+#include "cache.hh"
+#include "profiler.hh"
+
+/**
+ * @class XMLCache
+ * @brief Snapshot of a parsed XML document, so it doesn't have to be parsed
+ * again as long as the source file hasn't changed.  The snapshot is keyed
+ * on the source file's path, mtime, size and a hash of its contents.
+ */
+
+class XMLCache : public Cache
+{
+    public:
+        typedef std::vector<std::string> record_type;
+        typedef std::vector<record_type> records_type;
+
+        virtual ~XMLCache() throw() { }
+
+        /**
+         * Load the snapshot if it's current; otherwise parse the source
+         * document and save a new snapshot.
+         */
+        void update();
+
+        virtual void dump_text(std::ostream& stream);
+
+        /// Path to the XML document.
+        const std::string& source() const { return _source; }
+
+    protected:
+        /**
+         * @param name Snapshot file name (relative to localstatedir).
+         * @param source Path to the XML document.
+         * @param location What to hand to the document's parse() (may be
+         * empty to use the parser's default).
+         */
+        XMLCache(const std::string& name, const std::string& source,
+                 const std::string& location);
+
+        const std::string& location() const { return _location; }
+
+        /// Convert the parsed document into herd and developer records.
+        virtual void encode(records_type *herds, records_type *devs) = 0;
+        /// Fill the document from herd and developer records.
+        virtual void decode(const CacheTable& herds,
+                            const CacheTable& devs) = 0;
+
+        /* helpers for derivatives */
+        static void encode_herd(const herdstat::portage::Herd& herd,
+                                record_type *record);
+        static void decode_herd(const CacheTable& table, std::size_t n,
+                                herdstat::portage::Herd *herd);
+        static void encode_developer(const herdstat::portage::Developer& dev,
+                                     const std::string& owner,
+                                     record_type *record);
+        static void decode_developer(const CacheTable& table, std::size_t n,
+                                     herdstat::portage::Developer *dev);
+        /// Owner field of the n'th developer record.
+        static std::string developer_owner(const CacheTable& table,
+                                           std::size_t n);
+
+        virtual std::size_t record_fields() const;
+        /// Snapshots are keyed on their own source file, not the tree.
+        virtual bool uses_tree() const { return false; }
+        virtual bool do_is_valid();
+        /// Has the document's mtime or size changed since we loaded it?
+        virtual bool do_is_current();
+        virtual bool do_check(const CacheFileReader& file);
+        virtual void do_load(const CacheFileReader& file);
+        virtual void do_dump(CacheFileWriter& file);
+
+    private:
+        /* what the snapshot was made from */
+        struct Key
+        {
+            Key() : mtime(0), size(0), hash(0) { }
+
+            std::time_t mtime;
+            unsigned long size;
+            uint64_t hash;
+        };
+
+        bool source_key(Key *key, bool with_hash) const;
+
+        std::string _source;
+        std::string _location;
+        /* the document as of the last update() */
+        Key _source_key;
+        bool _have_source_key;
+};
+
+/**
+ * @class HerdsXMLCache
+ * @brief Snapshot of GlobalHerdsXML().
+ */
+
+class HerdsXMLCache : public XMLCache
+{
+    public:
+        HerdsXMLCache(const std::string& source, const std::string& location);
+        virtual ~HerdsXMLCache() throw() { }
+
+    protected:
+        virtual std::size_t cache_size() const;
+        virtual const char * const name() const;
+        virtual void do_fill();
+        virtual void encode(records_type *herds, records_type *devs);
+        virtual void decode(const CacheTable& herds, const CacheTable& devs);
+
+    private:
+        herdstat::portage::HerdsXML& _xml;
+};
+
+/**
+ * @class DevelopersXMLCache
+ * @brief Snapshot of an XML document that's just a list of developers
+ * (devaway.xml and userinfo.xml).
+ */
+
+template <typename XML>
+class DevelopersXMLCache : public XMLCache
+{
+    public:
+        DevelopersXMLCache(const char * const name, const std::string& cache,
+                           XML& xml, const std::string& source,
+                           const std::string& location)
+            : XMLCache(cache, source, location), _name(name), _xml(xml) { }
+        virtual ~DevelopersXMLCache() throw() { }
+
+    protected:
+        virtual std::size_t cache_size() const { return _xml.devs().size(); }
+        virtual const char * const name() const { return _name; }
+        virtual void do_fill();
+        virtual void encode(records_type *herds, records_type *devs);
+        virtual void decode(const CacheTable& herds, const CacheTable& devs);
+
+    private:
+        const char * const _name;
+        XML& _xml;
+};
+
+template <typename XML>
+void
+DevelopersXMLCache<XML>::do_fill()
+{
+    ProfileScope p("xml parse", _name);
+    profile_count(Profiler::XML_PARSES);
+    _xml.parse(this->location());
+}
+
+template <typename XML>
+void
+DevelopersXMLCache<XML>::encode(records_type *herds LIBHERDSTAT_UNUSED,
+                                records_type *devs)
+{
+    const herdstat::portage::Developers& d(_xml.devs());
+    herdstat::portage::Developers::const_iterator i;
+    for (i = d.begin() ; i != d.end() ; ++i)
+    {
+        devs->push_back(record_type());
+        encode_developer(*i, "", &devs->back());
+    }
+}
+
+template <typename XML>
+void
+DevelopersXMLCache<XML>::decode(const CacheTable& herds LIBHERDSTAT_UNUSED,
+                                const CacheTable& devs)
+{
+    herdstat::portage::Developers& d(_xml.devs());
+    d.clear();
+
+    for (std::size_t n = 0 ; n != devs.size() ; ++n)
+    {
+        herdstat::portage::Developer dev;
+        decode_developer(devs, n, &dev);
+        d.insert(dev);
+    }
+}
+
+/*
+ * Parse (or load the snapshot of) each XML document into its global
+ * instance.  These replace calling Global*XML().parse() directly.  Once a
+ * document is loaded, these only stat it (once per query; see Session) and
+ * don't touch it again unless it changed.
+ */
+
+void parse_herdsxml();
+void parse_devawayxml();
+void parse_userinfoxml();
+
+/**
+ * Generation of the global XML documents; changes each time one of them is
+ * (re)parsed, so anything derived from them knows when to rebuild.
+ */
+unsigned long xml_generation();
+
+#endif /* _HAVE_SRC_XML_CACHE_HH */
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -25,6 +25,7 @@
 #endif
 
 #include "common.hh"
+#include "xml_cache.hh"
 #include "xmlinit.hh"
 
 XMLInit::XMLInit()
@@ -35,12 +36,19 @@ XMLInit::XMLInit()
     fetch_herdsxml();
 
     if (options.devaway())
-    {
         fetch_devawayxml();
-        GlobalDevawayXML().parse(options.devawayxml());
-    }
+}
+
+void
+GlobalXMLInit()
+{
+    static const XMLInit x;
+
+    /* cheap once they've been parsed; see Session */
+    if (GlobalOptions().devaway())
+        parse_devawayxml();
 
-    GlobalHerdsXML().parse(options.herdsxml());
+    parse_herdsxml();
 }
 
 /* vim: set tw=80 sw=4 fdm=marker et : */
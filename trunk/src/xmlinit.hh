@@ -39,11 +39,11 @@ class XMLInit : private herdstat::Noncopyable
         const herdstat::xml::Init& _init;
 };
 
-inline void
-GlobalXMLInit()
-{
-    static const XMLInit x;
-}
+/**
+ * Initialize libxml2 and fetch herds.xml (and devaway.xml) the first time
+ * around, then make sure they're parsed and current.
+ */
+void GlobalXMLInit();
 
 #endif /* _HAVE_SRC_XMLINIT_HH */
 
@@ -0,0 +1,43 @@
+#!/bin/bash
+source common.sh || exit 1
+
+lsd="${TEST_DATA}/localstatedir"
+actual="${srcdir}/actual"
+[[ -d ${actual} ]] || mkdir ${actual}
+
+cat > ${actual}/batch-input <<END
+herd netmon
+pkg fu
+find foo
+which foo
+versions foo
+away all
+dev all
+keywords libfoo
+meta foo
+herd all
+END
+awk '{ print NR " " $0 }' ${actual}/batch-input > ${actual}/batch-input-ids
+
+# the serial front-end is the reference; the workers must match it
+run_batch "" ${actual}/batch-input > ${actual}/batch-serial
+
+ebegin "Testing batch (4 jobs, in order)"
+run_batch "-j4" ${actual}/batch-input > ${actual}/batch-jobs
+diff ${actual}/batch-serial ${actual}/batch-jobs
+rv=$?
+eend ${rv}
+[[ ${rv} == 0 ]] || exit 1
+
+ebegin "Testing batch (4 jobs, request ids)"
+run_batch "--batch-ids" ${actual}/batch-input-ids | unframe \
+    > ${actual}/batch-serial-ids
+run_batch "-j4 --batch-ids" ${actual}/batch-input-ids | unframe \
+    > ${actual}/batch-jobs-ids
+diff ${actual}/batch-serial-ids ${actual}/batch-jobs-ids
+rv=$?
+eend ${rv}
+[[ ${rv} == 0 ]] || exit 1
+
+rm -f ${lsd}/*cache*
+indent
@@ -0,0 +1,106 @@
+/*
+ * herdstat -- tests/bench_run.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+/*
+ * Runs a command and reports what it cost, for benchmark.sh:
+ *
+ *   bench_run <command> [args...]
+ *
+ * The command's output is thrown away; on success, prints its wall time in
+ * milliseconds, its peak resident set size in kilobytes and its exit status,
+ * separated by spaces.  (time(1) can't be relied on for the RSS, and the
+ * shell's own `time' doesn't report it at all.)
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int
+main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: bench_run <command> [args...]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    struct timeval begin, end;
+    ::gettimeofday(&begin, NULL);
+
+    const pid_t pid = ::fork();
+    if (pid == -1)
+    {
+        std::cerr << "bench_run: fork: " << std::strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    else if (pid == 0)
+    {
+        const int null = ::open("/dev/null", O_RDWR);
+        if (null != -1)
+        {
+            ::dup2(null, STDIN_FILENO);
+            ::dup2(null, STDOUT_FILENO);
+            ::dup2(null, STDERR_FILENO);
+        }
+
+        ::execvp(argv[1], argv + 1);
+        ::_exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    while (::wait4(pid, &status, 0, &usage) == -1)
+    {
+        if (errno != EINTR)
+        {
+            std::cerr << "bench_run: wait4: " << std::strerror(errno)
+                << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    ::gettimeofday(&end, NULL);
+
+    const long ms = (end.tv_sec - begin.tv_sec) * 1000 +
+                    (end.tv_usec - begin.tv_usec) / 1000;
+    /* ru_maxrss is in kilobytes on Linux and the BSDs */
+    std::cout << ms << " " << usage.ru_maxrss << " "
+        << (WIFEXITED(status) ? WEXITSTATUS(status)
+                              : 128 + WTERMSIG(status)) << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
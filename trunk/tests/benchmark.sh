@@ -0,0 +1,122 @@
+#!/bin/bash
+# $Id$
+#
+# End-to-end benchmark of every action against synthetic trees made by
+# gen_tree.  Run with `make benchmark'; for each tree size, prints each
+# action's wall time, peak RSS and the number of files it opened, once cold
+# (none of herdstat's caches exist) and once warm (straight after).
+#
+# Settings, from the environment:
+#   BENCH_SIZES       packages in each tree (default: 10000 50000 200000)
+#   BENCH_EBUILDS     average ebuilds per package (default: 3)
+#   BENCH_OVERLAYS    overlays per tree (default: 1)
+#   BENCH_DIR         where the trees go (default: ./bench-trees); they're
+#                     only generated if missing, and the 200000 package one
+#                     takes a few GB
+#   BENCH_DROP_CACHES if set, also drop the OS's page cache before each cold
+#                     run (needs root); otherwise "cold" only means herdstat's
+#                     own caches are gone
+
+HERDSTAT=${HERDSTAT:-../src/herdstat}
+GEN_TREE=${GEN_TREE:-./gen_tree}
+BENCH_RUN=${BENCH_RUN:-./bench_run}
+BENCH_SIZES=${BENCH_SIZES:-10000 50000 200000}
+BENCH_EBUILDS=${BENCH_EBUILDS:-3}
+BENCH_OVERLAYS=${BENCH_OVERLAYS:-1}
+BENCH_DIR=${BENCH_DIR:-$(pwd)/bench-trees}
+
+for prog in ${HERDSTAT} ${GEN_TREE} ${BENCH_RUN} ; do
+    if [[ ! -x ${prog} ]] ; then
+	echo "${0}: ${prog} hasn't been built" 1>&2
+	exit 1
+    fi
+done
+
+# count files opened if strace is around
+have_strace=
+type -p strace &> /dev/null && have_strace=1
+
+# generate a tree of ${1} packages, if it doesn't already exist
+gen_tree() {
+    local size=${1} dir=${BENCH_DIR}/${1}
+    [[ -f ${dir}/queries ]] && return 0
+
+    echo "Generating a ${size} package tree in ${dir}" 1>&2
+    rm -fr ${dir}
+    mkdir -p ${BENCH_DIR} || return 1
+    ${GEN_TREE} -p ${size} \
+	-c $(( size / 60 + 20 )) \
+	-e ${BENCH_EBUILDS} \
+	-o ${BENCH_OVERLAYS} \
+	-d $(( size / 30 + 50 )) \
+	-H $(( size / 100 + 20 )) \
+	${dir} > /dev/null || return 1
+}
+
+drop_caches() {
+    sync
+    echo 3 > /proc/sys/vm/drop_caches 2> /dev/null || \
+	echo "${0}: can't drop the page cache" 1>&2
+}
+
+# files successfully opened by a run
+count_files() {
+    local log=${BENCH_DIR}/strace.log
+    [[ -n ${have_strace} ]] || { echo "-" ; return ; }
+    strace -f -qq -e trace=open,openat -o ${log} "$@" &> /dev/null
+    grep -c '= [0-9][0-9]*$' ${log}
+    rm -f ${log}
+}
+
+# bench <size> <action> <args...>
+bench() {
+    local size=${1} action=${2} run files
+    shift 2
+
+    local cmd=(${HERDSTAT} -T -S -L ${lsd} -H ${lsd}/herds.xml
+	-A ${lsd}/devaway.xml -U ${lsd}/userinfo.xml "$@")
+
+    for run in cold warm ; do
+	if [[ ${run} == cold ]] ; then
+	    rm -f ${lsd}/*cache*
+	    [[ -n ${BENCH_DROP_CACHES} ]] && drop_caches
+	fi
+
+	# time it first, so strace doesn't slow it down...
+	set -- $(${BENCH_RUN} "${cmd[@]}")
+
+	# ...then count the files of an identical run
+	[[ ${run} == cold ]] && rm -f ${lsd}/*cache*
+	files=$(count_files "${cmd[@]}")
+
+	printf "%-8s %-10s %-5s %10s %12s %8s%s\n" \
+	    ${size} ${action} ${run} ${1} ${2} ${files} \
+	    "$([[ ${3} == 0 ]] || echo " (exit ${3})")"
+    done
+}
+
+printf "%-8s %-10s %-5s %10s %12s %8s\n" \
+    packages action run wall_ms peak_rss_kb files
+
+for size in ${BENCH_SIZES} ; do
+    gen_tree ${size} || exit 1
+
+    lsd=${BENCH_DIR}/${size}/localstatedir
+    source ${BENCH_DIR}/${size}/queries || exit 1
+    export PORTDIR PORTDIR_OVERLAY
+
+    bench ${size} herd	    ${herd}
+    bench ${size} dev	    -d ${dev}
+    bench ${size} pkg	    -p ${herd}
+    bench ${size} pkg-dev   -pd ${dev}
+    bench ${size} meta	    -m ${pkg}
+    bench ${size} keywords  -k ${pkg}
+    bench ${size} versions  --versions ${pkg}
+    bench ${size} which	    -w ${pkg}
+    bench ${size} find	    -f ${name}
+    bench ${size} find-re   -fr ${regex}
+    bench ${size} away	    -a all
+    bench ${size} stats
+
+    rm -f ${lsd}/*cache*
+done
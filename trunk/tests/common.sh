@@ -41,3 +41,43 @@ run_herdstat() {
     run_test "$(get_caller ${1})" "${2}" "${srcdir}/../src/herdstat" \
 	"-T -L ${lsd} -A ${lsd}/devaway.xml -H ${lsd}/herds.xml ${3}" "${4}"
 }
+
+# run_batch <options> <input file>
+run_batch() {
+    local lsd="${TEST_DATA}/localstatedir"
+    ${srcdir}/../src/herdstat -T -L ${lsd} -A ${lsd}/devaway.xml \
+	-H ${lsd}/herds.xml -i batch ${1} < ${2}
+}
+
+# turn --output=binary records into '@<record> <n>' frames (see unframe) of
+# the action, then '<label>\t<value>' for each field; fails if a record's
+# length doesn't match its contents
+binary_frames() {
+    od -An -v -tu1 | LC_ALL=C awk '
+	function u32(p) {
+	    return b[p] + (b[p+1] * 256) + (b[p+2] * 65536) + (b[p+3] * 16777216)
+	}
+	function str(    len, s, i) {
+	    len = u32(pos) ; pos += 4 ; s = ""
+	    for (i = 0 ; i < len ; i++) s = s sprintf("%c", b[pos+i])
+	    pos += len
+	    return s
+	}
+	{ for (i = 1 ; i <= NF ; i++) b[size++] = $i }
+	END {
+	    pos = 0
+	    while (pos < size) {
+		end = pos + 4 + u32(pos) ; pos += 4
+		action = str() ; fields = u32(pos) ; pos += 4
+		print "@" (++record) " " (fields + 1) ; print action
+		for (f = 0 ; f < fields ; f++) { label = str() ; print label "\t" str() }
+		if (pos != end) exit 1
+	    }
+	}'
+}
+
+# turn '@<id> <n>' framed replies into '<id> <line>', grouped by id
+unframe() {
+    awk '/^@/ && n == 0 { id = substr($1, 2) ; n = $2 ; next }
+	 { print id " " $0 ; n-- }' | sort -s -n -k1,1
+}
@@ -0,0 +1,56 @@
+#!/bin/bash
+source common.sh || exit 1
+
+lsd="${TEST_DATA}/localstatedir"
+actual="${srcdir}/actual"
+[[ -d ${actual} ]] || mkdir ${actual}
+
+# mixed actions, many times over, so plenty of queries overlap
+for x in $(seq 25) ; do
+    cat <<END
+herd netmon
+pkg fu
+pkg no-herd
+find foo
+which foo
+versions foo
+away all
+dev all
+keywords libfoo
+meta foo
+meta app-misc
+herd all
+stats
+help pkg
+bogus action
+END
+done > ${actual}/concurrent-input
+awk '{ print NR " " $0 }' ${actual}/concurrent-input \
+    > ${actual}/concurrent-input-ids
+
+# the serial front-end is the reference; the threads must match it byte
+# for byte
+run_batch "" ${actual}/concurrent-input > ${actual}/concurrent-serial
+
+for jobs in 2 8 ; do
+    ebegin "Testing concurrent queries (${jobs} threads, in order)"
+    run_batch "-j${jobs} --threads" ${actual}/concurrent-input \
+	> ${actual}/concurrent-threads
+    cmp ${actual}/concurrent-serial ${actual}/concurrent-threads
+    rv=$?
+    eend ${rv}
+    [[ ${rv} == 0 ]] || exit 1
+done
+
+ebegin "Testing concurrent queries (8 threads, request ids)"
+run_batch "--batch-ids" ${actual}/concurrent-input-ids | unframe \
+    > ${actual}/concurrent-serial-ids
+run_batch "-j8 --threads --batch-ids" ${actual}/concurrent-input-ids | \
+    unframe > ${actual}/concurrent-threads-ids
+cmp ${actual}/concurrent-serial-ids ${actual}/concurrent-threads-ids
+rv=$?
+eend ${rv}
+[[ ${rv} == 0 ]] || exit 1
+
+rm -f ${lsd}/*cache*
+indent
@@ -0,0 +1,58 @@
+#!/bin/bash
+source common.sh || exit 1
+
+lsd="${TEST_DATA}/localstatedir"
+sock="${lsd}/herdstatd.sock"
+rm -f ${lsd}/*cache* ${sock}
+
+${srcdir}/../src/herdstat -T -L ${lsd} -A ${lsd}/devaway.xml \
+    -H ${lsd}/herds.xml -i daemon &
+daemon=$!
+trap "kill ${daemon} 2>/dev/null" EXIT
+
+for x in $(seq 50) ; do
+    [[ -S ${sock} ]] && break
+    sleep 0.1
+done
+
+# same queries and expected output as the stream front-end tests
+run_herdstat "herd-test" "daemon (herd)" "-i client -q netmon" || exit 1
+run_herdstat "pkg-herd-test" "daemon (pkg)" "-i client -pq fu" || exit 1
+run_herdstat "pkg-herd-test" "daemon (pkg, resident)" "-i client -pq fu" || exit 1
+
+# changing the tree between requests invalidates the resident caches, which
+# must be dropped or reloaded rather than read from the replaced file
+run_herdstat "metadata-test" "daemon (meta)" "-i client -mnq foo" || exit 1
+touch ${PORTDIR}/app-misc
+run_herdstat "metadata-test" "daemon (meta, tree changed)" \
+    "-i client -mnq foo" || exit 1
+run_herdstat "pkg-herd-test" "daemon (pkg, tree changed)" "-i client -pq fu" || exit 1
+run_herdstat "metadata-test" "daemon (meta, refilled)" "-i client -mnq foo" || exit 1
+
+# each query narrows the resident handler's search for itself
+run_herdstat "find-regex-test" "daemon (find, regex)" "-i client -frq ^foo" || exit 1
+run_herdstat "find-regex-test" "daemon (find, regex again)" \
+    "-i client -frq ^foo" || exit 1
+run_herdstat "find-regex-test" "daemon (find, regex full scan)" \
+    "-i client -fEq ^fo+o" || exit 1
+run_herdstat "find-nonexistent-test" "daemon (find, nonexistent)" \
+    "-i client -frq non-existent" "fail" || exit 1
+
+kill ${daemon}
+wait ${daemon}
+[[ -S ${sock} ]] && exit 1
+
+# --socket must never remove something that isn't a socket
+ebegin "Testing daemon (--socket on a regular file)"
+echo keep > ${lsd}/not-a-socket
+rv=0
+${srcdir}/../src/herdstat -T -L ${lsd} -A ${lsd}/devaway.xml \
+    -H ${lsd}/herds.xml -i daemon --socket ${lsd}/not-a-socket \
+    &> /dev/null && rv=1
+[[ $(< ${lsd}/not-a-socket) == keep ]] || rv=1
+rm -f ${lsd}/not-a-socket
+eend ${rv}
+[[ ${rv} == 0 ]] || exit 1
+
+rm -f ${lsd}/*cache*
+indent
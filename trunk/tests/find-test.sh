@@ -1,7 +1,22 @@
 #!/bin/bash
 source common.sh || exit 1
+rm -f ${TEST_DATA}/localstatedir/*cache*
 run_herdstat "${0}" "find handler" "-fq foo" || exit 1
+# the second time around, foo is looked up in the package cache's index
+run_herdstat "${0}" "find handler (cached)" "-fq foo" || exit 1
 run_herdstat "find-regex-test" "find handler (regex)" "-frq ^foo" || exit 1
+# no trigrams to look up in ^fo+o, so every package is searched
+run_herdstat "find-regex-test" "find handler (regex, full scan)" \
+    "-fEq ^fo+o" || exit 1
+# a back-reference can't go into the combined alternation, where \1 would
+# refer to the first term; each term is tried on its own instead
+run_herdstat "find-regex-test" "find handler (regex, back-reference)" \
+    "-fEq ^foomatic$ ^f(o)\1$" || exit 1
+# anchored to a category, so only its packages are searched
+run_herdstat "find-category-test" "find handler (regex, category)" \
+    "-frq ^app-misc/foo" || exit 1
+run_herdstat "find-category-test" "find handler (regex, category case)" \
+    "-frq ^APP-MISC/foo" || exit 1
 run_herdstat "find-nonexistent-test" "find handler (nonexistent)" \
     "-frq non-existent" "fail" || exit 1
 indent
@@ -0,0 +1,607 @@
+/*
+ * herdstat -- tests/gen_tree.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+/*
+ * Generates a synthetic portage tree, overlays and the XML files herdstat
+ * reads, for benchmarking at sizes the test data can't reach:
+ *
+ *   gen_tree [-c categories] [-p packages] [-e ebuilds] [-o overlays]
+ *            [-d developers] [-H herds] [-s seed] <dir>
+ *
+ * Writes:
+ *   <dir>/portdir          the tree (profiles/categories, metadata/timestamp,
+ *                          and a metadata.xml and ebuilds for each package)
+ *   <dir>/overlay<n>       overlays, each holding some packages of its own
+ *                          and newer versions of some of the tree's
+ *   <dir>/localstatedir    herds.xml, userinfo.xml and devaway.xml
+ *   <dir>/queries          shell variables naming a herd, developer and
+ *                          package that exist, for benchmark.sh to query
+ *
+ * The number of ebuilds varies from package to package, averaging -e.  The
+ * same arguments always generate the same tree.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/* the share of developers that are away */
+#define AWAY_PERCENT        5
+/* the share of each overlay's packages that are newer versions of the
+ * tree's, rather than packages of its own */
+#define OVERLAY_BUMP_PERCENT 50
+/* packages per overlay, as a share of the tree's */
+#define OVERLAY_PERCENT     2
+
+namespace {
+
+    struct Options
+    {
+        Options()
+            : categories(150), packages(10000), ebuilds(3), overlays(1),
+              developers(300), herds(100), seed(1) { }
+
+        unsigned long categories;
+        unsigned long packages;
+        unsigned long ebuilds;
+        unsigned long overlays;
+        unsigned long developers;
+        unsigned long herds;
+        unsigned long seed;
+        std::string dir;
+    };
+
+    /* our own generator, so every libc generates the same tree */
+    class Random
+    {
+        public:
+            Random(unsigned long seed) : _state(seed) { }
+
+            /// [0, n)
+            unsigned long operator()(unsigned long n)
+            {
+                _state = (_state * 1103515245UL + 12345UL) & 0x7fffffffUL;
+                return (n ? (_state >> 4) % n : 0);
+            }
+
+            /// true, percent times out of 100
+            bool chance(unsigned percent) { return ((*this)(100) < percent); }
+
+        private:
+            unsigned long _state;
+    };
+
+    struct Package
+    {
+        std::string category;
+        std::string name;
+        std::vector<std::string> versions;
+    };
+
+    struct Developer
+    {
+        std::string user;
+        std::string name;
+    };
+
+    struct Herd
+    {
+        std::string name;
+        std::vector<std::size_t> devs;
+    };
+
+} // namespace
+
+static const char * const syllables[] =
+{
+    "ba", "be", "bo", "ca", "ce", "co", "da", "de", "di", "do", "fa", "fe",
+    "fo", "ga", "gi", "go", "ka", "ke", "ko", "la", "le", "li", "lo", "ma",
+    "me", "mi", "mo", "na", "ne", "no", "pa", "pe", "po", "ra", "re", "ri",
+    "ro", "sa", "se", "so", "ta", "te", "ti", "to", "va", "ve", "xo", "zu"
+};
+
+static const char * const groups[] =
+{
+    "app", "dev", "net", "sys", "media", "x11", "games", "www", "sci",
+    "kde", "gnome", "mail", "dev-lang", "sec", "gui"
+};
+
+static const char * const arches[] =
+{
+    "alpha", "amd64", "arm", "hppa", "ia64", "mips", "ppc", "ppc64",
+    "s390", "sparc", "x86"
+};
+
+static const char * const licenses[] =
+{
+    "GPL-2", "LGPL-2.1", "BSD", "MIT", "Artistic", "as-is", "MPL-1.1"
+};
+
+static const char * const roles[] =
+{
+    "lead", "member", "", "", ""
+};
+
+#define NELEMS(a) (sizeof(a) / sizeof(a[0]))
+
+static std::string
+word(Random& random, unsigned min, unsigned max)
+{
+    std::string w;
+    const unsigned n = min + random(max - min + 1);
+    for (unsigned i = 0 ; i != n ; ++i)
+        w += syllables[random(NELEMS(syllables))];
+    return w;
+}
+
+/* a word nothing else has been given */
+static std::string
+unique_word(Random& random, unsigned min, unsigned max,
+            std::set<std::string> *used)
+{
+    std::string w(word(random, min, max));
+    while (not used->insert(w).second)
+        w += static_cast<char>('a' + random(26));
+    return w;
+}
+
+static std::string
+number(unsigned long n)
+{
+    char buf[32];
+    std::sprintf(buf, "%lu", n);
+    return buf;
+}
+
+static void
+make_dir(const std::string& path)
+{
+    if (::mkdir(path.c_str(), 0755) != 0 and errno != EEXIST)
+    {
+        std::cerr << "gen_tree: " << path << ": " << std::strerror(errno)
+            << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+static void
+open_file(const std::string& path, std::ofstream& stream)
+{
+    stream.open(path.c_str());
+    if (not stream)
+    {
+        std::cerr << "gen_tree: " << path << ": " << std::strerror(errno)
+            << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+/* count ascending versions, with the odd suffix and revision */
+static void
+make_versions(Random& random, unsigned long count,
+              std::vector<std::string> *versions)
+{
+    unsigned long major = random(3), minor = random(10), micro = 0;
+
+    for (unsigned long n = 0 ; n != count ; ++n)
+    {
+        switch (random(4))
+        {
+            case 0: ++major; minor = micro = 0; break;
+            case 1: ++minor; micro = 0; break;
+            default: ++micro; break;
+        }
+
+        std::string v(number(major)+"."+number(minor));
+        if (micro)
+            v += "."+number(micro);
+
+        /* suffixes sort before the plain version, so only use them on
+         * the last (newest) one */
+        if ((n + 1 == count) and random.chance(10))
+            v += (random.chance(50) ? "_rc" : "_pre")+number(1 + random(3));
+        if (random.chance(20))
+            v += "-r"+number(1 + random(3));
+
+        versions->push_back(v);
+    }
+}
+
+static std::string
+keywords(Random& random)
+{
+    std::string kw;
+    for (std::size_t i = 0 ; i != NELEMS(arches) ; ++i)
+    {
+        if (not random.chance(60))
+            continue;
+        if (not kw.empty())
+            kw += " ";
+        if (random.chance(40))
+            kw += "~";
+        kw += arches[i];
+    }
+    return kw;
+}
+
+static void
+write_ebuild(Random& random, const std::string& dir, const Package& pkg,
+             const std::string& version)
+{
+    std::ofstream f;
+    open_file(dir+"/"+pkg.name+"-"+version+".ebuild", f);
+
+    f << "# Copyright 1999-2005 Gentoo Foundation\n"
+      << "# Distributed under the terms of the GNU General Public License v2\n"
+      << "# $Header: $\n\n"
+      << "DESCRIPTION=\"Synthetic " << pkg.name << " package for "
+      << "benchmarking herdstat\"\n"
+      << "HOMEPAGE=\"http://www.example.org/" << pkg.name << "/\"\n"
+      << "SRC_URI=\"http://www.example.org/" << pkg.name
+      << "/${P}.tar.gz\"\n\n"
+      << "LICENSE=\"" << licenses[random(NELEMS(licenses))] << "\"\n"
+      << "SLOT=\"0\"\n"
+      << "KEYWORDS=\"" << keywords(random) << "\"\n"
+      << "IUSE=\"\"\n\n"
+      << "DEPEND=\"\"\n";
+}
+
+static void
+write_metadata(Random& random, const std::string& dir, const Package& pkg,
+               const std::vector<Herd>& herds,
+               const std::vector<Developer>& devs)
+{
+    std::ofstream f;
+    open_file(dir+"/metadata.xml", f);
+
+    f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      << "<!DOCTYPE pkgmetadata SYSTEM "
+      << "\"http://www.gentoo.org/dtd/metadata.dtd\">\n"
+      << "<pkgmetadata>\n";
+
+    /* most packages have a herd; some have two, some none */
+    unsigned nherds = (random.chance(10) ? 0 : random.chance(20) ? 2 : 1);
+    for (unsigned n = 0 ; n != nherds ; ++n)
+        f << "\t<herd>" << herds[random(herds.size())].name << "</herd>\n";
+
+    unsigned nmaint = (nherds == 0 ? 1 : random(3));
+    for (unsigned n = 0 ; n != nmaint ; ++n)
+    {
+        const Developer& dev(devs[random(devs.size())]);
+        f << "\t<maintainer>\n"
+          << "\t\t<email>" << dev.user << "@gentoo.org</email>\n"
+          << "\t\t<name>" << dev.name << "</name>\n"
+          << "\t</maintainer>\n";
+    }
+
+    f << "\t<longdescription>" << pkg.name << " is a synthetic package "
+      << "in " << pkg.category << ".</longdescription>\n"
+      << "</pkgmetadata>\n";
+}
+
+static void
+write_package(Random& random, const std::string& tree, const Package& pkg,
+              const std::vector<Herd>& herds,
+              const std::vector<Developer>& devs, bool metadata)
+{
+    const std::string dir(tree+"/"+pkg.category+"/"+pkg.name);
+    make_dir(tree+"/"+pkg.category);
+    make_dir(dir);
+
+    if (metadata)
+        write_metadata(random, dir, pkg, herds, devs);
+
+    std::vector<std::string>::const_iterator v;
+    for (v = pkg.versions.begin() ; v != pkg.versions.end() ; ++v)
+        write_ebuild(random, dir, pkg, *v);
+}
+
+static void
+write_tree_files(const std::string& tree,
+                 const std::vector<std::string>& categories,
+                 const std::string& repo_name)
+{
+    make_dir(tree);
+    make_dir(tree+"/profiles");
+    make_dir(tree+"/metadata");
+
+    std::ofstream f;
+    open_file(tree+"/profiles/categories", f);
+    std::vector<std::string>::const_iterator c;
+    for (c = categories.begin() ; c != categories.end() ; ++c)
+        f << *c << "\n";
+    f.close();
+
+    open_file(tree+"/metadata/timestamp", f);
+    f << "Sat Jan  1 00:00:00 UTC 2005\n";
+    f.close();
+
+    if (not repo_name.empty())
+    {
+        open_file(tree+"/profiles/repo_name", f);
+        f << repo_name << "\n";
+    }
+}
+
+static void
+write_herds(const std::string& path, const std::vector<Herd>& herds,
+            const std::vector<Developer>& devs, Random& random)
+{
+    std::ofstream f;
+    open_file(path, f);
+
+    f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      << "<herds>\n";
+
+    std::vector<Herd>::const_iterator h;
+    for (h = herds.begin() ; h != herds.end() ; ++h)
+    {
+        f << "\t<herd>\n"
+          << "\t\t<name>" << h->name << "</name>\n"
+          << "\t\t<email>" << h->name << "@gentoo.org</email>\n"
+          << "\t\t<description>Synthetic " << h->name
+          << " herd</description>\n";
+
+        std::vector<std::size_t>::const_iterator d;
+        for (d = h->devs.begin() ; d != h->devs.end() ; ++d)
+        {
+            const std::string role(roles[random(NELEMS(roles))]);
+            f << "\t\t<maintainer>\n"
+              << "\t\t\t<email>" << devs[*d].user << "@gentoo.org</email>\n"
+              << "\t\t\t<name>" << devs[*d].name << "</name>\n";
+            if (not role.empty())
+                f << "\t\t\t<role>" << role << "</role>\n";
+            f << "\t\t</maintainer>\n";
+        }
+
+        f << "\t</herd>\n";
+    }
+
+    f << "</herds>\n";
+}
+
+static void
+write_userinfo(const std::string& path, const std::vector<Developer>& devs,
+               Random& random)
+{
+    std::ofstream f;
+    open_file(path, f);
+
+    f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      << "<userlist>\n";
+
+    std::vector<Developer>::const_iterator d;
+    for (d = devs.begin() ; d != devs.end() ; ++d)
+    {
+        const std::string::size_type space = d->name.find(' ');
+        f << "\t<user username=\"" << d->user << "\">\n"
+          << "\t\t<realname fullname=\"" << d->name << "\">\n"
+          << "\t\t\t<firstname>" << d->name.substr(0, space)
+          << "</firstname>\n"
+          << "\t\t\t<familyname>" << d->name.substr(space + 1)
+          << "</familyname>\n"
+          << "\t\t</realname>\n"
+          << "\t\t<pgpkey>0x" << std::hex << (0x10000000 + random(0x0fffffff))
+          << std::dec << "</pgpkey>\n"
+          << "\t\t<email gentoo=\"yes\">" << d->user
+          << "@gentoo.org</email>\n"
+          << "\t\t<joined>" << (2000 + random(6)) << "/0" << (1 + random(9))
+          << "/1" << random(10) << "</joined>\n"
+          << "\t\t<birthday>19" << (60 + random(30)) << "/0"
+          << (1 + random(9)) << "/2" << random(10) << "</birthday>\n"
+          << "\t\t<status>active</status>\n"
+          << "\t\t<roles>Synthetic developer</roles>\n"
+          << "\t\t<location>Nowhere</location>\n"
+          << "\t</user>\n";
+    }
+
+    f << "</userlist>\n";
+}
+
+static void
+write_devaway(const std::string& path, const std::vector<Developer>& devs,
+              Random& random)
+{
+    std::ofstream f;
+    open_file(path, f);
+
+    f << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+      << "<devaway>\n";
+
+    std::vector<Developer>::const_iterator d;
+    for (d = devs.begin() ; d != devs.end() ; ++d)
+        if (random.chance(AWAY_PERCENT))
+            f << "\t<dev nick=\"" << d->user << "\">Away until further "
+              << "notice.</dev>\n";
+
+    f << "</devaway>\n";
+}
+
+static void
+usage()
+{
+    std::cerr << "usage: gen_tree [-c categories] [-p packages] "
+        << "[-e ebuilds] [-o overlays]" << std::endl
+        << "                [-d developers] [-H herds] [-s seed] <dir>"
+        << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+static void
+parse_options(int argc, char **argv, Options *opts)
+{
+    int c;
+    while ((c = ::getopt(argc, argv, "c:p:e:o:d:H:s:")) != -1)
+    {
+        const unsigned long n = std::strtoul(optarg ? optarg : "0", NULL, 10);
+        switch (c)
+        {
+            case 'c': opts->categories = n; break;
+            case 'p': opts->packages = n; break;
+            case 'e': opts->ebuilds = n; break;
+            case 'o': opts->overlays = n; break;
+            case 'd': opts->developers = n; break;
+            case 'H': opts->herds = n; break;
+            case 's': opts->seed = n; break;
+            default: usage();
+        }
+    }
+
+    if (optind + 1 != argc or opts->categories == 0 or
+        opts->packages == 0 or opts->ebuilds == 0 or
+        opts->developers == 0 or opts->herds == 0)
+        usage();
+
+    opts->dir.assign(argv[optind]);
+}
+
+int
+main(int argc, char **argv)
+{
+    Options opts;
+    parse_options(argc, argv, &opts);
+
+    Random random(opts.seed);
+    std::set<std::string> used;
+
+    /* developers and herds */
+    std::vector<Developer> devs(opts.developers);
+    for (std::size_t n = 0 ; n != devs.size() ; ++n)
+    {
+        devs[n].user = unique_word(random, 2, 3, &used);
+        std::string first(word(random, 2, 3)), last(word(random, 2, 4));
+        first[0] = std::toupper(first[0]);
+        last[0] = std::toupper(last[0]);
+        devs[n].name = first+" "+last;
+    }
+
+    std::vector<Herd> herds(opts.herds);
+    for (std::size_t n = 0 ; n != herds.size() ; ++n)
+    {
+        herds[n].name = unique_word(random, 2, 3, &used);
+        const unsigned long ndevs = 1 + random(8);
+        for (unsigned long d = 0 ; d != ndevs ; ++d)
+            herds[n].devs.push_back(random(devs.size()));
+    }
+
+    /* categories */
+    std::vector<std::string> categories(opts.categories);
+    for (std::size_t n = 0 ; n != categories.size() ; ++n)
+        categories[n] = std::string(groups[n % NELEMS(groups)])+"-"+
+            unique_word(random, 2, 3, &used);
+
+    /* the tree */
+    make_dir(opts.dir);
+    const std::string portdir(opts.dir+"/portdir");
+    write_tree_files(portdir, categories, "");
+
+    std::vector<Package> packages(opts.packages);
+    for (std::size_t n = 0 ; n != packages.size() ; ++n)
+    {
+        Package& pkg(packages[n]);
+        pkg.category = categories[random(categories.size())];
+        pkg.name = unique_word(random, 2, 4, &used);
+        make_versions(random, 1 + random(2 * opts.ebuilds - 1), &pkg.versions);
+        write_package(random, portdir, pkg, herds, devs, true);
+
+        if ((n + 1) % 10000 == 0)
+            std::cerr << "gen_tree: " << (n + 1) << " packages" << std::endl;
+    }
+
+    /* overlays */
+    std::string overlays;
+    for (unsigned long o = 0 ; o != opts.overlays ; ++o)
+    {
+        const std::string dir(opts.dir+"/overlay"+number(o));
+        write_tree_files(dir, categories, "overlay"+number(o));
+
+        if (not overlays.empty())
+            overlays += " ";
+        overlays += dir;
+
+        const unsigned long count =
+            1 + (opts.packages * OVERLAY_PERCENT / 100);
+        for (unsigned long n = 0 ; n != count ; ++n)
+        {
+            Package pkg;
+            if (random.chance(OVERLAY_BUMP_PERCENT))
+            {
+                /* a newer version of one of the tree's */
+                const Package& orig(packages[random(packages.size())]);
+                pkg.category = orig.category;
+                pkg.name = orig.name;
+                pkg.versions.push_back("9999");
+            }
+            else
+            {
+                pkg.category = categories[random(categories.size())];
+                pkg.name = unique_word(random, 2, 4, &used);
+                make_versions(random, 1 + random(2), &pkg.versions);
+            }
+
+            write_package(random, dir, pkg, herds, devs,
+                          (pkg.versions.front() != "9999"));
+        }
+    }
+
+    /* the XML */
+    const std::string lsd(opts.dir+"/localstatedir");
+    make_dir(lsd);
+    write_herds(lsd+"/herds.xml", herds, devs, random);
+    write_userinfo(lsd+"/userinfo.xml", devs, random);
+    write_devaway(lsd+"/devaway.xml", devs, random);
+
+    /* something for the benchmark to look up */
+    const Package& pkg(packages[packages.size() / 2]);
+    std::ofstream f;
+    open_file(opts.dir+"/queries", f);
+    f << "PORTDIR=\"" << portdir << "\"\n"
+      << "PORTDIR_OVERLAY=\"" << overlays << "\"\n"
+      << "herd=\"" << herds[herds.size() / 2].name << "\"\n"
+      << "dev=\"" << devs[herds[herds.size() / 2].devs.front()].user
+      << "\"\n"
+      << "pkg=\"" << pkg.category << "/" << pkg.name << "\"\n"
+      << "name=\"" << pkg.name << "\"\n"
+      << "regex=\"^" << pkg.name.substr(0, 4) << "\"\n";
+
+    std::cout << opts.packages << " packages in " << opts.categories
+        << " categories, " << opts.overlays << " overlay(s), "
+        << opts.herds << " herds and " << opts.developers
+        << " developers written to " << opts.dir << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
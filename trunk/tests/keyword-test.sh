@@ -1,4 +1,8 @@
 #!/bin/bash
 source common.sh || exit 1
+rm -f ${TEST_DATA}/localstatedir/*cache*
 run_herdstat "${0}" "keyword handler" "-qk sys-libs/libfoo" || exit 1
+# the second time around, the keywords come from the ebuild cache
+run_herdstat "${0}" "keyword handler (cached)" "-qk sys-libs/libfoo" || exit 1
+rm -f ${TEST_DATA}/localstatedir/*cache*
 indent
@@ -1,5 +1,6 @@
 #!/bin/bash
 source common.sh || exit 1
+rm -f ${TEST_DATA}/localstatedir/*cache*
 run_herdstat "${0}" "metadata handler" "-mnq foo" || exit 1
 run_herdstat "metadata-cat-test" "metadata handler (category)" \
     "-mq sys-libs" || exit 1
@@ -17,4 +18,13 @@ builtin cd ${PORTDIR}/app-misc/foo
 run_herdstat "${0}" "metadata handler (pwd)" "-mq" || exit 1
 builtin cd ${origpwd}
 
+# the pkg handler fills the metadata cache, which the metadata handler then
+# uses instead of parsing; the output should be identical
+run_herdstat "pkg-herd-test" "pkg handler (filling metadata cache)" \
+    "-pq fu" || exit 1
+run_herdstat "${0}" "metadata handler (cached)" "-mnq foo" || exit 1
+run_herdstat "metadata-regex-test" "metadata handler (cached regex)" \
+    "-mrq ." || exit 1
+
+rm -f ${TEST_DATA}/localstatedir/*cache*
 indent
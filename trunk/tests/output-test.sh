@@ -0,0 +1,58 @@
+#!/bin/bash
+source common.sh || exit 1
+
+lsd="${TEST_DATA}/localstatedir"
+actual="${srcdir}/actual"
+[[ -d ${actual} ]] || mkdir ${actual}
+
+cat > ${actual}/output-input <<END
+herd netmon
+pkg fu
+find foo
+which foo
+versions foo
+away all
+dev all
+keywords libfoo
+meta foo
+stats
+END
+
+# one value per line, in the order the fields were written
+json_values() {
+    sed -e 's/^{"action":"[a-z]*","fields":\[//' -e 's/\]}$//' \
+	-e 's/},{/}\n{/g' | sed -e 's/.*"value":"\(.*\)"}$/\1/' \
+	-e 's/\\"/"/g' -e 's/\\\\/\\/g'
+}
+
+# records hold the same values plain text output does, minus the breaks
+run_batch "" ${actual}/output-input | grep -v '^$' > ${actual}/output-text
+
+ebegin "Testing JSON Lines output"
+run_batch "-q --output=json" ${actual}/output-input > ${actual}/output-json
+rv=0
+[[ $(grep -c '^{"action":"[a-z]*","fields":\[.*\]}$' ${actual}/output-json) == \
+   $(wc -l < ${actual}/output-json) ]] || rv=1
+json_values < ${actual}/output-json | grep -v '^$' | \
+    diff ${actual}/output-text - || rv=1
+eend ${rv}
+[[ ${rv} == 0 ]] || exit 1
+
+ebegin "Testing binary output"
+run_batch "-q --output=binary" ${actual}/output-input > ${actual}/output-binary
+rv=0
+binary_frames < ${actual}/output-binary > ${actual}/output-frames || rv=1
+unframe < ${actual}/output-frames > ${actual}/output-records
+# the first line of each record is its action, as in the JSON output
+sed -e 's/^{"action":"\([a-z]*\)".*/\1/' ${actual}/output-json | \
+    diff - <(awk '$1 != id { id = $1 ; print $2 }' ${actual}/output-records) \
+    || rv=1
+# then its fields, whose values are what the plain text output holds
+awk '$1 != id { id = $1 ; next } { sub(/^[^\t]*\t/, "") ; print }' \
+    ${actual}/output-records | grep -v '^$' | \
+    diff ${actual}/output-text - || rv=1
+eend ${rv}
+[[ ${rv} == 0 ]] || exit 1
+
+rm -f ${lsd}/*cache*
+indent
@@ -0,0 +1,38 @@
+#!/bin/bash
+source common.sh || exit 1
+
+lsd="${TEST_DATA}/localstatedir"
+actual="${srcdir}/actual"
+[[ -d ${actual} ]] || mkdir ${actual}
+
+run_timed() {
+    ${srcdir}/../src/herdstat -T -L ${lsd} -A ${lsd}/devaway.xml \
+	-H ${lsd}/herds.xml ${1} netmon
+}
+
+# timings vary, so only check that the phases and counters are there and
+# that the results themselves are unchanged
+run_timed "-q" > ${actual}/timer-plain 2>/dev/null
+
+ebegin "Testing --timer"
+run_timed "-q -t" > ${actual}/timer-out 2> ${actual}/timer-summary
+rv=0
+diff ${actual}/timer-plain ${actual}/timer-out || rv=1
+for phase in "do_init (herd)" "do_results (herd)" "do_cleanup (herd)" ; do
+    grep -q "^${phase} " ${actual}/timer-summary || rv=1
+done
+grep -q "^result lines  *[1-9]" ${actual}/timer-summary || rv=1
+eend ${rv}
+[[ ${rv} == 0 ]] || exit 1
+
+ebegin "Testing --trace"
+run_timed "-q --trace=${actual}/timer-trace" > ${actual}/timer-out 2>&1
+rv=0
+diff ${actual}/timer-plain ${actual}/timer-out || rv=1
+head -n1 ${actual}/timer-trace | grep -q '^{"traceEvents":\[$' || rv=1
+grep -q '"name":"do_results","cat":"herd","ph":"X"' ${actual}/timer-trace || rv=1
+tail -n1 ${actual}/timer-trace | grep -q '^\],"displayTimeUnit":"ms"}$' || rv=1
+eend ${rv}
+[[ ${rv} == 0 ]] || exit 1
+
+indent
@@ -0,0 +1,11 @@
+#!/bin/bash
+source common.sh || exit 1
+echo "$(ls ${PORTDIR}/*/*/*.ebuild | wc -l) versions checked" > \
+    ${srcdir}/expected/version-key
+
+run_test "$(get_caller ${0})" "version sort keys" \
+    "${srcdir}/version_key_check" "${PORTDIR}" || exit 1
+
+rm -f ${srcdir}/expected/version-key
+
+indent
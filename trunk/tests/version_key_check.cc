@@ -0,0 +1,214 @@
+/*
+ * herdstat -- tests/version_key_check.cc
+ * $Id$
+ * Copyright (c) 2005 Aaron Walker <ka0ttic@gentoo.org>
+ *
+ * This file is part of herdstat.
+ *
+ * herdstat is free software; you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation; either version 2 of the License, or (at your option) any later
+ * version.
+ *
+ * herdstat is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * herdstat; if not, write to the Free Software Foundation, Inc., 59 Temple
+ * Place, Suite 325, Boston, MA  02111-1257  USA
+ */
+
+/*
+ * Differential test of the version sort keys (src/version_key.cc) against
+ * libherdstat's VersionString comparisons, on every ebuild in a tree:
+ *
+ *   version_key_check [-b] [portdir]
+ *
+ * Prints every pair of versions the two disagree on and exits non-zero if
+ * there were any, otherwise prints how many versions were checked.  With -b,
+ * also times sorting a large list of the tree's versions both ways.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <herdstat/util/timer.hh>
+#include <herdstat/portage/version.hh>
+
+#include "version_key.hh"
+
+#define BENCH_VERSIONS      500000
+
+using namespace herdstat;
+
+struct Version
+{
+    Version(const std::string& p, const std::string& e)
+        : path(p+"/"+e), version(path), key()
+    { ebuild_version_key(p.substr(p.rfind('/') + 1), e, &key); }
+
+    std::string path;
+    portage::VersionString version;
+    std::string key;
+};
+
+static bool
+version_less(const Version *a, const Version *b)
+{
+    return (a->version < b->version);
+}
+
+/* call fn(dir, entry) for each entry of dir that isn't hidden */
+template <typename F>
+static void
+each_entry(const std::string& dir, F fn)
+{
+    DIR *d = ::opendir(dir.c_str());
+    if (not d)
+        return;
+
+    struct dirent *ent;
+    while ((ent = ::readdir(d)))
+        if (ent->d_name[0] != '.')
+            fn(dir, ent->d_name);
+
+    ::closedir(d);
+}
+
+struct AddEbuild
+{
+    AddEbuild(std::vector<Version *> *v) : versions(v) { }
+    void operator()(const std::string& dir, const std::string& name) const
+    {
+        const std::string::size_type pos = name.rfind(".ebuild");
+        if ((pos != std::string::npos) and
+            (pos == (name.size() - (sizeof(".ebuild") - 1))))
+            versions->push_back(new Version(dir, name));
+    }
+    std::vector<Version *> *versions;
+};
+
+struct AddPackage
+{
+    AddPackage(std::vector<Version *> *v) : versions(v) { }
+    void operator()(const std::string& dir, const std::string& name) const
+    { each_entry(dir+"/"+name, AddEbuild(versions)); }
+    std::vector<Version *> *versions;
+};
+
+struct AddCategory
+{
+    AddCategory(std::vector<Version *> *v) : versions(v) { }
+    void operator()(const std::string& dir, const std::string& name) const
+    { each_entry(dir+"/"+name, AddPackage(versions)); }
+    std::vector<Version *> *versions;
+};
+
+static void
+bench(const std::vector<Version *>& versions)
+{
+    /* pad it out with copies of the tree's versions */
+    std::vector<std::string> paths;
+    while (paths.size() < BENCH_VERSIONS)
+        for (std::size_t i = 0 ; i != versions.size() ; ++i)
+            paths.push_back(versions[i]->path);
+
+    util::Timer timer;
+
+    std::vector<portage::VersionString> v;
+    v.reserve(paths.size());
+    for (std::size_t i = 0 ; i != paths.size() ; ++i)
+        v.push_back(portage::VersionString(paths[i]));
+
+    timer.start();
+    std::sort(v.begin(), v.end());
+    timer.stop();
+    std::cout << "VersionString: sorted " << v.size() << " versions in "
+        << timer.elapsed() << "ms" << std::endl;
+
+    /* encoding counts against the keys, since it replaces parsing */
+    std::vector<std::string> keys(paths.size());
+    timer.start();
+    for (std::size_t i = 0 ; i != paths.size() ; ++i)
+    {
+        const std::string::size_type slash = paths[i].rfind('/');
+        const std::string dir(paths[i].substr(0, slash));
+        ebuild_version_key(dir.substr(dir.rfind('/') + 1),
+                           paths[i].substr(slash + 1), &keys[i]);
+    }
+    std::sort(keys.begin(), keys.end());
+    timer.stop();
+    std::cout << "keys: encoded and sorted " << keys.size() << " versions in "
+        << timer.elapsed() << "ms" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+    bool do_bench = false;
+    if ((argc > 1) and (std::strcmp(argv[1], "-b") == 0))
+    {
+        do_bench = true;
+        --argc;
+        ++argv;
+    }
+
+    const char *portdir = (argc > 1 ? argv[1] : std::getenv("PORTDIR"));
+    if (not portdir)
+    {
+        std::cerr << "usage: version_key_check [-b] [portdir]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Version *> versions;
+    DIR *d = ::opendir(portdir);
+    if (not d)
+    {
+        std::cerr << portdir << ": " << std::strerror(errno) << std::endl;
+        return EXIT_FAILURE;
+    }
+    ::closedir(d);
+    each_entry(portdir, AddCategory(&versions));
+
+    /* sort by VersionString, then every adjacent pair must compare the same
+     * way by key (which, the order being total, covers every pair) */
+    std::stable_sort(versions.begin(), versions.end(), version_less);
+
+    std::size_t bad = 0;
+    for (std::size_t i = 1 ; i < versions.size() ; ++i)
+    {
+        const Version *a = versions[i-1], *b = versions[i];
+        const int r = a->key.compare(b->key);
+        const bool less = (a->version < b->version);
+        if ((less and r >= 0) or (not less and r != 0))
+        {
+            std::cout << a->path << " " << (less ? "<" : "==") << " "
+                << b->path << ", but not by key" << std::endl;
+            ++bad;
+        }
+    }
+
+    std::cout << versions.size() << " versions checked" << std::endl;
+
+    if (do_bench and not versions.empty())
+        bench(versions);
+
+    for (std::size_t i = 0 ; i != versions.size() ; ++i)
+        delete versions[i];
+
+    return (bad ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/* vim: set tw=80 sw=4 fdm=marker et : */
@@ -1,4 +1,8 @@
 #!/bin/bash
 source common.sh || exit 1
+rm -f ${TEST_DATA}/localstatedir/*cache*
 run_herdstat "${0}" "versions handler" "--versions -q foo" || exit 1
+# the second time around, the versions come from the ebuild cache
+run_herdstat "${0}" "versions handler (cached)" "--versions -q foo" || exit 1
+rm -f ${TEST_DATA}/localstatedir/*cache*
 indent
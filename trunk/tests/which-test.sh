@@ -1,6 +1,6 @@
 #!/bin/bash
 source common.sh || exit 1
-rm -f ${srcdir}/expected/which*
+rm -f ${srcdir}/expected/which* ${TEST_DATA}/localstatedir/*cache*
 echo "${TEST_DATA}/portdir/app-misc/foo/foo-1.10.20050629-r1.ebuild" > \
     ${srcdir}/expected/which
 
@@ -13,7 +13,9 @@ done
 
 run_herdstat "${0}" "which handler" "-wq foo" || exit 1
 run_herdstat "which-regex-test" "which handler (regex)" "-wqr foo" || exit 1
+# the second time around, the latest ebuilds come from the ebuild cache
+run_herdstat "which-regex-test" "which handler (cached)" "-wqr foo" || exit 1
 
-rm -f ${srcdir}/expected/which*
+rm -f ${srcdir}/expected/which* ${TEST_DATA}/localstatedir/*cache*
 
 indent